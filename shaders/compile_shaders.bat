@@ -1,3 +1,6 @@
 C:\dev_libraries\VulkanSDK\Bin\glslc.exe simple_shader.vert -o simple_shader.vert.spv
+C:\dev_libraries\VulkanSDK\Bin\glslc.exe -DOCTAHEDRAL_NORMALS simple_shader.vert -o simple_shader_compact.vert.spv
 C:\dev_libraries\VulkanSDK\Bin\glslc.exe simple_shader.frag -o simple_shader.frag.spv
+C:\dev_libraries\VulkanSDK\Bin\glslc.exe frustum_cull.comp -o frustum_cull.comp.spv
+C:\dev_libraries\VulkanSDK\Bin\glslc.exe debug_shape.vert -o debug_shape.vert.spv
 pause
\ No newline at end of file
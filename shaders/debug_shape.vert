@@ -0,0 +1,41 @@
+#version 450
+
+// Unit shape mesh, VERTEX_FORMAT_FLOAT (see DebugDrawer in debug_drawer.h)
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// DebugShapeInstance_t, per instance (see AddDebugShapeInstanceLayout() in debug_drawer.cpp)
+layout(location = 4) in mat4 inTransform;
+layout(location = 8) in vec4 inInstanceColor;
+
+// Read by simple_shader.frag
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outWorldPosition;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out float outViewDepth;
+layout(location = 4) flat out uint outFlags;
+
+// Must match the one in simple_shader.vert and UniformBufferData_t in swapchain.h
+layout(binding=0) uniform UniformBufferObject {
+	mat4 view;
+	mat4 projection;
+	vec4 clusterDepthParams;
+	vec4 clusterScreenParams;
+	uvec4 lightCounts;
+} ubo;
+
+const uint OBJECT_FLAG_FULLBRIGHT_BIT = 1; // See ObjectFlagBits_t in swapchain.h
+
+void main() {
+	// Frustums are drawn with a projective transform.
+	vec4 worldPos = inTransform * vec4(inPosition, 1.0);
+	worldPos /= worldPos.w;
+	vec4 viewPos = ubo.view * worldPos;
+	gl_Position = ubo.projection * viewPos;
+
+	outColor = inColor * inInstanceColor.rgb;
+	outWorldPosition = vec3(worldPos);
+	outNormal = vec3(0.0, 0.0, 1.0);
+	outViewDepth = viewPos.z;
+	outFlags = OBJECT_FLAG_FULLBRIGHT_BIT;
+}
@@ -1,14 +1,89 @@
 #version 450
 
 layout(location = 0) in vec3 inColor;
+layout(location = 1) in vec3 inWorldPosition;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in float inViewDepth;
+layout(location = 4) flat in uint inFlags;
 
 layout(location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push {
-	mat4 transform;
-	mat4 normalMatrix;
-} push;
+// Must match the one in simple_shader.vert and UniformBufferData_t in swapchain.h
+layout(binding=0) uniform UniformBufferObject {
+	mat4 view;
+	mat4 projection;
+	vec4 clusterDepthParams;
+	vec4 clusterScreenParams;
+	uvec4 lightCounts;
+} ubo;
+
+const uint OBJECT_FLAG_FULLBRIGHT_BIT = 1; // See ObjectFlagBits_t in swapchain.h
+
+const float LIGHT_DATA_DIRECTIONAL = 1.0f; // See light.h
+const float LIGHT_DATA_POINT = 2.0f;
+const float LIGHT_DATA_ENVIRONMENT = 3.0f;
+
+struct LightData {
+	vec4 positionOrDirection; // w : LIGHT_DATA_*
+	vec4 parameters;          // x : intensity. y : range, for local lights.
+};
+
+// Global lights first (lightCounts.x of them), then the local lights referenced by the clusters.
+layout(std430, binding=3) readonly buffer LightBuffer {
+	LightData lights[];
+};
+
+// Hard-coded for now to reflect the ones in light_clustering.h
+const uint CLUSTER_GRID_X = 16;
+const uint CLUSTER_GRID_Y = 9;
+const uint CLUSTER_GRID_Z = 24;
+
+// x : first index in clusterLightIndices, y : light count.
+layout(std430, binding=4) readonly buffer ClusterBuffer {
+	uvec2 clusters[];
+};
+
+layout(std430, binding=5) readonly buffer ClusterLightBuffer {
+	uint clusterLightIndices[];
+};
+
+uint FindCluster() {
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * ubo.clusterScreenParams.xy), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+	float depth = ubo.clusterDepthParams.z != 0.0f ? log(max(inViewDepth, 1e-6f)) : inViewDepth;
+	uint slice = uint(clamp(floor(depth * ubo.clusterDepthParams.x + ubo.clusterDepthParams.y), 0.0f, float(CLUSTER_GRID_Z - 1)));
+	return tile.x + tile.y * CLUSTER_GRID_X + slice * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
 
 void main() {
-	outColor = vec4(inColor, 1.0);
-}
\ No newline at end of file
+	if((inFlags & OBJECT_FLAG_FULLBRIGHT_BIT) != 0) {
+		outColor = vec4(inColor, 1.0);
+		return;
+	}
+
+	vec3 normal = normalize(inNormal);
+	float lightPower = 0.0f;
+
+	for(uint i = 0; i < ubo.lightCounts.x; i++) {
+		LightData light = lights[i];
+		if(light.positionOrDirection.w == LIGHT_DATA_DIRECTIONAL) {
+			lightPower += max(dot(normal, light.positionOrDirection.xyz), 0) * light.parameters.x;
+		}
+		else if(light.positionOrDirection.w == LIGHT_DATA_ENVIRONMENT) {
+			lightPower += light.parameters.x;
+		}
+	}
+
+	uvec2 cluster = clusters[FindCluster()];
+	for(uint i = 0; i < cluster.y; i++) {
+		LightData light = lights[clusterLightIndices[cluster.x + i]];
+		// Only point lights are local for now.
+		vec3 meToLight = light.positionOrDirection.xyz - inWorldPosition;
+		float distanceSquared = dot(meToLight, meToLight) + 0.00001f;
+		// Fades to 0 at the light's range, so that leaving a cluster does not cut the light off.
+		float rangeRatio = distanceSquared / (light.parameters.y * light.parameters.y);
+		float window = clamp(1.0f - rangeRatio * rangeRatio, 0.0f, 1.0f);
+		lightPower += max(dot(normal, normalize(meToLight)), 0) / distanceSquared * light.parameters.x * window * window;
+	}
+
+	outColor = vec4(inColor * lightPower, 1.0);
+}
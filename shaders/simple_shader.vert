@@ -2,55 +2,72 @@
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+#ifdef OCTAHEDRAL_NORMALS
+layout(location = 2) in vec2 inNormal; // See VERTEX_FORMAT_COMPACT in model.h
+#else
 layout(location = 2) in vec3 inNormal;
+#endif
 layout(location = 3) in vec2 inUV;
 
 layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outWorldPosition;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out float outViewDepth;
+layout(location = 4) flat out uint outFlags;
 
-layout(push_constant) uniform Push {
-	mat4 model;
-	mat4 normalMatrix;
-	bool fullbright;
-} push;
-
-const int MAX_LIGHT_DATA_COUNT = 10; //MAX_LIGHT_DATA_COUNT hard-coded for now to reflect the one in swapchain.h
-
+// Must match the one in simple_shader.frag and UniformBufferData_t in swapchain.h
 layout(binding=0) uniform UniformBufferObject {
 	mat4 view;
 	mat4 projection;
-	vec4 lightDatas[MAX_LIGHT_DATA_COUNT]; 
+	vec4 clusterDepthParams;
+	vec4 clusterScreenParams;
+	uvec4 lightCounts;
 } ubo;
 
+struct ObjectData {
+	mat4 model;
+	mat4 normalMatrix;
+	vec4 positionOffset;
+	vec4 positionScale;
+	uint flags;
+};
+
+layout(std430, binding=1) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+};
+
+// Object index of each instance. Entities sharing a model are consecutive instances of a single draw.
+layout(std430, binding=2) readonly buffer InstanceBuffer {
+	uint instanceObjectIndices[];
+};
+
+vec3 DecodeNormal() {
+#ifdef OCTAHEDRAL_NORMALS
+	vec3 normal = vec3(inNormal, 1.0 - abs(inNormal.x) - abs(inNormal.y));
+	float t = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -t : t;
+	normal.y += normal.y >= 0.0 ? -t : t;
+	return normal;
+#else
+	return inNormal;
+#endif
+}
+
 void main() {
-	vec4 worldPos = push.model * vec4(inPosition, 1.0);
-	gl_Position = ubo.projection * ubo.view * push.model * vec4(inPosition, 1.0);
-
-	float lightPower = 0.0f;
-	if(push.fullbright) {
-		lightPower = 1.0f;
-	} else {
-		for(int i = 0; i < MAX_LIGHT_DATA_COUNT; i++) {
-			if(ubo.lightDatas[i].w == 1.0f) { // DIRECTIONAL LIGHT
-				lightPower += max(dot(mat3(push.normalMatrix) * inNormal, vec3(ubo.lightDatas[i])), 0);
-			} 
-			else if(ubo.lightDatas[i].w == 2.0f)  { // POINT LIGHT
-				vec3 meToLight = vec3(ubo.lightDatas[i]) - vec3(worldPos);
-				float distanceSquared = meToLight.x * meToLight.x + meToLight.y * meToLight.y + meToLight.z * meToLight.z + 0.00001f;
-				meToLight = normalize(meToLight);
-				i++;
-				lightPower += max(dot(mat3(push.normalMatrix) * inNormal, meToLight), 0) / distanceSquared * ubo.lightDatas[i].x;
-			}
-			else if(ubo.lightDatas[i].w == 3.0f) { // ENVIRONMENT LIGHT
-				lightPower += ubo.lightDatas[i].x;
-			}
-			else{ //As more light types get introduces, we will check for them here and handle them accordingly.
-				break;
-			}
-		}
-	}
-
-
-	outColor = inColor * lightPower;
+	ObjectData object = objects[instanceObjectIndices[gl_InstanceIndex]];
+	mat3 normalMatrix = mat3(object.normalMatrix);
+
+	vec3 position = object.positionOffset.xyz + inPosition * object.positionScale.xyz;
+	vec4 worldPos = object.model * vec4(position, 1.0);
+	vec4 viewPos = ubo.view * worldPos;
+	gl_Position = ubo.projection * viewPos;
+
+	// Lit per fragment, see simple_shader.frag.
+	outColor = inColor;
+	outWorldPosition = vec3(worldPos);
+	outNormal = normalMatrix * DecodeNormal();
+	outViewDepth = viewPos.z;
+	outFlags = object.flags;
 
 	gl_PointSize = 5.0f;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "radix_sort.h"
+
+#include <cstring>
+
+namespace gigno {
+
+    void RadixSort(std::vector<SortItem_t> &items, std::vector<SortItem_t> &scratch) {
+        const size_t count = items.size();
+        if (count < 2) {
+            return;
+        }
+        scratch.resize(count);
+
+        // Every histogram in a single read of the keys.
+        uint32_t histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+        for (const SortItem_t &item : items) {
+            for (int byte = 0; byte < 8; byte++) {
+                histograms[byte][(item.Key >> (byte * 8)) & 0xFF]++;
+            }
+        }
+
+        SortItem_t *src = items.data();
+        SortItem_t *dst = scratch.data();
+        for (int byte = 0; byte < 8; byte++) {
+            uint32_t *histogram = histograms[byte];
+            const int shift = byte * 8;
+
+            if (histogram[(src[0].Key >> shift) & 0xFF] == count) {
+                continue; // Every key has the same value for this byte.
+            }
+
+            uint32_t offset = 0;
+            for (int bucket = 0; bucket < 256; bucket++) {
+                const uint32_t bucket_count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucket_count;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                dst[histogram[(src[i].Key >> shift) & 0xFF]++] = src[i];
+            }
+
+            SortItem_t *swap = src;
+            src = dst;
+            dst = swap;
+        }
+
+        if (src != items.data()) {
+            items.swap(scratch);
+        }
+    }
+
+}
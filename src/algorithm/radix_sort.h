@@ -0,0 +1,24 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <cstdint>
+#include <vector>
+
+namespace gigno {
+
+    struct SortItem_t {
+        uint64_t Key;
+        uint32_t Value;
+    };
+
+    /*
+    Stable least significant digit radix sort on the 64 bit keys, one byte per pass.
+    Passes on a byte every key shares are skipped : keys with constant high bits cost only the passes they need.
+
+    @param scratch resized to items.size(). Kept by the caller so that sorting every frame does not allocate.
+    */
+    void RadixSort(std::vector<SortItem_t> &items, std::vector<SortItem_t> &scratch);
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "tlsf.h"
+
+namespace gigno {
+
+    static uint32_t Log2(uint64_t value) {
+        return 63 - __builtin_clzll(value);
+    }
+
+    TlsfAllocator::TlsfAllocator(uint64_t size) : m_Size{size} {
+        for(uint32_t fl = 0; fl < FL_INDEX_COUNT; fl++) {
+            for(uint32_t sl = 0; sl < SL_INDEX_COUNT; sl++) {
+                m_FreeHeads[fl][sl] = INVALID_NODE;
+            }
+        }
+        InsertFree(NewNode(0, size));
+    }
+
+    uint32_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t &offset) {
+        if(size == 0) {
+            size = 1;
+        }
+        if(alignment == 0) {
+            alignment = 1;
+        }
+
+        uint32_t node = FindSuitable(size + alignment - 1);
+        if(node == INVALID_NODE) {
+            return INVALID_NODE;
+        }
+        RemoveFree(node);
+
+        const uint64_t aligned = (m_Nodes[node].Offset + alignment - 1) & ~(alignment - 1);
+        const uint64_t padding = aligned - m_Nodes[node].Offset;
+        if(padding > 0) {
+            // The front padding stays free. Its physical predecessor cannot be free (free ranges are always merged).
+            uint32_t front = node;
+            node = Split(front, padding);
+            InsertFree(front);
+        }
+
+        if(m_Nodes[node].Size - size >= MIN_SPLIT_SIZE) {
+            InsertFree(Split(node, size));
+        }
+
+        m_Nodes[node].IsFree = false;
+        m_UsedBytes += m_Nodes[node].Size;
+        m_AllocationCount++;
+
+        offset = m_Nodes[node].Offset;
+        return node;
+    }
+
+    void TlsfAllocator::Free(uint32_t node) {
+        if(node == INVALID_NODE || node >= m_Nodes.size() || m_Nodes[node].IsFree) {
+            return;
+        }
+
+        m_UsedBytes -= m_Nodes[node].Size;
+        m_AllocationCount--;
+
+        const uint32_t prev = m_Nodes[node].PrevPhysical;
+        if(prev != INVALID_NODE && m_Nodes[prev].IsFree) {
+            RemoveFree(prev);
+            Merge(prev, node);
+            node = prev;
+        }
+        const uint32_t next = m_Nodes[node].NextPhysical;
+        if(next != INVALID_NODE && m_Nodes[next].IsFree) {
+            RemoveFree(next);
+            Merge(node, next);
+        }
+
+        InsertFree(node);
+    }
+
+    void TlsfAllocator::Mapping(uint64_t size, uint32_t &fl, uint32_t &sl) {
+        if(size < SL_INDEX_COUNT) {
+            fl = 0;
+            sl = static_cast<uint32_t>(size);
+            return;
+        }
+        const uint32_t log2 = Log2(size);
+        sl = static_cast<uint32_t>(size >> (log2 - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+        fl = log2 - SL_INDEX_COUNT_LOG2 + 1;
+    }
+
+    uint32_t TlsfAllocator::FindSuitable(uint64_t size) {
+        // Round up to the next size class, so that any range of the class found is large enough.
+        if(size >= SL_INDEX_COUNT) {
+            size += (1ull << (Log2(size) - SL_INDEX_COUNT_LOG2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        Mapping(size, fl, sl);
+        if(fl >= FL_INDEX_COUNT) {
+            return INVALID_NODE;
+        }
+
+        uint32_t sl_map = m_SlBitmaps[fl] & (~0u << sl);
+        if(sl_map == 0) {
+            const uint64_t fl_map = fl + 1 < 64 ? m_FlBitmap & (~0ull << (fl + 1)) : 0;
+            if(fl_map == 0) {
+                return INVALID_NODE;
+            }
+            fl = __builtin_ctzll(fl_map);
+            sl_map = m_SlBitmaps[fl];
+        }
+        sl = __builtin_ctz(sl_map);
+
+        return m_FreeHeads[fl][sl];
+    }
+
+    uint32_t TlsfAllocator::NewNode(uint64_t offset, uint64_t size) {
+        uint32_t index;
+        if(!m_UnusedNodes.empty()) {
+            index = m_UnusedNodes.back();
+            m_UnusedNodes.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_Nodes.size());
+            m_Nodes.emplace_back();
+        }
+        m_Nodes[index] = Node_t{ offset, size, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false };
+        return index;
+    }
+
+    void TlsfAllocator::ReleaseNode(uint32_t node) {
+        m_UnusedNodes.push_back(node);
+    }
+
+    void TlsfAllocator::InsertFree(uint32_t node) {
+        uint32_t fl, sl;
+        Mapping(m_Nodes[node].Size, fl, sl);
+
+        const uint32_t head = m_FreeHeads[fl][sl];
+        m_Nodes[node].IsFree = true;
+        m_Nodes[node].PrevFree = INVALID_NODE;
+        m_Nodes[node].NextFree = head;
+        if(head != INVALID_NODE) {
+            m_Nodes[head].PrevFree = node;
+        }
+        m_FreeHeads[fl][sl] = node;
+
+        m_FlBitmap |= 1ull << fl;
+        m_SlBitmaps[fl] |= 1u << sl;
+    }
+
+    void TlsfAllocator::RemoveFree(uint32_t node) {
+        uint32_t fl, sl;
+        Mapping(m_Nodes[node].Size, fl, sl);
+
+        const uint32_t prev = m_Nodes[node].PrevFree;
+        const uint32_t next = m_Nodes[node].NextFree;
+        if(prev != INVALID_NODE) {
+            m_Nodes[prev].NextFree = next;
+        }
+        if(next != INVALID_NODE) {
+            m_Nodes[next].PrevFree = prev;
+        }
+        if(m_FreeHeads[fl][sl] == node) {
+            m_FreeHeads[fl][sl] = next;
+            if(next == INVALID_NODE) {
+                m_SlBitmaps[fl] &= ~(1u << sl);
+                if(m_SlBitmaps[fl] == 0) {
+                    m_FlBitmap &= ~(1ull << fl);
+                }
+            }
+        }
+
+        m_Nodes[node].IsFree = false;
+        m_Nodes[node].PrevFree = INVALID_NODE;
+        m_Nodes[node].NextFree = INVALID_NODE;
+    }
+
+    uint32_t TlsfAllocator::Split(uint32_t node, uint64_t size) {
+        const uint32_t tail = NewNode(m_Nodes[node].Offset + size, m_Nodes[node].Size - size); // May reallocate m_Nodes.
+
+        const uint32_t next = m_Nodes[node].NextPhysical;
+        m_Nodes[tail].PrevPhysical = node;
+        m_Nodes[tail].NextPhysical = next;
+        if(next != INVALID_NODE) {
+            m_Nodes[next].PrevPhysical = tail;
+        }
+        m_Nodes[node].NextPhysical = tail;
+        m_Nodes[node].Size = size;
+
+        return tail;
+    }
+
+    void TlsfAllocator::Merge(uint32_t node, uint32_t next) {
+        m_Nodes[node].Size += m_Nodes[next].Size;
+
+        const uint32_t after = m_Nodes[next].NextPhysical;
+        m_Nodes[node].NextPhysical = after;
+        if(after != INVALID_NODE) {
+            m_Nodes[after].PrevPhysical = node;
+        }
+
+        ReleaseNode(next);
+    }
+
+}
@@ -0,0 +1,84 @@
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <cstdint>
+#include <vector>
+
+namespace gigno {
+
+    /*
+    Two-Level Segregated Fit range allocator. Hands out aligned [offset, offset + size) ranges of a fixed size space,
+    in constant time for both allocation and free.
+
+    Only book-keeping : it never touches the memory it manages, so it can be used for memory the cpu cannot read
+    (GPU memory blocks). Block metadata lives in a node pool on the side.
+
+    Usage :
+        * Allocate(...) returns a node handle identifying the range. Pass it back to Free(...).
+        * Free ranges are merged with their physical neighbours on Free(...).
+    */
+    class TlsfAllocator {
+    public:
+        static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+        TlsfAllocator(uint64_t size);
+
+        /*
+        @param alignment must be a power of two.
+        @param offset set to the aligned start of the range on success.
+        @returns the node handle of the range, or INVALID_NODE if no free range is large enough.
+        */
+        uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+        void Free(uint32_t node);
+
+        uint64_t GetSize() const { return m_Size; }
+        uint64_t GetUsedBytes() const { return m_UsedBytes; }
+        uint32_t GetAllocationCount() const { return m_AllocationCount; }
+        bool IsEmpty() const { return m_AllocationCount == 0; }
+
+    private:
+        static constexpr uint32_t SL_INDEX_COUNT_LOG2 = 4;
+        static constexpr uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+        static constexpr uint32_t FL_INDEX_COUNT = 64 - SL_INDEX_COUNT_LOG2 + 1;
+        // Remainders smaller than this are kept inside the allocated range instead of becoming a free range.
+        static constexpr uint64_t MIN_SPLIT_SIZE = 16;
+
+        struct Node_t {
+            uint64_t Offset;
+            uint64_t Size;
+            uint32_t PrevPhysical;
+            uint32_t NextPhysical;
+            uint32_t PrevFree;
+            uint32_t NextFree;
+            bool IsFree;
+        };
+
+        static void Mapping(uint64_t size, uint32_t &fl, uint32_t &sl);
+        uint32_t FindSuitable(uint64_t size);
+
+        uint32_t NewNode(uint64_t offset, uint64_t size);
+        void ReleaseNode(uint32_t node);
+
+        void InsertFree(uint32_t node);
+        void RemoveFree(uint32_t node);
+
+        // Splits 'node' at 'size'. The second half becomes a new node, outside of the free lists. Returns it.
+        uint32_t Split(uint32_t node, uint64_t size);
+        // Merges 'next' into 'node'. Both must be physical neighbours and out of the free lists.
+        void Merge(uint32_t node, uint32_t next);
+
+        uint64_t m_Size;
+        uint64_t m_UsedBytes = 0;
+        uint32_t m_AllocationCount = 0;
+
+        uint64_t m_FlBitmap = 0;
+        uint32_t m_SlBitmaps[FL_INDEX_COUNT]{};
+        uint32_t m_FreeHeads[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+        std::vector<Node_t> m_Nodes;
+        std::vector<uint32_t> m_UnusedNodes;
+    };
+
+}
+
+#endif
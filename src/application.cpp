@@ -1,6 +1,7 @@
 #include "error_macros.h"
 #include <numeric>
 #include <chrono>
+#include <limits>
 #include "entities/dome_camera.h"
 #include "entities/spinner.h"
 #include "entities/lights/directional_light.h"
@@ -13,12 +14,14 @@
 
 namespace gigno {
 
-	Application::Application(int winw, int winh, const char *title, const std::string &vertShaderPath, const std::string &fragShaderPath) :
+	Application::Application(int winw, int winh, const char *title, const std::string &vertShaderPath, const std::string &fragShaderPath, RenderingMode_t renderingMode) :
 		m_DebugServer{},
 		m_InputServer{},
-		m_RenderingServer{ winw, winh, title, &m_InputServer, vertShaderPath, fragShaderPath },
+		m_RenderingServer{ winw, winh, title, &m_InputServer, vertShaderPath, fragShaderPath, renderingMode },
 		m_EntityServer{} {
-
+			if (renderingMode == RENDERING_MODE_HEADLESS) {
+				m_FrameLimit = HEADLESS_DEFAULT_FRAME_LIMIT;
+			}
 		}
 
 	Application::~Application() {}
@@ -27,8 +30,8 @@ namespace gigno {
 		return &m_EntityServer;
 	}
 
-	Application *Application::MakeApp() {
-		Application *app = new Application(1000, 1000, "Gigno Engine Demo", "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv");
+	Application *Application::MakeApp(RenderingMode_t renderingMode) {
+		Application *app = new Application(1000, 1000, "Gigno Engine Demo", "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv", renderingMode);
 		s_Instance = app;
 		return app;
 	}
@@ -40,42 +43,46 @@ namespace gigno {
 	int Application::run() {
 		Debug()->GetConsole()->StartFileLogging();
 
-		ASSERT_MSG_V(glfwInit(), 1, "GLFW Failed to init");
+		const bool headless = m_RenderingServer.IsHeadless();
+		if (!headless) {
+			ASSERT_MSG_V(glfwInit(), 1, "GLFW Failed to init");
+		}
+		ASSERT_MSG_V(!headless || m_FrameLimit > 0, 1, "A headless application requires a frame limit.");
 
 
-		RenderedEntity first{ModelData_t::FromObjFile("models/smooth_vase.obj")};
+		RenderedEntity first{"models/smooth_vase.obj"};
 		first.Transform.Position = glm::vec3{ 0.0f, 0.0f, 0.0f };
 		first.Transform.Scale = glm::vec3{ 3.0f, -1.5f, 3.0f };
 		first.Transform.Rotation = glm::vec3(0.0f, 0.0f, 0.0f);
 		float rot = 0;
 		float y = -5.0f;
 
-		RenderedEntity second{ModelData_t::FromObjFile("models/flat_vase.obj")};
+		RenderedEntity second{"models/flat_vase.obj"};
 		second.Transform.Position = glm::vec3{ 1.0f, 0.5f, 1.0f };
 		second.Transform.Scale = glm::vec3{3.0f, 3.0f, 3.0f};
 		second.Transform.Rotation = glm::vec3(glm::radians(-90.0f), glm::radians(180.0f), glm::radians(-50.0f));
 
-		Spinner third{ModelData_t::FromObjFile("models/colored_cube.obj")};
+		Spinner third{"models/colored_cube.obj"};
 		third.Transform.Position = glm::vec3{-0.5f, 0.75f, -0.5f};
 		third.Transform.Scale = glm::vec3{.2f, .2f, .2f};
 		third.Transform.Rotation = glm::vec3(0.0f, glm::radians(55.0f), 0.0f);
 		third.Speed = glm::two_pi<float>();
 
-		Spinner fourth{ModelData_t::FromObjFile("models/smooth_vase.obj")};
+		Spinner fourth{"models/smooth_vase.obj"};
 		fourth.Transform.Position = glm::vec3{0.5f, 0.0f, 0.5f};
 		fourth.Transform.Scale = glm::vec3{3.0f, 2.0f, 3.0f};
 		fourth.Transform.Rotation = glm::vec3(0.0f, 0.0f, 0.0f);
 		second.Name = "Upside-down";
 		fourth.Speed = 0.5f * glm::two_pi<float>();
 
-		RenderedEntity fifth{ModelData_t::FromObjFile("models/smooth_vase.obj")};
+		RenderedEntity fifth{"models/smooth_vase.obj"};
 		fifth.Transform.Position = glm::vec3{0.5f, 2.0f, 0.5f};
 		fifth.Transform.Scale = glm::vec3{3.0f, 2.0f, 3.0f};
 		fifth.Transform.Rotation = glm::vec3(0.0f, 0.0f, 0.0f);
 		second.Name = "Upside-down above";
 
 		DomeCamera camera(10.0f);
-		camera.SetPerspectiveProjection(glm::radians(50.0f), m_RenderingServer.GetAspectRatio(), -0.05f, 1.0f);
+		camera.SetPerspectiveProjection(glm::radians(50.0f), m_RenderingServer.GetAspectRatio(), 0.05f, 100.0f);
 		camera.Transform.Position = { 0.0f, 0.0f, -3.0f };
 		camera.Transform.Rotation.y = 0;
 		camera.SetTarget( (first.Transform.Position + second.Transform.Position + third.Transform.Position + fourth.Transform.Position) * 0.25f );
@@ -99,10 +106,19 @@ namespace gigno {
 
 
 		Debug()->GetConsole()->LogInfo(MESSAGE_NO_FILE_LOG_BIT, "Secret shhhhhh.");
-		while (!m_RenderingServer.WindowShouldClose()) {
+
+		// Frame times, in milliseconds. Reported at the end of a frame-limited (benchmark) run.
+		uint32_t frame_count = 0;
+		double total_frame_time = 0.0;
+		double min_frame_time = std::numeric_limits<double>::max();
+		double max_frame_time = 0.0;
+
+		while (!m_RenderingServer.WindowShouldClose() && (m_FrameLimit == 0 || frame_count < m_FrameLimit)) {
+			auto frame_start_time = std::chrono::steady_clock::now();
 
 			Debug()->Profiler()->Begin("Main Loop");
 
+			m_RenderingServer.WaitForNextFrame(); // Right before the input is sampled.
 			m_RenderingServer.PollEvents();
 			m_InputServer.UpdateInput();
 
@@ -122,10 +138,10 @@ namespace gigno {
 
 			last_update_time = current_time;
 
-			m_RenderingServer.DrawLineGradient(glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 1.0f}, glm::vec3{1.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}, UNIQUE_NAME);
-			m_RenderingServer.DrawLineGradient(glm::vec3{0.0f, 1.0f, 1.0f}, glm::vec3{0.5f, 1.0f, 0.5f}, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, UNIQUE_NAME);
-			m_RenderingServer.DrawLineGradient(glm::vec3{0.5f, 1.0f, 0.5f}, glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{1.0f, 0.0f, 0.0f}, UNIQUE_NAME);
-			m_RenderingServer.DrawPoint(bulb.Transform.Position, glm::vec3{1.0f, 1.0f, 1.0f}, UNIQUE_NAME);
+			m_RenderingServer.DrawLineGradient(glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 1.0f}, glm::vec3{1.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 1.0f}, DEBUG_DRAW_ID);
+			m_RenderingServer.DrawLineGradient(glm::vec3{0.0f, 1.0f, 1.0f}, glm::vec3{0.5f, 1.0f, 0.5f}, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, DEBUG_DRAW_ID);
+			m_RenderingServer.DrawLineGradient(glm::vec3{0.5f, 1.0f, 0.5f}, glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{1.0f, 0.0f, 0.0f}, DEBUG_DRAW_ID);
+			m_RenderingServer.DrawPoint(bulb.Transform.Position, glm::vec3{1.0f, 1.0f, 1.0f}, DEBUG_DRAW_ID);
 
 			m_EntityServer.Tick(delta_time.count() * 10e-1f); // For some reason, it seems that to get second we need
 															  //  to multiply by 10e-1f and not the expected 10e-6f !
@@ -138,10 +154,26 @@ namespace gigno {
 			Debug()->Profiler()->End(); //Main Loop
 
 			Debug()->Update();
+
+			double frame_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start_time).count();
+			total_frame_time += frame_time;
+			min_frame_time = glm::min(min_frame_time, frame_time);
+			max_frame_time = glm::max(max_frame_time, frame_time);
+			frame_count++;
 		}
 
 		m_RenderingServer.Finalize();
 
+		if (m_FrameLimit > 0 && frame_count > 0) {
+			Debug()->GetConsole()->LogInfo("Rendered %u frames. Frame time (ms) : average %.3f, min %.3f, max %.3f.",
+				frame_count, total_frame_time / frame_count, min_frame_time, max_frame_time);
+		}
+		if (headless && !m_CaptureFilePath.empty()) {
+			if (m_RenderingServer.CaptureFrame(m_CaptureFilePath.c_str())) {
+				Debug()->GetConsole()->LogInfo("Last frame written to '%s'.", m_CaptureFilePath.c_str());
+			}
+		}
+
 		return 0;
 	}
 
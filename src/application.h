@@ -5,6 +5,7 @@
 #include "entities/entity_server.h"
 #include "input/input_server.h"
 #include "debug/debug_server.h"
+#include "threading/thread_pool.h"
 #include "rendering/model.h"
 #include "iostream"
 
@@ -12,7 +13,11 @@ namespace gigno {
 
 	class Application {
 	public:
-		static Application *MakeApp();
+		/*
+		@param renderingMode RENDERING_MODE_HEADLESS renders offscreen, without window nor presentation. A headless
+		                     app exits after its frame limit (see SetFrameLimit()).
+		*/
+		static Application *MakeApp(RenderingMode_t renderingMode = RENDERING_MODE_WINDOWED);
 		static void ShutdownApp();
 
 		static Application *Singleton();
@@ -24,20 +29,31 @@ namespace gigno {
         EntityServer *GetEntityServer();
         InputServer *GetInputServer() { return &m_InputServer; }
 		DebugServer *Debug() { return &m_DebugServer; }
+		ThreadPool *GetThreadPool() { return &m_ThreadPool; }
+
+		// Number of frames after which run() returns. 0 = no limit (not allowed when headless).
+		void SetFrameLimit(uint32_t frameCount) { m_FrameLimit = frameCount; }
+		// Headless only : when not empty, the last frame is written to this path (PPM) before run() returns.
+		void SetCaptureFilePath(const std::string &path) { m_CaptureFilePath = path; }
 
 	private:
 
-		Application(int winw, int winh, const char *title, const std::string &vertShaderPath, const std::string &fragShaderPath);
+		Application(int winw, int winh, const char *title, const std::string &vertShaderPath, const std::string &fragShaderPath, RenderingMode_t renderingMode);
 		~Application();
 
 		bool m_ShowMainUIWindow = true;
 		void DrawMainUIWindow();
 
         const float MAX_FRAME_TIME = 1000.0f;
+		const uint32_t HEADLESS_DEFAULT_FRAME_LIMIT = 500;
+
+		uint32_t m_FrameLimit = 0;
+		std::string m_CaptureFilePath{};
 
 		static inline Application *s_Instance = nullptr;
 
 		DebugServer m_DebugServer;
+		ThreadPool m_ThreadPool; // Must outlive the servers using it.
         InputServer m_InputServer; // Must be init before rendering server !
 		RenderingServer m_RenderingServer;
         EntityServer m_EntityServer;
@@ -35,6 +35,7 @@ namespace gigno {
 
     CONSOLE_COMMAND_HELP(cls, "Usage : clears the console from every messages.") {
         Console *console = Application::Singleton()->Debug()->GetConsole();
+        std::lock_guard<std::recursive_mutex> lock{ console->m_Mutex };
         console->m_Messages.clear();
     }
 
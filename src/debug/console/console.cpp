@@ -45,6 +45,7 @@ namespace gigno {
 
     void Console::Log(const char *msg, ConsoleMessageType_t type, ConsoleMessageFlags_t flags) {
     #if USE_CONSOLE
+        std::lock_guard<std::recursive_mutex> lock{ m_Mutex };
         size_t msg_size = strlen(msg) + 1;
         ConsoleMessage_t &message = m_Messages.emplace_back(msg_size);
         memcpy(message.Message.get(), msg, msg_size);
@@ -64,6 +65,7 @@ namespace gigno {
 
     void Console::LogFormat(const char *fmt, ConsoleMessageType_t type, ConsoleMessageFlags_t flags, ...) {
     #if USE_CONSOLE
+        std::lock_guard<std::recursive_mutex> lock{ m_Mutex };
         va_list params;
         va_list params2;
         va_start(params, flags);
@@ -116,6 +118,7 @@ namespace gigno {
 
     bool Console::StartFileLogging() {
         #if USE_CONSOLE
+        std::lock_guard<std::recursive_mutex> lock{ m_Mutex };
         if(m_IsLoggingToFile) {
             return true;
         }
@@ -143,6 +146,7 @@ namespace gigno {
 
     bool Console::StopFileLogging() {
         #if USE_CONSOLE
+        std::lock_guard<std::recursive_mutex> lock{ m_Mutex };
         if(!m_IsLoggingToFile) {
             return true;
         }
@@ -209,6 +213,7 @@ namespace gigno {
     #if USE_IMGUI
     void Console::DrawConsoleTab() {
         #if USE_CONSOLE
+        std::lock_guard<std::recursive_mutex> lock{ m_Mutex };
 
         if(ImGui::Button("Clear")) { m_Messages.clear(); }
         ImGui::SameLine();
@@ -9,6 +9,7 @@
 #include <ctime>
 #include <fstream>
 #include <filesystem>
+#include <mutex>
 
 namespace gigno {
     enum ConsoleMessageType_t {
@@ -130,6 +131,8 @@ namespace gigno {
     #if USE_CONSOLE
         bool m_ShowTimepoints = true;
         std::vector<ConsoleMessage_t> m_Messages{};
+        // Messages can be logged from any thread (jobs of the ThreadPool). Recursive : commands log while the console tab is drawn.
+        std::recursive_mutex m_Mutex;
         std::ofstream m_FileStream;
         bool m_IsLoggingToFile = false;
         bool m_UIFileLoggingCheckbox;
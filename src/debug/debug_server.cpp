@@ -34,6 +34,12 @@ namespace gigno {
                         ImGui::EndTabItem();
                     }
                     #endif
+                    if(ImGui::BeginTabItem("Render Stats")) {
+                        if(Application* app = Application::Singleton()) {
+                            app->GetRenderer()->GetRenderStats().DrawStatsTab();
+                        }
+                        ImGui::EndTabItem();
+                    }
                     if(ImGui::BeginTabItem("Inspector")) {
                         if(Application* app = Application::Singleton()) {
                             app->GetEntityServer()->DrawEntityInspectorTab();
@@ -28,8 +28,10 @@ namespace gigno {
         auto actual_start = std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTime).time_since_epoch();
         auto actual_end = std::chrono::time_point_cast<std::chrono::microseconds>(end_time).time_since_epoch();
 
-        auto duration = actual_end - actual_start;
+        AddCall(actual_end - actual_start);
+    }
 
+    void ProfileScope::AddCall(std::chrono::microseconds duration) {
         m_CurrentFrameDuration += duration;
         m_CallCountThisFrame++;
         if(duration.count() > m_MaxPerCallDuration){
@@ -105,8 +107,8 @@ namespace gigno {
 
         // No child with the same name exist.
         m_Children.emplace_back(name).SetEscape(this);
-        m_Children.front().Start();
-        return &m_Children.front();
+        m_Children.back().Start();
+        return &m_Children.back();
     }
 
     ProfileScope *ProfileScope::End() {
@@ -28,6 +28,8 @@ namespace gigno
         */
         void Start();
         void Stop();
+        // Records a call measured elsewhere (GPU scopes).
+        void AddCall(std::chrono::microseconds duration);
 
         /*
         @brief Called once per frame before DrawUI.
@@ -43,11 +43,57 @@ namespace gigno {
         #endif
     }
 
+    void ProfilingServer::SetCounter(const char *name, int64_t value) {
+        #if USE_PROFILER
+        for (std::pair<std::string, int64_t> &counter : m_Counters) {
+            if (counter.first == name) {
+                counter.second = value;
+                return;
+            }
+        }
+        m_Counters.emplace_back(name, value);
+        #endif
+    }
+
+    void ProfilingServer::SubmitGpuScopes(const GpuScopeTiming_t *timings, uint32_t count) {
+        #if USE_PROFILER
+        // Scopes opened along the path to the current one, by depth.
+        std::vector<ProfileScope *> path;
+        for (uint32_t i = 0; i < count; i++) {
+            const GpuScopeTiming_t &timing = timings[i];
+            if (timing.Depth > path.size()) {
+                continue; // Parent missing : cannot be placed.
+            }
+            path.resize(timing.Depth);
+
+            ProfileScope *scope = nullptr;
+            if (path.empty()) {
+                for (ProfileScope &root : m_GpuRootScopes) {
+                    if (root.GetName() == timing.Name) {
+                        scope = &root;
+                        break;
+                    }
+                }
+                if (!scope) {
+                    scope = &m_GpuRootScopes.emplace_back(timing.Name);
+                }
+            } else {
+                scope = path.back()->BeginChild(timing.Name);
+            }
+            scope->AddCall(std::chrono::microseconds{ static_cast<int64_t>(timing.DurationUs) });
+            path.push_back(scope);
+        }
+        #endif
+    }
+
     void ProfilingServer::EndFrame() {
     #if USE_PROFILER
         for(ProfileScope &scope : m_RootScopes) {
             scope.EndFrame();
         }
+        for (ProfileScope &scope : m_GpuRootScopes) {
+            scope.EndFrame();
+        }
     #endif
     }
 
@@ -60,6 +106,20 @@ namespace gigno {
         for (ProfileScope scope : m_RootScopes) {
             scope.DrawUI();
         }
+
+        if (!m_GpuRootScopes.empty()) {
+            ImGui::SeparatorText("GPU");
+            for (ProfileScope scope : m_GpuRootScopes) {
+                scope.DrawUI();
+            }
+        }
+
+        if (!m_Counters.empty()) {
+            ImGui::SeparatorText("Counters");
+            for (const std::pair<std::string, int64_t> &counter : m_Counters) {
+                ImGui::Text("%s : %lld", counter.first.c_str(), (long long)counter.second);
+            }
+        }
     #endif        
     }
 
@@ -68,6 +128,9 @@ namespace gigno {
         for (ProfileScope &scope : m_RootScopes) {
             scope.StartFrame();
         }
+        for (ProfileScope &scope : m_GpuRootScopes) {
+            scope.StartFrame();
+        }
     #endif
     }
 
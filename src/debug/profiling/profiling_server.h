@@ -6,9 +6,17 @@
 #include <unordered_map>
 #include "../../features_usage.h"
 #include <string>
+#include <cstdint>
 
 namespace gigno {
 
+    // Duration of a GPU scope, measured with timestamp queries (see GpuProfiler).
+    struct GpuScopeTiming_t {
+        const char *Name;
+        uint32_t Depth;   // 0 for the frame's outermost scopes. A scope's parent is the closest previous scope of lower depth.
+        float DurationUs;
+    };
+
     /*
         System allowing you to profile/analyse the performance of part of your code.
 
@@ -19,6 +27,8 @@ namespace gigno {
               * Begin(...) : Begins a Child Profiling Scope in the hierarchy Its data will be 
                             In the profiler window.
               * End() : Stops the current Profiling Scope (required !)
+              * SetCounter(...) : Sets a named per-frame value (draw counts, culled objects, ...) shown under the scopes.
+              * SubmitGpuScopes(...) : Sets the GPU scopes of a frame, shown in their own tree under the CPU scopes.
               * EndFrame() : Must be called at the end of every frame of the main loop.
     */
     class ProfilingServer {
@@ -36,6 +46,18 @@ namespace gigno {
         void Begin(const std::string &uniqueName);
         void End();
 
+        /*
+        @brief Sets the value shown for a counter in the Profiler window. Counters keep their last value until set again.
+        */
+        void SetCounter(const char *name, int64_t value);
+
+        /*
+        @brief Records the GPU durations of a frame. They are read back once the GPU is done with the frame : they lag the CPU
+             scopes by the number of frames in flight.
+        @param timings in the order the scopes began.
+        */
+        void SubmitGpuScopes(const GpuScopeTiming_t *timings, uint32_t count);
+
         void EndFrame();
         void DrawProfilerTab();
         void StartFrame();
@@ -47,6 +69,12 @@ namespace gigno {
 
         ProfileScope *m_pActiveScope = nullptr;
 
+        // Separate from m_RootScopes : GPU scopes are submitted while CPU scopes are active, and must not move them.
+        std::vector<ProfileScope> m_GpuRootScopes;
+
+        // In creation order, as shown in the Profiler window.
+        std::vector<std::pair<std::string, int64_t>> m_Counters;
+
     #endif
     };
 
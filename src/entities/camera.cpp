@@ -24,6 +24,8 @@ namespace gigno {
 
 	void Camera::SetOrthographicProjection(float left, float right, float top, float bottom, float near, float far) {
 		m_ProjMode = PROJECTION_MODE_ORTHOGRAPHIC;
+		m_Near = near;
+		m_Far = far;
 
 		m_ProjectionMatrix = glm::mat4{ 1.0f };
 		m_ProjectionMatrix[0][0] = 2.f / (right - left);
@@ -37,6 +39,8 @@ namespace gigno {
 	void Camera::SetPerspectiveProjection(float fovy, float aspect, float near, float far) {
 		m_ProjMode = PROJECTION_MODE_PERSPECTIVE;
 		m_CurrentFovy = fovy;
+		m_Near = near;
+		m_Far = far;
 
 		const float tan_half_fovy = tan(fovy / 2.f);
 		m_ProjectionMatrix = glm::mat4{ 1.0f };
@@ -38,6 +38,9 @@ namespace gigno {
 		void SetLookInTransformForward();
 
 		glm::mat4 GetProjection() const { return m_ProjectionMatrix; }
+		// Of the last projection set. A perspective projection with near <= 0 does not clip anything past far.
+		float GetNear() const { return m_Near; }
+		float GetFar() const { return m_Far; }
 		glm::mat4 GetViewMatrix() const;
 
 		void SetAsCurrentCamera();
@@ -47,6 +50,8 @@ namespace gigno {
 	private:
 		ProjectionMode_t m_ProjMode = PROJECTION_MODE_NONE;
 		float m_CurrentFovy = 0.0f;
+		float m_Near = 0.0f;
+		float m_Far = 1.0f;
 
 		LookMode_t m_LookMode = LOOK_MODE_TRANSFORM_FORWARD;
 		glm::vec3 m_LookPoint = {};
@@ -21,6 +21,11 @@ namespace gigno {
 
 		glm::mat4 TransformationMatrix() const;
 		glm::mat3 NormalMatrix() const;
+
+		bool operator==(const Transform_t &other) const {
+			return other.Position == Position && other.Scale == Scale && other.Rotation == Rotation;
+		}
+		bool operator!=(const Transform_t &other) const { return !(*this == other); }
 	};
 
 	/*
@@ -3,8 +3,9 @@
 
 namespace gigno {
 
-    void DirectionalLight::FillDataSlots(glm::vec4 *data) const {
-        data[0] = glm::vec4{-Direction * Intensity, LIGHT_DATA_DIRECTIONAL};
+    void DirectionalLight::FillLightData(LightData_t &data) const {
+        data.PositionOrDirection = glm::vec4{-Direction, LIGHT_DATA_DIRECTIONAL};
+        data.Parameters = glm::vec4{Intensity, 0.0f, 0.0f, 0.0f};
     }
 
 }
\ No newline at end of file
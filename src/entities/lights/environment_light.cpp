@@ -2,8 +2,9 @@
 
 namespace gigno {
 
-    void EnvironmentLight::FillDataSlots(glm::vec4 *data) const {
-        data[0] = glm::vec4{intensity, 0.0f, 0.0f, LIGHT_DATA_ENVIRONMENT};
+    void EnvironmentLight::FillLightData(LightData_t &data) const {
+        data.PositionOrDirection = glm::vec4{0.0f, 0.0f, 0.0f, LIGHT_DATA_ENVIRONMENT};
+        data.Parameters = glm::vec4{intensity, 0.0f, 0.0f, 0.0f};
     }
 
 }
\ No newline at end of file
@@ -13,8 +13,7 @@ namespace gigno {
 
         float intensity = 0.1f;
 
-        virtual uint32_t DataSlotsCount() const override { return 1; }
-        virtual void FillDataSlots(glm::vec4 *data) const override;
+        virtual void FillLightData(LightData_t &data) const override;
     };
 
     DEFINE_SERIALIZATION(EnvironmentLight) {
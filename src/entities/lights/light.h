@@ -9,14 +9,23 @@ namespace gigno {
     const float LIGHT_DATA_POINT = 2.0f;
     const float LIGHT_DATA_ENVIRONMENT = 3.0f;
 
+    /*
+    One light, as read by the shaders (std430, see the light buffer in simple_shader.frag).
+    */
+    struct LightData_t {
+        glm::vec4 PositionOrDirection{}; // w : LIGHT_DATA_*.
+        glm::vec4 Parameters{};          // x : intensity. y : range, for local lights.
+    };
+
     class Light : public Entity {
         ENABLE_SERIALIZATION(Light);
     public:
         Light();
         ~Light();
 
-        virtual uint32_t DataSlotsCount() const = 0;
-        virtual void FillDataSlots(glm::vec4 *data) const = 0;
+        // Distance past which the light has no effect. 0 if it lights the whole scene : only local lights are binned into clusters.
+        virtual float GetRange() const { return 0.0f; }
+        virtual void FillLightData(LightData_t &data) const = 0;
 
     private:
     };
@@ -1,5 +1,8 @@
 #include "point_light.h"
 
+#include <cmath>
+#include <algorithm>
+
 namespace gigno {
 
     PointLight::PointLight() : Light() {
@@ -8,9 +11,17 @@ namespace gigno {
 
     PointLight::~PointLight() { }
 
-    void PointLight::FillDataSlots(glm::vec4 *data) const {
-        data[0] = {Transform.Position, LIGHT_DATA_POINT};
-        data[1] = {glm::vec3{Intensity}, LIGHT_DATA_POINT};
+    float PointLight::GetRange() const {
+        if (Range > 0.0f) {
+            return Range;
+        }
+        // Intensity / distance^2 == POINT_LIGHT_CUTOFF
+        return std::sqrt(std::max(Intensity, 0.0f) / POINT_LIGHT_CUTOFF);
+    }
+
+    void PointLight::FillLightData(LightData_t &data) const {
+        data.PositionOrDirection = {Transform.Position, LIGHT_DATA_POINT};
+        data.Parameters = {Intensity, GetRange(), 0.0f, 0.0f};
     }
 
 }
\ No newline at end of file
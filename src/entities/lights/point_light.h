@@ -5,16 +5,20 @@
 
 namespace gigno {
 
+    // Intensity under which a point light is considered to have no effect anymore.
+    const float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
+
     class PointLight : public Light {
         ENABLE_SERIALIZATION(PointLight);
     public:
         PointLight();
         ~PointLight();
 
-        virtual uint32_t DataSlotsCount() const override { return 2; };
-        virtual void FillDataSlots(glm::vec4 *data) const override;
+        virtual float GetRange() const override;
+        virtual void FillLightData(LightData_t &data) const override;
 
         float Intensity = 1.0f;
+        float Range = 0.0f; // 0 : where the light falls under POINT_LIGHT_CUTOFF.
     };
 
     DEFINE_SERIALIZATION(PointLight) {
@@ -10,6 +10,13 @@ namespace gigno {
 		GetApp()->GetRenderer()->CreateModel(pModel, modelData);
 	}
 
+	RenderedEntity::RenderedEntity(const std::string &modelPath, const ModelImportOptions_t &importOptions) :
+		Entity() {
+
+		GetApp()->GetRenderer()->SubscribeRenderedEntity(this);
+		pModel = GetApp()->GetRenderer()->RequestModel(modelPath, importOptions);
+	}
+
 	RenderedEntity::~RenderedEntity() {
 		GetApp()->GetRenderer()->UnsubscribeRenderedEntity(this);
 	}
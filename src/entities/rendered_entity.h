@@ -3,7 +3,7 @@
 
 #include "entity.h"
 #include <memory>
-#include "../rendering/model.h"
+#include "../rendering/mesh_cache.h"
 
 namespace gigno {
 
@@ -11,13 +11,19 @@ namespace gigno {
 		ENABLE_SERIALIZATION(RenderedEntity);
 	public:
 		RenderedEntity(ModelData_t modelData);
+		// The model is shared with every other entity using the same file and options. It is loaded on the thread pool : the entity
+		// is not drawn until it is resident (see RenderingServer::RequestModel()).
+		RenderedEntity(const std::string &modelPath, const ModelImportOptions_t &importOptions = {});
 		~RenderedEntity();
 
-		std::shared_ptr<giModel> pModel;
+		MeshHandle pModel;
 
 		// Next rendered entity in the RenderingServer's chain of all rendered entities (linked list). Set on construction.
 		// 'nullptr' if is last element.
 		RenderedEntity *pNextRenderedEntity{};
+
+		// Slot of the entity's ObjectData_t in the renderer's object buffers. Set on construction, stable until destruction.
+		uint32_t ObjectIndex = 0;
 	};
 
 	DEFINE_SERIALIZATION(RenderedEntity) {
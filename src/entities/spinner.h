@@ -7,6 +7,7 @@ namespace gigno {
         ENABLE_SERIALIZATION(Spinner);
     public:
         Spinner(ModelData_t modelData) : RenderedEntity(modelData) {}
+        Spinner(const std::string &modelPath, const ModelImportOptions_t &importOptions = {}) : RenderedEntity(modelPath, importOptions) {}
 
         float Speed = 2.0f;
 
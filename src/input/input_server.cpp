@@ -14,6 +14,9 @@ namespace gigno {
 	}
 
 	void InputServer::UpdateInput() {
+		if(!m_pWindow) {
+			return; // Headless : no window to read keys from, every key stays released.
+		}
 		for(int i = 0; i < KEY_MAX_ENUM; i++) {
 			int new_state = glfwGetKey(m_pWindow, i);
 			if(new_state == GLFW_PRESS) {
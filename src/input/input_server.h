@@ -31,8 +31,8 @@ namespace gigno {
 		bool GetKeyDown(Key_t key);
 
 	private:
-		GLFWwindow* m_pWindow;
-		KeyState_t m_KeyStates[KEY_MAX_ENUM];
+		GLFWwindow* m_pWindow = nullptr;
+		KeyState_t m_KeyStates[KEY_MAX_ENUM]{};
 	};
 
 }
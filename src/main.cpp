@@ -1,10 +1,39 @@
 #include "application.h"
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
-int main() {
+/*
+Command line :
+	--headless            Render offscreen, without window (see RENDERING_MODE_HEADLESS).
+	--frames <count>      Exit after <count> frames.
+	--capture <file.ppm>  Headless only. Writes the last frame to <file.ppm>.
+*/
+int main(int argc, char **argv) {
+	gigno::RenderingMode_t rendering_mode = gigno::RENDERING_MODE_WINDOWED;
+	uint32_t frame_limit = 0;
+	const char *capture_path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			rendering_mode = gigno::RENDERING_MODE_HEADLESS;
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frame_limit = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			capture_path = argv[++i];
+		} else {
+			printf("Unknown argument '%s' ignored.\n", argv[i]);
+		}
+	}
  
-	gigno::Application *app = gigno::Application::MakeApp();
+	gigno::Application *app = gigno::Application::MakeApp(rendering_mode);
+	if (frame_limit > 0) {
+		app->SetFrameLimit(frame_limit);
+	}
+	if (capture_path) {
+		app->SetCaptureFilePath(capture_path);
+	}
 
 	int result = app->run();
 
@@ -0,0 +1,377 @@
+#include "debug_drawer.h"
+#include "rendering_utils.h"
+#include "../application.h"
+
+#include "glm/gtc/constants.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+namespace gigno {
+
+	static_assert(sizeof(DebugShapeInstance_t) % 16 == 0, "Shape instances are written back to back, 16 bytes aligned.");
+
+	// Segments of each great circle of the unit sphere.
+	const uint32_t DEBUG_SPHERE_SEGMENTS = 32;
+	// Of the arrow's head, relative to its length.
+	const float DEBUG_ARROW_HEAD_LENGTH = 0.2f;
+	const float DEBUG_ARROW_HEAD_RADIUS = 0.08f;
+
+	DebugShapeInstance_t DebugBox(glm::vec3 center, glm::vec3 halfExtents, glm::vec3 color) {
+		DebugShapeInstance_t instance{};
+		instance.Transform[0][0] = halfExtents.x;
+		instance.Transform[1][1] = halfExtents.y;
+		instance.Transform[2][2] = halfExtents.z;
+		instance.Transform[3] = glm::vec4{ center, 1.0f };
+		instance.Color = glm::vec4{ color, 1.0f };
+		return instance;
+	}
+
+	DebugShapeInstance_t DebugBox(const glm::mat4 &transform, glm::vec3 color) {
+		return DebugShapeInstance_t{ transform, glm::vec4{ color, 1.0f } };
+	}
+
+	DebugShapeInstance_t DebugSphere(glm::vec3 center, float radius, glm::vec3 color) {
+		return DebugBox(center, glm::vec3{ radius }, color);
+	}
+
+	DebugShapeInstance_t DebugFrustum(const glm::mat4 &viewProjection, glm::vec3 color) {
+		// The box's [-1, 1] depth to the clip space's [0, 1], then back to world space.
+		glm::mat4 box_to_clip{ 1.0f };
+		box_to_clip[2][2] = 0.5f;
+		box_to_clip[3][2] = 0.5f;
+		return DebugShapeInstance_t{ glm::inverse(viewProjection) * box_to_clip, glm::vec4{ color, 1.0f } };
+	}
+
+	DebugShapeInstance_t DebugAxes(const glm::mat4 &transform, float size) {
+		DebugShapeInstance_t instance{ transform, glm::vec4{ 1.0f } };
+		instance.Transform[0] *= size;
+		instance.Transform[1] *= size;
+		instance.Transform[2] *= size;
+		return instance;
+	}
+
+	DebugShapeInstance_t DebugArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color) {
+		DebugShapeInstance_t instance{ glm::mat4{ 0.0f }, glm::vec4{ color, 1.0f } };
+		instance.Transform[3] = glm::vec4{ start, 1.0f };
+
+		const glm::vec3 direction = end - start;
+		const float length = glm::length(direction);
+		if (length <= 0.0f) {
+			return instance; // Collapsed to its start.
+		}
+		const glm::vec3 z = direction / length;
+		const glm::vec3 up = glm::abs(z.y) < 0.99f ? glm::vec3{ 0.0f, 1.0f, 0.0f } : glm::vec3{ 1.0f, 0.0f, 0.0f };
+		const glm::vec3 x = glm::normalize(glm::cross(up, z));
+		const glm::vec3 y = glm::cross(z, x);
+		instance.Transform[0] = glm::vec4{ x * length, 0.0f };
+		instance.Transform[1] = glm::vec4{ y * length, 0.0f };
+		instance.Transform[2] = glm::vec4{ direction, 0.0f };
+		return instance;
+	}
+
+	void AddDebugShapeInstanceLayout(VertexLayout_t &layout) {
+		layout.Bindings[layout.BindingCount++] = { DEBUG_SHAPE_INSTANCE_BINDING, sizeof(DebugShapeInstance_t), VK_VERTEX_INPUT_RATE_INSTANCE };
+		// A mat4 attribute takes a location per column.
+		for (uint32_t column = 0; column < 4; column++) {
+			const uint32_t offset = static_cast<uint32_t>(offsetof(DebugShapeInstance_t, Transform) + sizeof(glm::vec4) * column);
+			layout.Attributes[layout.AttributeCount++] = { 4 + column, DEBUG_SHAPE_INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offset };
+		}
+		layout.Attributes[layout.AttributeCount++] = { 8, DEBUG_SHAPE_INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(DebugShapeInstance_t, Color)) };
+	}
+
+	void DebugDrawer::Init(MemoryAllocator *allocator, uint32_t frameCount) {
+		m_pAllocator = allocator;
+		m_Frames.resize(frameCount);
+		m_StartTime = std::chrono::steady_clock::now();
+
+		std::vector<Vertex> vertices;
+		const glm::vec3 white{ 1.0f };
+		const auto add_line = [&vertices](glm::vec3 start, glm::vec3 end, glm::vec3 color) {
+			vertices.emplace_back(start, color);
+			vertices.emplace_back(end, color);
+		};
+		const auto begin_shape = [&](DebugShape_t shape) {
+			m_ShapeRanges[shape].FirstVertex = static_cast<uint32_t>(vertices.size());
+		};
+		const auto end_shape = [&](DebugShape_t shape) {
+			m_ShapeRanges[shape].VertexCount = static_cast<uint32_t>(vertices.size()) - m_ShapeRanges[shape].FirstVertex;
+		};
+
+		begin_shape(DEBUG_SHAPE_BOX);
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			const uint32_t u = (axis + 1) % 3;
+			const uint32_t v = (axis + 2) % 3;
+			for (uint32_t corner = 0; corner < 4; corner++) {
+				glm::vec3 start{};
+				start[u] = (corner & 1) ? 1.0f : -1.0f;
+				start[v] = (corner & 2) ? 1.0f : -1.0f;
+				glm::vec3 end = start;
+				start[axis] = -1.0f;
+				end[axis] = 1.0f;
+				add_line(start, end, white);
+			}
+		}
+		end_shape(DEBUG_SHAPE_BOX);
+
+		begin_shape(DEBUG_SHAPE_SPHERE);
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			const uint32_t u = (axis + 1) % 3;
+			const uint32_t v = (axis + 2) % 3;
+			for (uint32_t segment = 0; segment < DEBUG_SPHERE_SEGMENTS; segment++) {
+				const float angle_start = glm::two_pi<float>() * segment / DEBUG_SPHERE_SEGMENTS;
+				const float angle_end = glm::two_pi<float>() * (segment + 1) / DEBUG_SPHERE_SEGMENTS;
+				glm::vec3 start{};
+				glm::vec3 end{};
+				start[u] = glm::cos(angle_start);
+				start[v] = glm::sin(angle_start);
+				end[u] = glm::cos(angle_end);
+				end[v] = glm::sin(angle_end);
+				add_line(start, end, white);
+			}
+		}
+		end_shape(DEBUG_SHAPE_SPHERE);
+
+		begin_shape(DEBUG_SHAPE_AXES);
+		add_line(glm::vec3{ 0.0f }, glm::vec3{ 1.0f, 0.0f, 0.0f }, glm::vec3{ 1.0f, 0.0f, 0.0f });
+		add_line(glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+		add_line(glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 0.0f, 1.0f }, glm::vec3{ 0.0f, 0.0f, 1.0f });
+		end_shape(DEBUG_SHAPE_AXES);
+
+		begin_shape(DEBUG_SHAPE_ARROW);
+		const glm::vec3 tip{ 0.0f, 0.0f, 1.0f };
+		const float head_base = 1.0f - DEBUG_ARROW_HEAD_LENGTH;
+		add_line(glm::vec3{ 0.0f }, tip, white);
+		add_line(tip, glm::vec3{ DEBUG_ARROW_HEAD_RADIUS, 0.0f, head_base }, white);
+		add_line(tip, glm::vec3{ -DEBUG_ARROW_HEAD_RADIUS, 0.0f, head_base }, white);
+		add_line(tip, glm::vec3{ 0.0f, DEBUG_ARROW_HEAD_RADIUS, head_base }, white);
+		add_line(tip, glm::vec3{ 0.0f, -DEBUG_ARROW_HEAD_RADIUS, head_base }, white);
+		end_shape(DEBUG_SHAPE_ARROW);
+
+		// A few kilobytes, written once : read from host visible memory.
+		const VkDeviceSize size = sizeof(Vertex) * vertices.size();
+		CreateBuffer(m_pAllocator, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					 m_ShapeVertexBuffer, m_ShapeVertexAllocation);
+		std::memcpy(m_ShapeVertexAllocation.pMapped, vertices.data(), (size_t)size);
+	}
+
+	void DebugDrawer::CleanUp() {
+		for (FrameBuffer_t &frame : m_Frames) {
+			if (frame.Buffer != VK_NULL_HANDLE) {
+				DestroyBuffer(m_pAllocator, frame.Buffer, frame.Allocation);
+			}
+		}
+		m_Frames.clear();
+		if (m_ShapeVertexBuffer != VK_NULL_HANDLE) {
+			DestroyBuffer(m_pAllocator, m_ShapeVertexBuffer, m_ShapeVertexAllocation);
+		}
+	}
+
+	template<typename T>
+	void DebugDrawer::Add(std::vector<T> &singleFrame, PersistentDrawings_t<T> &persistent, const T *items, uint32_t primitiveCount, uint32_t itemsPerPrimitive,
+						  DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const uint32_t item_count = primitiveCount * itemsPerPrimitive;
+		if (duration.IsSingleFrame()) {
+			singleFrame.insert(singleFrame.end(), items, items + item_count);
+			return;
+		}
+
+		// Call sites usually draw many primitives in a row : only look the id up when it changes.
+		if (id != 0 && id != m_LastPersistentId) {
+			uint64_t &last_submit_frame = m_LastSubmitFrames[id];
+			if (last_submit_frame != m_FrameIndex) {
+				if (last_submit_frame != 0) {
+					m_SupersededIds.push_back(id);
+				}
+				last_submit_frame = m_FrameIndex;
+			}
+			m_LastPersistentId = id;
+		}
+
+		Lifetime_t lifetime{};
+		lifetime.Id = id;
+		lifetime.SubmitFrame = m_FrameIndex;
+		lifetime.ExpireFrame = m_FrameIndex + duration.Frames;
+		lifetime.ExpireTime = duration.Seconds > 0.0f ? m_Time + duration.Seconds : 0.0;
+		persistent.Items.insert(persistent.Items.end(), items, items + item_count);
+		persistent.Lifetimes.insert(persistent.Lifetimes.end(), primitiveCount, lifetime);
+	}
+
+	template<typename T>
+	void DebugDrawer::Expire(PersistentDrawings_t<T> &persistent, uint32_t itemsPerPrimitive) {
+		const bool check_superseded = !m_SupersededIds.empty();
+		size_t kept = 0;
+		for (size_t i = 0; i < persistent.Lifetimes.size(); i++) {
+			const Lifetime_t &lifetime = persistent.Lifetimes[i];
+			bool is_alive = lifetime.ExpireTime > 0.0 ? m_Time < lifetime.ExpireTime : m_FrameIndex < lifetime.ExpireFrame;
+			if (is_alive && check_superseded && lifetime.Id != 0 && lifetime.SubmitFrame < m_FrameIndex) {
+				is_alive = m_LastSubmitFrames[lifetime.Id] == lifetime.SubmitFrame;
+			}
+			if (!is_alive) {
+				continue;
+			}
+			if (kept != i) {
+				persistent.Lifetimes[kept] = lifetime;
+				std::copy_n(persistent.Items.begin() + i * itemsPerPrimitive, itemsPerPrimitive, persistent.Items.begin() + kept * itemsPerPrimitive);
+			}
+			kept++;
+		}
+		persistent.Lifetimes.resize(kept);
+		persistent.Items.resize(kept * itemsPerPrimitive);
+	}
+
+	void DebugDrawer::AddPoints(const Vertex *vertices, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		Add(m_Points, m_PersistentPoints, vertices, count, 1, id, duration);
+	}
+
+	void DebugDrawer::AddLines(const Vertex *vertices, uint32_t lineCount, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		Add(m_LineVertices, m_PersistentLineVertices, vertices, lineCount, 2, id, duration);
+	}
+
+	void DebugDrawer::AddShapes(DebugShape_t shape, const DebugShapeInstance_t *instances, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		Add(m_Shapes[shape], m_PersistentShapes[shape], instances, count, 1, id, duration);
+	}
+
+	void DebugDrawer::Update(uint32_t currentFrame, uint32_t categoryMask) {
+		m_Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+		Expire(m_PersistentPoints, 1);
+		Expire(m_PersistentLineVertices, 2);
+		for (PersistentDrawings_t<DebugShapeInstance_t> &shapes : m_PersistentShapes) {
+			Expire(shapes, 1);
+		}
+
+		FrameBuffer_t &frame = m_Frames[currentFrame];
+		const bool show_points = (categoryMask & DEBUG_DRAW_POINTS_BIT) != 0;
+		const bool show_lines = (categoryMask & DEBUG_DRAW_LINES_BIT) != 0;
+		const bool show_shapes = (categoryMask & DEBUG_DRAW_SHAPES_BIT) != 0;
+		frame.PointCount = show_points ? static_cast<uint32_t>(m_Points.size() + m_PersistentPoints.Items.size()) : 0;
+		frame.LineVertexCount = show_lines ? static_cast<uint32_t>(m_LineVertices.size() + m_PersistentLineVertices.Items.size()) : 0;
+		frame.ShapesOffset = (sizeof(Vertex) * (frame.PointCount + frame.LineVertexCount) + 15) & ~VkDeviceSize(15);
+		uint32_t shape_count = 0;
+		for (uint32_t shape = 0; shape < DEBUG_SHAPE_MAX_ENUM; shape++) {
+			frame.ShapeCounts[shape] = show_shapes ? static_cast<uint32_t>(m_Shapes[shape].size() + m_PersistentShapes[shape].Items.size()) : 0;
+			shape_count += frame.ShapeCounts[shape];
+		}
+		const VkDeviceSize size = frame.ShapesOffset + sizeof(DebugShapeInstance_t) * shape_count;
+		m_HighWaterMark = std::max(m_HighWaterMark, size);
+
+		// The frame is not in flight : its buffer can be replaced right away. Grows geometrically, as storage buffers do.
+		if (size > frame.Capacity) {
+			VkDeviceSize capacity = std::max<VkDeviceSize>(frame.Capacity * 2, 4096);
+			while (capacity < size) {
+				capacity *= 2;
+			}
+			if (frame.Buffer != VK_NULL_HANDLE) {
+				DestroyBuffer(m_pAllocator, frame.Buffer, frame.Allocation);
+			}
+			CreateBuffer(m_pAllocator, capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+						 frame.Buffer, frame.Allocation);
+			frame.Capacity = capacity;
+		}
+
+		// Rewritten every frame : copying to mapped memory costs less than finding out what changed.
+		uint8_t *mapped = static_cast<uint8_t *>(frame.Allocation.pMapped);
+		VkDeviceSize offset = 0;
+		const auto write = [mapped, &offset](const auto &items) {
+			const size_t bytes = sizeof(items[0]) * items.size();
+			if (bytes > 0) {
+				std::memcpy(mapped + offset, items.data(), bytes);
+			}
+			offset += bytes;
+		};
+		if (show_points) {
+			write(m_Points);
+			write(m_PersistentPoints.Items);
+		}
+		if (show_lines) {
+			write(m_LineVertices);
+			write(m_PersistentLineVertices.Items);
+		}
+		offset = frame.ShapesOffset;
+		if (show_shapes) {
+			for (uint32_t shape = 0; shape < DEBUG_SHAPE_MAX_ENUM; shape++) {
+				write(m_Shapes[shape]);
+				write(m_PersistentShapes[shape].Items);
+			}
+		}
+
+		m_Points.clear();
+		m_LineVertices.clear();
+		for (std::vector<DebugShapeInstance_t> &shapes : m_Shapes) {
+			shapes.clear();
+		}
+		m_SupersededIds.clear();
+		m_LastPersistentId = 0;
+		m_FrameIndex++;
+
+		ProfilingServer *profiler = Application::Singleton()->Debug()->Profiler();
+		profiler->SetCounter("Debug Draw Vertices", frame.PointCount + frame.LineVertexCount);
+		profiler->SetCounter("Debug Draw Shapes", shape_count);
+		profiler->SetCounter("Debug Draw Persistent", GetPersistentCount());
+		profiler->SetCounter("Debug Draw High Water Mark (bytes)", static_cast<int64_t>(m_HighWaterMark));
+	}
+
+	void DebugDrawer::Record(VkCommandBuffer buffer, uint32_t currentFrame, VkPipeline pointLinePipeline, VkPipeline shapePipeline, RenderStats_t &stats) const {
+		const FrameBuffer_t &frame = m_Frames[currentFrame];
+
+		// Shapes are wireframes too : debug drawings count no triangles.
+		if ((frame.PointCount > 0 || frame.LineVertexCount > 0) && pointLinePipeline != VK_NULL_HANDLE) {
+			vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pointLinePipeline);
+			stats[RENDER_STAT_PIPELINE_BINDS]++;
+
+			// Drawn as instance 0 : the identity object, fullbright. VERTEX_FORMAT_FLOAT : both bindings read the same buffer.
+			VkBuffer buffers[] = { frame.Buffer, frame.Buffer };
+			VkDeviceSize offsets[] = { 0, 0 };
+			vkCmdBindVertexBuffers(buffer, VERTEX_POSITION_BINDING, 2, buffers, offsets);
+			stats[RENDER_STAT_BUFFER_BINDS]++;
+
+			if (frame.PointCount > 0) {
+				vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_POINT_LIST);
+				vkCmdDraw(buffer, frame.PointCount, 1, 0, 0);
+				stats.CountDraw(1, 0);
+			}
+			if (frame.LineVertexCount > 0) {
+				vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
+				vkCmdDraw(buffer, frame.LineVertexCount, 1, frame.PointCount, 0);
+				stats.CountDraw(1, 0);
+			}
+		}
+
+		uint32_t shape_count = 0;
+		for (uint32_t count : frame.ShapeCounts) {
+			shape_count += count;
+		}
+		if (shape_count > 0 && shapePipeline != VK_NULL_HANDLE) {
+			vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shapePipeline);
+			stats[RENDER_STAT_PIPELINE_BINDS]++;
+
+			static_assert(VERTEX_POSITION_BINDING == 0 && VERTEX_ATTRIBUTE_BINDING == 1 && DEBUG_SHAPE_INSTANCE_BINDING == 2, "Bound in a single call.");
+			VkBuffer buffers[] = { m_ShapeVertexBuffer, m_ShapeVertexBuffer, frame.Buffer };
+			VkDeviceSize offsets[] = { 0, 0, frame.ShapesOffset };
+			vkCmdBindVertexBuffers(buffer, VERTEX_POSITION_BINDING, 3, buffers, offsets);
+			stats[RENDER_STAT_BUFFER_BINDS]++;
+			vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
+
+			// One instanced draw per shape : instances of a shape are consecutive.
+			uint32_t first_instance = 0;
+			for (uint32_t shape = 0; shape < DEBUG_SHAPE_MAX_ENUM; shape++) {
+				if (frame.ShapeCounts[shape] == 0) {
+					continue;
+				}
+				vkCmdDraw(buffer, m_ShapeRanges[shape].VertexCount, frame.ShapeCounts[shape], m_ShapeRanges[shape].FirstVertex, first_instance);
+				first_instance += frame.ShapeCounts[shape];
+				stats.CountDraw(frame.ShapeCounts[shape], 0);
+			}
+		}
+	}
+
+	uint32_t DebugDrawer::GetPersistentCount() const {
+		size_t count = m_PersistentPoints.Lifetimes.size() + m_PersistentLineVertices.Lifetimes.size();
+		for (const PersistentDrawings_t<DebugShapeInstance_t> &shapes : m_PersistentShapes) {
+			count += shapes.Lifetimes.size();
+		}
+		return static_cast<uint32_t>(count);
+	}
+
+}
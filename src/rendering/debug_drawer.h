@@ -0,0 +1,214 @@
+#ifndef DEBUG_DRAWER_H
+#define DEBUG_DRAWER_H
+
+#include "vulkan/vulkan.h"
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+#include "memory_allocator.h"
+#include "model.h"
+#include "render_stats.h"
+
+namespace gigno {
+
+	/*
+	Identifies where debug drawings come from : drawings lasting more than a frame (see DebugDrawDuration_t) replace those their
+	id left in earlier frames. 0 is anonymous : never replaced.
+	*/
+	typedef uint64_t DebugDrawId_t;
+
+	// FNV-1a, 64 bits, of the file name then the line.
+	constexpr DebugDrawId_t HashDebugDrawId(const char *file, uint32_t line) {
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (const char *c = file; *c != '\0'; c++) {
+			hash = (hash ^ static_cast<uint8_t>(*c)) * 0x100000001B3ull;
+		}
+		for (uint32_t i = 0; i < 4; i++) {
+			hash = (hash ^ ((line >> (i * 8)) & 0xFF)) * 0x100000001B3ull;
+		}
+		return hash != 0 ? hash : 1;
+	}
+
+	template<DebugDrawId_t ID>
+	struct DebugDrawIdConstant_t {
+		static constexpr DebugDrawId_t Value = ID;
+	};
+
+	// Id of the line it is written on, hashed at compile time.
+	#define DEBUG_DRAW_ID (::gigno::DebugDrawIdConstant_t<::gigno::HashDebugDrawId(__FILE__, __LINE__)>::Value)
+
+	/*
+	How long a debug drawing stays. The default is the frame it is drawn in alone.
+	*/
+	struct DebugDrawDuration_t {
+		float Seconds = 0.0f; // If positive, the drawing stays for this long, whatever the number of frames.
+		uint32_t Frames = 1;  // Otherwise, the number of frames it is drawn in.
+
+		static DebugDrawDuration_t ForSeconds(float seconds) { return DebugDrawDuration_t{ seconds, 0 }; }
+		static DebugDrawDuration_t ForFrames(uint32_t frames) { return DebugDrawDuration_t{ 0.0f, frames }; }
+
+		bool IsSingleFrame() const { return Seconds <= 0.0f && Frames <= 1; }
+	};
+
+	/*
+	Wireframe shapes, drawn as instances of a unit mesh.
+	*/
+	enum DebugShape_t {
+		DEBUG_SHAPE_BOX,    // Edges of the [-1, 1] cube.
+		DEBUG_SHAPE_SPHERE, // Three great circles of the unit sphere, around each axis.
+		DEBUG_SHAPE_AXES,   // x, y and z unit axes, colored red, green and blue (times the instance color).
+		DEBUG_SHAPE_ARROW,  // From the origin to (0, 0, 1), with its head at the end.
+		DEBUG_SHAPE_MAX_ENUM
+	};
+
+	/*
+	One instance of a DebugShape_t, read as per-instance vertex attributes (see shaders/debug_shape.vert).
+	The transform may be projective (frustums) : positions are divided by w.
+	*/
+	struct DebugShapeInstance_t {
+		glm::mat4 Transform{ 1.0f };
+		glm::vec4 Color{ 1.0f };
+	};
+
+	// Instance helpers, for DebugDrawer::AddShapes().
+	DebugShapeInstance_t DebugBox(glm::vec3 center, glm::vec3 halfExtents, glm::vec3 color);
+	// @param transform of the [-1, 1] cube.
+	DebugShapeInstance_t DebugBox(const glm::mat4 &transform, glm::vec3 color);
+	DebugShapeInstance_t DebugSphere(glm::vec3 center, float radius, glm::vec3 color);
+	// @param viewProjection of the frustum, with a [0, 1] clip space depth (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+	DebugShapeInstance_t DebugFrustum(const glm::mat4 &viewProjection, glm::vec3 color);
+	DebugShapeInstance_t DebugAxes(const glm::mat4 &transform, float size);
+	// The head's size is proportional to the arrow's length.
+	DebugShapeInstance_t DebugArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color);
+
+	const uint32_t DEBUG_SHAPE_INSTANCE_BINDING = 2;
+
+	/*
+	@brief Adds the per-instance binding and attributes (locations 4 to 8) of DebugShapeInstance_t to a VERTEX_FORMAT_FLOAT layout.
+	*/
+	void AddDebugShapeInstanceLayout(VertexLayout_t &layout);
+
+	enum DebugDrawCategoryBits_t {
+		DEBUG_DRAW_POINTS_BIT = 1 << 0,
+		DEBUG_DRAW_LINES_BIT = 1 << 1,
+		DEBUG_DRAW_SHAPES_BIT = 1 << 2,
+		DEBUG_DRAW_ALL = DEBUG_DRAW_POINTS_BIT | DEBUG_DRAW_LINES_BIT | DEBUG_DRAW_SHAPES_BIT
+	};
+
+	/*
+	Debug points, lines and shapes, written every frame to a persistently mapped buffer of the frame and drawn in a few draws.
+
+	Usage :
+		* Initialisation : Init(). Owned by the SwapChain.
+		* Clean Up : CleanUp().
+		* Key Functions :
+		  * void AddPoints / AddLines / AddShapes( ... ) : Main thread only. Batches are copied as is.
+		  * void Update( ... ) : Once per frame, once the frame's fence was waited. Writes what was added since the last call, and what
+		    still lasts from earlier frames, to the frame's buffer.
+		  * void Record( ... ) : Draws what Update() wrote.
+	Implementation :
+		* Drawings of a single frame are appended to plain arrays, copied to the mapped buffer with a memcpy each. Longer drawings are
+		  kept, with their lifetime, in arrays of their own, compacted as they expire.
+		* Shapes are not expanded on the CPU : each shape type is an instanced draw of its unit mesh, with a DebugShapeInstance_t per instance.
+	*/
+	class DebugDrawer {
+	public:
+		// @param frameCount number of frames in flight : each one has its own buffer.
+		void Init(MemoryAllocator *allocator, uint32_t frameCount);
+		void CleanUp();
+
+		// @param vertices a position and color per point.
+		void AddPoints(const Vertex *vertices, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		// @param vertices two per line.
+		void AddLines(const Vertex *vertices, uint32_t lineCount, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void AddShapes(DebugShape_t shape, const DebugShapeInstance_t *instances, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+
+		/*
+		@brief Writes the drawings to the frame's buffer, then starts a new frame : drawings of a single frame are dropped.
+		@param categoryMask DebugDrawCategoryBits_t drawn this frame. Hidden drawings still age.
+		*/
+		void Update(uint32_t currentFrame, uint32_t categoryMask);
+		/*
+		@brief Draws the frame's drawings. The descriptor set must be bound.
+		@param pointLinePipeline takes VERTEX_FORMAT_FLOAT vertices, drawn as the identity object (instance 0).
+		@param shapePipeline takes VERTEX_FORMAT_FLOAT vertices and the shape instances (see AddDebugShapeInstanceLayout()).
+		Shapes are not drawn if VK_NULL_HANDLE.
+		@param stats receives the draws and binds recorded.
+		*/
+		void Record(VkCommandBuffer buffer, uint32_t currentFrame, VkPipeline pointLinePipeline, VkPipeline shapePipeline, RenderStats_t &stats) const;
+
+		// Largest buffer a frame needed so far, in bytes.
+		VkDeviceSize GetHighWaterMark() const { return m_HighWaterMark; }
+		// Drawings lasting more than a frame, still alive.
+		uint32_t GetPersistentCount() const;
+
+	private:
+		struct Lifetime_t {
+			DebugDrawId_t Id;
+			uint64_t SubmitFrame;
+			uint64_t ExpireFrame; // Dropped once reached, if ExpireTime is 0.
+			double ExpireTime;    // In seconds since Init().
+		};
+
+		// Drawings lasting more than a frame. Items holds the same number of consecutive items for each lifetime.
+		template<typename T>
+		struct PersistentDrawings_t {
+			std::vector<T> Items;
+			std::vector<Lifetime_t> Lifetimes;
+		};
+
+		template<typename T>
+		void Add(std::vector<T> &singleFrame, PersistentDrawings_t<T> &persistent, const T *items, uint32_t primitiveCount, uint32_t itemsPerPrimitive,
+				 DebugDrawId_t id, const DebugDrawDuration_t &duration);
+		template<typename T>
+		void Expire(PersistentDrawings_t<T> &persistent, uint32_t itemsPerPrimitive);
+
+		std::vector<Vertex> m_Points;
+		std::vector<Vertex> m_LineVertices;
+		std::vector<DebugShapeInstance_t> m_Shapes[DEBUG_SHAPE_MAX_ENUM];
+		PersistentDrawings_t<Vertex> m_PersistentPoints;
+		PersistentDrawings_t<Vertex> m_PersistentLineVertices;
+		PersistentDrawings_t<DebugShapeInstance_t> m_PersistentShapes[DEBUG_SHAPE_MAX_ENUM];
+
+		// Frame each id last drew persistent drawings in. Ids which drew in this frame after drawing in an earlier one are superseded :
+		// their earlier drawings are dropped by the next Update().
+		std::unordered_map<DebugDrawId_t, uint64_t> m_LastSubmitFrames;
+		std::vector<DebugDrawId_t> m_SupersededIds;
+		DebugDrawId_t m_LastPersistentId = 0; // Already looked up this frame.
+		uint64_t m_FrameIndex = 1;
+		double m_Time = 0.0; // Of the last Update(), in seconds since Init().
+		std::chrono::steady_clock::time_point m_StartTime{};
+
+		// Unit shape meshes, one after the other.
+		struct ShapeRange_t {
+			uint32_t FirstVertex = 0;
+			uint32_t VertexCount = 0;
+		};
+		ShapeRange_t m_ShapeRanges[DEBUG_SHAPE_MAX_ENUM]{};
+		VkBuffer m_ShapeVertexBuffer = VK_NULL_HANDLE;
+		GpuAllocation_t m_ShapeVertexAllocation{};
+
+		// Persistently mapped buffer holding a frame's drawings : points, then line vertices, then shape instances grouped by shape.
+		// Rewritten every frame by the CPU, read straight by the GPU. Grows, never shrinks.
+		struct FrameBuffer_t {
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			GpuAllocation_t Allocation{};
+			VkDeviceSize Capacity = 0;
+			uint32_t PointCount = 0;
+			uint32_t LineVertexCount = 0;
+			VkDeviceSize ShapesOffset = 0;
+			uint32_t ShapeCounts[DEBUG_SHAPE_MAX_ENUM]{};
+		};
+		std::vector<FrameBuffer_t> m_Frames;
+		VkDeviceSize m_HighWaterMark = 0;
+
+		MemoryAllocator *m_pAllocator = nullptr;
+	};
+
+}
+
+#endif
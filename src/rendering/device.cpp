@@ -8,7 +8,15 @@
 
 namespace gigno {
 
+	// Relative to the running directory.
+	const char *PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
 	Device::Device(const Window *window) {
+		m_IsHeadless = window->IsHeadless();
+		if (m_IsHeadless) {
+			m_DeviceExtensions.clear();
+		}
+
 		CreateInstance();
 		if (m_EnableValidationLayer) {
 			CreateDebugMessenger();
@@ -16,10 +24,17 @@ namespace gigno {
 		CreateSurface(window);
 		PickPhysicalDevice();
 		CreateVulkanDevice();
+
+		m_pAllocator = std::make_unique<MemoryAllocator>(m_VkDevice, m_PhysicalDevice);
+		m_PipelineCache.Load(m_VkDevice, m_PhysicalDevice, PIPELINE_CACHE_PATH);
 	}
 
 
 	Device::~Device() {
+		m_PipelineCache.CleanUp(m_VkDevice);
+		m_pAllocator->CleanUp();
+		m_pAllocator.reset();
+
 		vkDestroyDevice(m_VkDevice, nullptr);
 
 		//Destroy Debug Messenger
@@ -30,7 +45,9 @@ namespace gigno {
 			}
 		}
 
-		vkDestroySurfaceKHR(m_VkInstance, m_Surface, nullptr);
+		if (m_Surface != VK_NULL_HANDLE) {
+			vkDestroySurfaceKHR(m_VkInstance, m_Surface, nullptr);
+		}
 		vkDestroyInstance(m_VkInstance, nullptr);
 	}
 
@@ -124,7 +141,7 @@ namespace gigno {
 		QueueFamilyIndices indices = FindQueueFamiliyIndices(m_PhysicalDevice);
 		
 		std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-		std::set<uint32_t> unique_queue_family_indices = { indices.graphicFamily.value(), indices.presentFamily.value()};
+		std::set<uint32_t> unique_queue_family_indices = { indices.graphicFamily.value(), indices.presentFamily.value(), indices.transferFamily.value() };
 		queue_create_infos.reserve(unique_queue_family_indices.size());
 
 		float queue_prioriy = 1.0f;
@@ -133,13 +150,32 @@ namespace gigno {
 			VkDeviceQueueCreateInfo queueCreateInfo{};
 			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 			queueCreateInfo.pNext = nullptr;
-			queueCreateInfo.queueFamilyIndex = indices.graphicFamily.value();
+			queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
 			queueCreateInfo.queueCount = 1;
 			queueCreateInfo.pQueuePriorities = &queue_prioriy;
 			queue_create_infos.push_back(queueCreateInfo);
 		}
 		
+		VkPhysicalDeviceFeatures supported_features{};
+		vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supported_features);
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
+		// GPU culling issues one indirect draw per mesh, each starting at its own instance range.
+		deviceFeatures.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+		// Wireframe pipeline variant.
+		deviceFeatures.fillModeNonSolid = supported_features.fillModeNonSolid;
+		m_SupportsWireframe = supported_features.fillModeNonSolid;
+		// Pipeline statistics of whole frames, whose draws are in secondary command buffers (see PipelineStatistics).
+		deviceFeatures.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery;
+		deviceFeatures.inheritedQueries = supported_features.inheritedQueries;
+		m_SupportsPipelineStatistics = supported_features.pipelineStatisticsQuery && supported_features.inheritedQueries;
+
+		uint32_t queue_fam_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queue_fam_count, nullptr);
+		std::vector<VkQueueFamilyProperties> queue_fam_properties(queue_fam_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queue_fam_count, queue_fam_properties.data());
+		const bool graphics_has_compute = (queue_fam_properties[indices.graphicFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		m_SupportsGpuCulling = supported_features.drawIndirectFirstInstance && graphics_has_compute;
 
 		VkDeviceCreateInfo deviceCreateInfo{};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -164,6 +200,7 @@ namespace gigno {
 
 		vkGetDeviceQueue(m_VkDevice, indices.graphicFamily.value(), 0, &m_GraphicsQueue);
 		vkGetDeviceQueue(m_VkDevice, indices.presentFamily.value(), 0, &m_PresentQueue);
+		vkGetDeviceQueue(m_VkDevice, indices.transferFamily.value(), 0, &m_TransferQueue);
 	}
 
 	void Device::CreateSurface(const Window *window) {
@@ -217,11 +254,15 @@ namespace gigno {
 	}
 
 	std::vector<const char *> Device::GetRequiredExtensions() {
-		uint32_t glfw_extension_count = 0;
-		const char **glfw_extensions;
-		glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+		std::vector<const char *> extensions{};
+
+		if (!m_IsHeadless) {
+			uint32_t glfw_extension_count = 0;
+			const char **glfw_extensions;
+			glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
 
-		std::vector<const char *> extensions{glfw_extensions, glfw_extensions + glfw_extension_count};
+			extensions.insert(extensions.end(), glfw_extensions, glfw_extensions + glfw_extension_count);
+		}
 
 		if (m_EnableValidationLayer) {
 			extensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -250,8 +291,8 @@ namespace gigno {
 	bool Device::IsPhysicalDeviceSuitable(const VkPhysicalDevice& device) {
 		bool extensions_supported = CheckDeviceExtensionSupport(device);
 
-		bool swap_chain_adequate = false;
-		if (extensions_supported) {
+		bool swap_chain_adequate = m_IsHeadless; // Nothing to present to when headless.
+		if (extensions_supported && !m_IsHeadless) {
 			SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
 			swap_chain_adequate = !swapChainSupport.presentModes.empty() && !swapChainSupport.formats.empty();
 		}
@@ -270,20 +311,40 @@ namespace gigno {
 
 		for (size_t i = 0; i < queue_fam_properties.size(); i++) {
 			const auto &queue_fam_property = queue_fam_properties[i];
-			VkBool32 supports_present = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &supports_present);
-			if (supports_present) {
-				indices.presentFamily = i;
-			}
 			if (queue_fam_property.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
 				indices.graphicFamily = i;
 			}
+			if (m_IsHeadless) {
+				// Never presents. Alias the graphics queue so that the rest of the code does not have to care.
+				indices.presentFamily = indices.graphicFamily;
+			} else {
+				VkBool32 supports_present = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &supports_present);
+				if (supports_present) {
+					indices.presentFamily = i;
+				}
+			}
 
 			if (indices.IsComplete()) {
 				break;
 			}
 		}
 
+		// Transfer : dedicated transfer family first, then any non graphics family able to transfer, then the graphics family.
+		for (size_t i = 0; i < queue_fam_properties.size(); i++) {
+			const VkQueueFlags flags = queue_fam_properties[i].queueFlags;
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				indices.transferFamily = i;
+				break;
+			}
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !indices.transferFamily.has_value()) {
+				indices.transferFamily = i;
+			}
+		}
+		if (!indices.transferFamily.has_value()) {
+			indices.transferFamily = indices.graphicFamily;
+		}
+
 		return indices;
 	}
 
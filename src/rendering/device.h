@@ -5,8 +5,11 @@
 
 #include <vector>
 #include <optional>
+#include <memory>
 #include "window.h"
 #include "swapchain.h"
+#include "memory_allocator.h"
+#include "pipeline_cache.h"
 
 
 
@@ -20,6 +23,8 @@ namespace gigno {
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicFamily;
 		std::optional<uint32_t> presentFamily;
+		// Prefers a transfer-only family (DMA engine), copies then run alongside rendering. Falls back to the graphics family.
+		std::optional<uint32_t> transferFamily;
 
 		bool IsComplete() {
 			return graphicFamily.has_value() && presentFamily.has_value();
@@ -38,10 +43,25 @@ namespace gigno {
 		VkInstance GetInstance() const { return m_VkInstance; }
 		VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
 		VkSurfaceKHR GetSurface() const { return m_Surface; }
+		// Headless devices have no surface and cannot present. Rendering goes to offscreen images (see SwapChain).
+		bool IsHeadless() const { return m_IsHeadless; }
 		SwapChainSupportDetails GetPhysicalSwapChainSupport() const { return QuerySwapChainSupport(m_PhysicalDevice); }
 		QueueFamilyIndices GetPhysicalDeviceQueueFamilyIndices() const { return FindQueueFamiliyIndices(m_PhysicalDevice); }
 		VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
 		VkQueue GetPresentQueue() const { return m_PresentQueue; }
+		// Same queue as GetGraphicsQueue() if the device has no separate transfer family.
+		VkQueue GetTransferQueue() const { return m_TransferQueue; }
+		// Every GPU memory of the device goes through this allocator.
+		MemoryAllocator *GetAllocator() const { return m_pAllocator.get(); }
+		// Whether the graphics queue runs compute and indirect draws can start at any instance (see GpuCuller).
+		bool SupportsGpuCulling() const { return m_SupportsGpuCulling; }
+		// Whether pipelines can rasterize with VK_POLYGON_MODE_LINE.
+		bool SupportsWireframe() const { return m_SupportsWireframe; }
+		// Whether pipeline statistics queries can stay active while secondary command buffers execute.
+		bool SupportsPipelineStatistics() const { return m_SupportsPipelineStatistics; }
+		// Every pipeline of the device is created through this cache. Saved to disk on destruction.
+		VkPipelineCache GetPipelineCache() const { return m_PipelineCache.Get(); }
+		const PipelineCacheStats_t &GetPipelineCacheStats() const { return m_PipelineCache.GetStats(); }
 
 	private :
 		void CreateInstance();
@@ -71,18 +91,28 @@ namespace gigno {
 
 		SwapChainSupportDetails QuerySwapChainSupport(const VkPhysicalDevice &deice) const;
 
+		bool m_IsHeadless = false;
+		bool m_SupportsGpuCulling = false;
+		bool m_SupportsWireframe = false;
+		bool m_SupportsPipelineStatistics = false;
+
 		VkInstance m_VkInstance;
 		VkDebugUtilsMessengerEXT m_DebugMessenger;
-		VkSurfaceKHR m_Surface;
+		VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
 		VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE; //Implicitly destroyed with m_VkInstance
 		VkDevice m_VkDevice;
 		VkQueue m_GraphicsQueue;
 		VkQueue m_PresentQueue;
+		VkQueue m_TransferQueue;
+
+		std::unique_ptr<MemoryAllocator> m_pAllocator;
+		PipelineCache m_PipelineCache;
 
 		const std::vector<const char *> m_ValidationLayers = {
 			"VK_LAYER_KHRONOS_validation"
 		};
-		const std::vector<const char *> m_DeviceExtensions = {
+		// Swapchain extension is removed when headless.
+		std::vector<const char *> m_DeviceExtensions = {
 			VK_KHR_SWAPCHAIN_EXTENSION_NAME
 		};
 
@@ -0,0 +1,164 @@
+#include "frustum_culling.h"
+#include "model.h"
+#include "../entities/rendered_entity.h"
+#include "../threading/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define CULLING_USE_SSE 1
+	#include <xmmintrin.h>
+#else
+	#define CULLING_USE_SSE 0
+#endif
+
+namespace gigno {
+
+	// Below these, a batch is not worth handing to another thread.
+	const uint32_t BOUNDS_UPDATE_MIN_BATCH = 256;
+	const uint32_t CULL_MIN_GROUP_BATCH = 256;
+
+	Frustum_t Frustum_t::FromViewProjection(const glm::mat4 &viewProjection) {
+		// Gribb & Hartmann : each plane is a combination of the rows of the matrix.
+		const glm::mat4 m = glm::transpose(viewProjection);
+
+		Frustum_t frustum{};
+		frustum.Planes[0] = m[3] + m[0]; // Left
+		frustum.Planes[1] = m[3] - m[0]; // Right
+		frustum.Planes[2] = m[3] + m[1]; // Bottom
+		frustum.Planes[3] = m[3] - m[1]; // Top
+		frustum.Planes[4] = m[2];        // Near ([0, 1] depth)
+		frustum.Planes[5] = m[3] - m[2]; // Far
+
+		for (glm::vec4 &plane : frustum.Planes) {
+			plane /= glm::length(glm::vec3{ plane });
+		}
+		return frustum;
+	}
+
+	void FrustumCuller::UpdateBounds(const std::vector<const RenderedEntity *> &entities, uint32_t objectCount, ThreadPool *pool) {
+		Resize(objectCount);
+
+		// Every entity has its own ObjectIndex : batches never write the same slot.
+		pool->ParallelFor(static_cast<uint32_t>(entities.size()), BOUNDS_UPDATE_MIN_BATCH, [this, &entities](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				UpdateWorldBounds(entities[i]);
+			}
+		});
+	}
+
+	void FrustumCuller::Cull(const Frustum_t &frustum, ThreadPool *pool) {
+		const uint32_t group_count = static_cast<uint32_t>(m_Radius.size() / 4);
+		pool->ParallelFor(group_count, CULL_MIN_GROUP_BATCH, [this, &frustum](uint32_t begin, uint32_t end) {
+			CullGroups(frustum, begin, end);
+		});
+	}
+
+	void FrustumCuller::Resize(uint32_t objectCount) {
+		const size_t padded_count = (objectCount + 3) & ~3u;
+		if (padded_count <= m_Radius.size()) {
+			return;
+		}
+
+		m_BoundsSources.resize(padded_count);
+		m_CenterX.resize(padded_count);
+		m_CenterY.resize(padded_count);
+		m_CenterZ.resize(padded_count);
+		m_ExtentX.resize(padded_count);
+		m_ExtentY.resize(padded_count);
+		m_ExtentZ.resize(padded_count);
+		m_Radius.resize(padded_count);
+		m_Visible.resize(padded_count);
+	}
+
+	void FrustumCuller::UpdateWorldBounds(const RenderedEntity *entity) {
+		const uint32_t index = entity->ObjectIndex;
+		const giModel *model = entity->pModel.Get();
+
+		BoundsSource_t &source = m_BoundsSources[index];
+		if (source.ModelId == model->GetId() && source.Transform == entity->Transform) {
+			return;
+		}
+		source.ModelId = model->GetId();
+		source.Transform = entity->Transform;
+
+		const Bounds_t &bounds = model->GetBounds();
+		const glm::mat4 matrix = entity->Transform.TransformationMatrix();
+
+		const glm::vec3 center = glm::vec3{ matrix * glm::vec4{ bounds.Center, 1.0f } };
+		// Box of the transformed box (Arvo) : each world axis gets the projection of every transformed local axis.
+		const glm::mat3 abs_matrix{ glm::abs(glm::vec3{ matrix[0] }), glm::abs(glm::vec3{ matrix[1] }), glm::abs(glm::vec3{ matrix[2] }) };
+		const glm::vec3 extents = abs_matrix * bounds.Extents;
+		const float max_scale = glm::sqrt(std::max({ glm::dot(glm::vec3{ matrix[0] }, glm::vec3{ matrix[0] }),
+													 glm::dot(glm::vec3{ matrix[1] }, glm::vec3{ matrix[1] }),
+													 glm::dot(glm::vec3{ matrix[2] }, glm::vec3{ matrix[2] }) }));
+
+		m_CenterX[index] = center.x;
+		m_CenterY[index] = center.y;
+		m_CenterZ[index] = center.z;
+		m_ExtentX[index] = extents.x;
+		m_ExtentY[index] = extents.y;
+		m_ExtentZ[index] = extents.z;
+		m_Radius[index] = bounds.Radius * max_scale;
+	}
+
+	/*
+	An object is outside when its bounds are entirely behind one of the planes : dot(n, center) + w < -r, with r the bounds'
+	"radius" along n. For the box, r = |n.x| * e.x + |n.y| * e.y + |n.z| * e.z. Both volumes contain the mesh, so the smallest r is used.
+	*/
+	void FrustumCuller::CullGroups(const Frustum_t &frustum, uint32_t firstGroup, uint32_t endGroup) {
+	#if CULLING_USE_SSE
+		__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+		__m128 abs_plane_x[6], abs_plane_y[6], abs_plane_z[6];
+		for (int p = 0; p < 6; p++) {
+			plane_x[p] = _mm_set1_ps(frustum.Planes[p].x);
+			plane_y[p] = _mm_set1_ps(frustum.Planes[p].y);
+			plane_z[p] = _mm_set1_ps(frustum.Planes[p].z);
+			plane_w[p] = _mm_set1_ps(frustum.Planes[p].w);
+			abs_plane_x[p] = _mm_set1_ps(std::fabs(frustum.Planes[p].x));
+			abs_plane_y[p] = _mm_set1_ps(std::fabs(frustum.Planes[p].y));
+			abs_plane_z[p] = _mm_set1_ps(std::fabs(frustum.Planes[p].z));
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (uint32_t group = firstGroup; group < endGroup; group++) {
+			const uint32_t i = group * 4;
+			const __m128 cx = _mm_loadu_ps(&m_CenterX[i]);
+			const __m128 cy = _mm_loadu_ps(&m_CenterY[i]);
+			const __m128 cz = _mm_loadu_ps(&m_CenterZ[i]);
+			const __m128 ex = _mm_loadu_ps(&m_ExtentX[i]);
+			const __m128 ey = _mm_loadu_ps(&m_ExtentY[i]);
+			const __m128 ez = _mm_loadu_ps(&m_ExtentZ[i]);
+			const __m128 radius = _mm_loadu_ps(&m_Radius[i]);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero); // All bits set.
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], cx), _mm_mul_ps(plane_y[p], cy)),
+											 _mm_add_ps(_mm_mul_ps(plane_z[p], cz), plane_w[p]));
+				__m128 box_radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(abs_plane_x[p], ex), _mm_mul_ps(abs_plane_y[p], ey)), _mm_mul_ps(abs_plane_z[p], ez));
+				__m128 r = _mm_min_ps(box_radius, radius);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			m_Visible[i + 0] = static_cast<uint8_t>(mask & 1);
+			m_Visible[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+			m_Visible[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+			m_Visible[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+		}
+	#else
+		for (uint32_t i = firstGroup * 4; i < endGroup * 4; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				const glm::vec4 &plane = frustum.Planes[p];
+				const float distance = plane.x * m_CenterX[i] + plane.y * m_CenterY[i] + plane.z * m_CenterZ[i] + plane.w;
+				const float box_radius = std::fabs(plane.x) * m_ExtentX[i] + std::fabs(plane.y) * m_ExtentY[i] + std::fabs(plane.z) * m_ExtentZ[i];
+				inside = distance + std::min(box_radius, m_Radius[i]) >= 0.0f;
+			}
+			m_Visible[i] = inside ? 1 : 0;
+		}
+	#endif
+	}
+
+}
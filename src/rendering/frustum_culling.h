@@ -0,0 +1,83 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "../entities/entity.h"
+
+namespace gigno {
+
+	class RenderedEntity;
+	class giModel;
+	class ThreadPool;
+
+	/*
+	The six planes of a view frustum, normalized, pointing inwards : a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for every plane.
+	*/
+	struct Frustum_t {
+		glm::vec4 Planes[6];
+
+		// Expects a [0, 1] clip space depth (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+		static Frustum_t FromViewProjection(const glm::mat4 &viewProjection);
+	};
+
+	/*
+	Tests the world space bounds of the rendered entities against a view frustum.
+
+	Usage :
+		* Initialisation : Default constructor. Owned by the SwapChain.
+		* Key Functions :
+		  * void UpdateBounds( ... ) : Once per frame, before Cull() and any bounds getter.
+		  * void Cull( ... ) : Once per frame, before any IsVisible() call.
+		  * bool IsVisible( ... ) : Result of the last Cull() for an entity's ObjectIndex.
+	Implementation :
+		* Bounds are stored per ObjectIndex, as a structure of arrays, so that the test runs on 4 objects at once (SSE).
+		* World bounds are only recomputed for the entities whose transform or model changed since the last UpdateBounds().
+		* Both passes are split across the thread pool's threads.
+	*/
+	class FrustumCuller {
+	public:
+		/*
+		@brief Computes the world bounds of the entities that moved or changed model. Also used for level of detail selection.
+		@param entities resident entities. Their ObjectIndex must be smaller than 'objectCount'.
+		*/
+		void UpdateBounds(const std::vector<const RenderedEntity *> &entities, uint32_t objectCount, ThreadPool *pool);
+		// Tests the bounds of every object against the frustum. Objects no entity passed to UpdateBounds() uses must not be read back.
+		void Cull(const Frustum_t &frustum, ThreadPool *pool);
+
+		bool IsVisible(uint32_t objectIndex) const { return m_Visible[objectIndex] != 0; }
+		// Center of the object's world bounds, as of the last UpdateBounds().
+		glm::vec3 GetWorldCenter(uint32_t objectIndex) const { return { m_CenterX[objectIndex], m_CenterY[objectIndex], m_CenterZ[objectIndex] }; }
+		// Radius of the object's world bounding sphere, as of the last UpdateBounds().
+		float GetWorldRadius(uint32_t objectIndex) const { return m_Radius[objectIndex]; }
+
+	private:
+		void Resize(uint32_t objectCount);
+		void UpdateWorldBounds(const RenderedEntity *entity);
+		// Tests objects [4 * firstGroup, 4 * endGroup).
+		void CullGroups(const Frustum_t &frustum, uint32_t firstGroup, uint32_t endGroup);
+
+		struct BoundsSource_t {
+			Transform_t Transform{};
+			uint32_t ModelId = 0; // giModel::GetId() : unlike the model's address, never reused. 0 if none.
+		};
+		std::vector<BoundsSource_t> m_BoundsSources; // What the world bounds of each object were computed from.
+
+		// World bounds per ObjectIndex. Sized to a multiple of 4.
+		std::vector<float> m_CenterX;
+		std::vector<float> m_CenterY;
+		std::vector<float> m_CenterZ;
+		std::vector<float> m_ExtentX;
+		std::vector<float> m_ExtentY;
+		std::vector<float> m_ExtentZ;
+		std::vector<float> m_Radius;
+
+		std::vector<uint8_t> m_Visible;
+	};
+
+}
+
+#endif
@@ -0,0 +1,344 @@
+#include "gpu_culling.h"
+#include "device.h"
+#include "model.h"
+#include "pipeline.h"
+#include "lod_selection.h"
+#include "rendering_utils.h"
+#include "../entities/rendered_entity.h"
+#include "../error_macros.h"
+
+#include <array>
+#include <algorithm>
+
+namespace gigno {
+
+	// Must match local_size_x in shaders/frustum_cull.comp.
+	const uint32_t CULL_GROUP_SIZE = 64;
+
+	void GpuCuller::Init(const Device &device, const char *shaderPath, uint32_t frameCount) {
+		m_pAllocator = device.GetAllocator();
+		m_Frames.resize(frameCount);
+		m_DescriptorSets.resize(frameCount);
+
+		if (!device.SupportsGpuCulling()) {
+			return;
+		}
+
+		const std::vector<char> code = giPipeline::ReadFile(shaderPath);
+		if (code.empty()) {
+			return; // Already logged by ReadFile(). Falls back to CPU culling.
+		}
+
+		VkDevice vk_device = device.GetDevice();
+
+		// Objects, cull objects, draws, instance indices.
+		std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutinfo{};
+		layoutinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutinfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutinfo.pBindings = bindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(vk_device, &layoutinfo, nullptr, &m_DescriptorSetLayout);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to create Culling Descriptor Set Layout ! Vulkan Error Code : %d", (int)result);
+		}
+
+		VkDescriptorPoolSize poolsize{};
+		poolsize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolsize.descriptorCount = static_cast<uint32_t>(bindings.size()) * frameCount;
+
+		VkDescriptorPoolCreateInfo poolinfo{};
+		poolinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolinfo.maxSets = frameCount;
+		poolinfo.poolSizeCount = 1;
+		poolinfo.pPoolSizes = &poolsize;
+
+		result = vkCreateDescriptorPool(vk_device, &poolinfo, nullptr, &m_DescriptorPool);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to create Culling Descriptor Pool ! Vulkan Error Code : %d", (int)result);
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(frameCount, m_DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocinfo{};
+		allocinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocinfo.descriptorPool = m_DescriptorPool;
+		allocinfo.descriptorSetCount = frameCount;
+		allocinfo.pSetLayouts = layouts.data();
+
+		result = vkAllocateDescriptorSets(vk_device, &allocinfo, m_DescriptorSets.data());
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to allocate Culling Descriptor Sets ! Vulkan Error Code : %d", (int)result);
+		}
+
+		VkPushConstantRange range{};
+		range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		range.offset = 0;
+		range.size = sizeof(CullPushConstants_t);
+
+		VkPipelineLayoutCreateInfo pipelinelayoutinfo{};
+		pipelinelayoutinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelinelayoutinfo.setLayoutCount = 1;
+		pipelinelayoutinfo.pSetLayouts = &m_DescriptorSetLayout;
+		pipelinelayoutinfo.pushConstantRangeCount = 1;
+		pipelinelayoutinfo.pPushConstantRanges = &range;
+
+		result = vkCreatePipelineLayout(vk_device, &pipelinelayoutinfo, nullptr, &m_PipelineLayout);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to create Culling Pipeline Layout ! Vulkan Error Code : %d", (int)result);
+		}
+
+		VkShaderModuleCreateInfo moduleinfo{};
+		moduleinfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleinfo.codeSize = code.size();
+		moduleinfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+		result = vkCreateShaderModule(vk_device, &moduleinfo, nullptr, &m_ShaderModule);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to create Culling Shader Module ! Vulkan Error Code : %d", (int)result);
+		}
+
+		VkComputePipelineCreateInfo pipelineinfo{};
+		pipelineinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineinfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineinfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineinfo.stage.module = m_ShaderModule;
+		pipelineinfo.stage.pName = "main";
+		pipelineinfo.layout = m_PipelineLayout;
+
+		result = vkCreateComputePipelines(vk_device, device.GetPipelineCache(), 1, &pipelineinfo, nullptr, &m_Pipeline);
+		if (result != VK_SUCCESS) {
+			m_Pipeline = VK_NULL_HANDLE;
+			ERR_MSG("Failed to create Culling Pipeline ! Vulkan Error Code : %d", (int)result);
+		}
+	}
+
+	void GpuCuller::CleanUp(VkDevice device) {
+		for (FrameCulling_t &frame : m_Frames) {
+			DestroyBuffer(m_pAllocator, frame.CullObjects.Buffer, frame.CullObjects.Allocation);
+			DestroyBuffer(m_pAllocator, frame.Draws.Buffer, frame.Draws.Allocation);
+		}
+		m_Frames.clear();
+
+		// Handles are left null if Init() stopped early. Destroying a null handle is a no-op.
+		vkDestroyPipeline(device, m_Pipeline, nullptr);
+		vkDestroyShaderModule(device, m_ShaderModule, nullptr);
+		vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
+		vkDestroyDescriptorPool(device, m_DescriptorPool, nullptr); // Frees the sets.
+		vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, nullptr);
+		m_Pipeline = VK_NULL_HANDLE;
+	}
+
+	bool GpuCuller::Reserve(CulledBuffer_t &storage, VkDeviceSize size, VkBufferUsageFlags usage) {
+		if (size <= storage.Capacity) {
+			return false;
+		}
+
+		VkDeviceSize capacity = std::max<VkDeviceSize>(storage.Capacity * 2, 4096);
+		while (capacity < size) {
+			capacity *= 2;
+		}
+
+		DestroyBuffer(m_pAllocator, storage.Buffer, storage.Allocation);
+		CreateBuffer(m_pAllocator, capacity, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					 storage.Buffer, storage.Allocation);
+		storage.Capacity = capacity;
+		return true;
+	}
+
+	uint32_t GpuCuller::Prepare(uint32_t currentFrame, const std::vector<const RenderedEntity *> &entities, const LodSelector &lods, uint32_t objectCount, uint32_t firstInstance) {
+		FrameCulling_t &frame = m_Frames[currentFrame];
+		m_PrepareCount++;
+
+		// The frame's fence was waited : the count written by its last dispatch is complete.
+		if (frame.Draws.Buffer != VK_NULL_HANDLE) {
+			m_LastVisibleCount = static_cast<const DrawBufferHeader_t *>(frame.Draws.Allocation.pMapped)->VisibleCount;
+		}
+
+		if (Reserve(frame.CullObjects, sizeof(GpuCullObject_t) * objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+			frame.Sources.assign(frame.Sources.size(), CullSource_t{});
+		}
+		if (frame.Sources.size() < objectCount) {
+			frame.Sources.resize(objectCount);
+		}
+		frame.ObjectCount = objectCount;
+
+		std::fill(m_DrawInstanceCounts.begin(), m_DrawInstanceCounts.end(), 0);
+		std::fill(frame.DrawModels.begin(), frame.DrawModels.end(), nullptr);
+
+		GpuCullObject_t *cull_objects = static_cast<GpuCullObject_t *>(frame.CullObjects.Allocation.pMapped);
+		for (const RenderedEntity *entity : entities) {
+			giModel *model = entity->pModel.Get();
+			const uint32_t lod = lods.GetLod(entity->ObjectIndex);
+			auto found = m_DrawIndices.find(model->GetId());
+			if (found == m_DrawIndices.end()) {
+				found = m_DrawIndices.emplace(model->GetId(), AllocateDrawRange()).first;
+			}
+			const uint32_t draw_index = found->second + lod;
+			if (draw_index >= m_DrawInstanceCounts.size()) {
+				m_DrawInstanceCounts.resize(draw_index + 1, 0);
+			}
+			if (draw_index >= frame.DrawModels.size()) {
+				frame.DrawModels.resize(draw_index + 1, nullptr);
+			}
+			m_DrawInstanceCounts[draw_index]++;
+			frame.DrawModels[draw_index] = model;
+
+			CullSource_t &source = frame.Sources[entity->ObjectIndex];
+			source.LastSeen = m_PrepareCount;
+			if (source.MeshId != model->GetId() || source.Lod != lod) {
+				const Bounds_t &bounds = model->GetBounds();
+				GpuCullObject_t &object = cull_objects[entity->ObjectIndex];
+				object.CenterRadius = glm::vec4{ bounds.Center, bounds.Radius };
+				object.Extents = glm::vec4{ bounds.Extents, 0.0f };
+				object.DrawIndex = draw_index;
+				source.MeshId = model->GetId();
+				source.Lod = lod;
+			}
+		}
+
+		// Objects of entities gone (or not resident yet) must not be drawn.
+		for (uint32_t i = 0; i < objectCount; i++) {
+			CullSource_t &source = frame.Sources[i];
+			if (source.LastSeen != m_PrepareCount && source.MeshId != MESH_NONE) {
+				cull_objects[i].DrawIndex = GPU_CULL_NO_DRAW;
+				source.MeshId = MESH_NONE;
+			}
+		}
+
+		// Each draw gets room for all the instances of its mesh and level. The shader fills instanceCount.
+		const uint32_t draw_count = static_cast<uint32_t>(m_DrawInstanceCounts.size());
+		Reserve(frame.Draws, sizeof(DrawBufferHeader_t) + sizeof(VkDrawIndexedIndirectCommand) * draw_count,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+		DrawBufferHeader_t *header = static_cast<DrawBufferHeader_t *>(frame.Draws.Allocation.pMapped);
+		header->VisibleCount = 0;
+		VkDrawIndexedIndirectCommand *commands = reinterpret_cast<VkDrawIndexedIndirectCommand *>(header + 1);
+
+		uint32_t instance = firstInstance;
+		for (uint32_t i = 0; i < draw_count; i++) {
+			VkDrawIndexedIndirectCommand &command = commands[i];
+			const MeshLod_t *lod = frame.DrawModels[i] ? &frame.DrawModels[i]->GetLod(i % MAX_LOD_COUNT) : nullptr;
+			command.indexCount = lod ? lod->IndexCount : 0;
+			command.instanceCount = 0;
+			command.firstIndex = lod ? lod->FirstIndex : 0;
+			command.vertexOffset = 0;
+			command.firstInstance = instance;
+			instance += m_DrawInstanceCounts[i];
+		}
+		return instance;
+	}
+
+	void GpuCuller::ReleaseModels(const std::vector<uint32_t> &modelIds) {
+		for (uint32_t id : modelIds) {
+			auto found = m_DrawIndices.find(id);
+			if (found == m_DrawIndices.end()) {
+				continue; // Never drawn with GPU culling.
+			}
+			const uint32_t first = found->second;
+			m_DrawIndices.erase(found);
+			m_FreeDrawRanges.push_back(first);
+
+			// The model is destroyed : no frame may bind it again before its range is reused.
+			const uint32_t end = first + MAX_LOD_COUNT;
+			if (first < m_DrawInstanceCounts.size()) {
+				std::fill(m_DrawInstanceCounts.begin() + first, m_DrawInstanceCounts.begin() + std::min<size_t>(end, m_DrawInstanceCounts.size()), 0);
+			}
+			for (FrameCulling_t &frame : m_Frames) {
+				if (first < frame.DrawModels.size()) {
+					std::fill(frame.DrawModels.begin() + first, frame.DrawModels.begin() + std::min<size_t>(end, frame.DrawModels.size()), nullptr);
+				}
+			}
+		}
+	}
+
+	uint32_t GpuCuller::AllocateDrawRange() {
+		if (!m_FreeDrawRanges.empty()) {
+			const uint32_t first = m_FreeDrawRanges.back();
+			m_FreeDrawRanges.pop_back();
+			return first;
+		}
+		return m_DrawRangeCount++ * MAX_LOD_COUNT;
+	}
+
+	void GpuCuller::Dispatch(VkCommandBuffer buffer, uint32_t currentFrame, const Frustum_t &frustum, VkBuffer objects, VkBuffer instanceIndices, RenderStats_t &stats) {
+		const FrameCulling_t &frame = m_Frames[currentFrame];
+
+		// Any of the buffers may have grown since the frame last ran.
+		const std::array<VkBuffer, 4> buffers = { objects, frame.CullObjects.Buffer, frame.Draws.Buffer, instanceIndices };
+		std::array<VkDescriptorBufferInfo, 4> infos{};
+		std::array<VkWriteDescriptorSet, 4> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++) {
+			infos[i].buffer = buffers[i];
+			infos[i].offset = 0;
+			infos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_DescriptorSets[currentFrame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &infos[i];
+		}
+		vkUpdateDescriptorSets(m_pAllocator->GetDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+		CullPushConstants_t constants{};
+		std::copy(std::begin(frustum.Planes), std::end(frustum.Planes), constants.Planes);
+		constants.ObjectCount = frame.ObjectCount;
+
+		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+		vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 0, nullptr);
+		vkCmdPushConstants(buffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		stats[RENDER_STAT_PIPELINE_BINDS]++;
+		stats[RENDER_STAT_DESCRIPTOR_BINDS]++;
+		stats[RENDER_STAT_PUSH_CONSTANTS]++;
+		vkCmdDispatch(buffer, (frame.ObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// Draw commands and instance indices are read by the draws, the visible count by the host once the frame completed.
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+							 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GpuCuller::RecordDraws(VkCommandBuffer buffer, uint32_t currentFrame, const VkPipeline *pFormatPipelines, RenderStats_t &stats) const {
+		const FrameCulling_t &frame = m_Frames[currentFrame];
+
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		const giModel *bound_model = nullptr;
+		for (uint32_t i = 0; i < frame.DrawModels.size(); i++) {
+			giModel *model = frame.DrawModels[i];
+			if (!model) {
+				continue;
+			}
+			const VkPipeline pipeline = pFormatPipelines[model->GetVertexFormat()];
+			if (pipeline == VK_NULL_HANDLE) {
+				continue;
+			}
+			if (pipeline != bound_pipeline) {
+				vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				bound_pipeline = pipeline;
+				stats[RENDER_STAT_PIPELINE_BINDS]++;
+			}
+			// Levels of detail of a mesh have consecutive draw indices and share its buffers.
+			if (model != bound_model) {
+				model->Bind(buffer);
+				bound_model = model;
+				stats[RENDER_STAT_BUFFER_BINDS] += 2; // Vertex and index buffers.
+			}
+			vkCmdDrawIndexedIndirect(buffer, frame.Draws.Buffer, sizeof(DrawBufferHeader_t) + sizeof(VkDrawIndexedIndirectCommand) * i, 1,
+									 sizeof(VkDrawIndexedIndirectCommand));
+			stats[RENDER_STAT_DRAWS]++;
+		}
+	}
+
+}
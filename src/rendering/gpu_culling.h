@@ -0,0 +1,159 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include "vulkan/vulkan.h"
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "memory_allocator.h"
+#include "frustum_culling.h"
+#include "render_stats.h"
+
+namespace gigno {
+
+	class Device;
+	class giModel;
+	class RenderedEntity;
+	class LodSelector;
+
+	/*
+	Per-Object model space bounds, read by the culling compute shader at the object's ObjectIndex.
+
+	Implementation :
+		* Must follow the std430 layout rules (see shaders/frustum_cull.comp).
+	*/
+	struct GpuCullObject_t {
+		glm::vec4 CenterRadius{}; // Bounds_t::Center, Bounds_t::Radius.
+		glm::vec4 Extents{};      // Bounds_t::Extents.
+		uint32_t DrawIndex = 0;   // Draw command of the object's mesh and level of detail. GPU_CULL_NO_DRAW if no entity uses the ObjectIndex.
+		uint32_t Padding[3]{};
+	};
+	static_assert(sizeof(GpuCullObject_t) % 16 == 0, "GpuCullObject_t must follow the std430 array stride.");
+
+	const uint32_t GPU_CULL_NO_DRAW = UINT32_MAX;
+
+	/*
+	Frustum culling and draw generation on the GPU. A compute shader tests every object's bounds and appends the visible
+	ones to the instance range of their mesh's indirect draw command : the CPU records one indirect draw per mesh,
+	whatever the number of entities.
+
+	Usage :
+		* Initialisation : Init(). Owned by the SwapChain. Stays unusable (IsUsable() false) if the device lacks the
+		  features or the compute shader cannot be loaded : the CPU path (FrustumCuller + RenderQueue) is used instead.
+		* Clean Up : CleanUp(), with the same device.
+		* Key Functions (once per frame, in this order) :
+		  * uint32_t Prepare( ... ) : Writes what changed in the cull objects and resets the frame's draw commands.
+		  * void Dispatch( ... ) : Records the culling, outside of any render pass. Followed by the barrier the draws need.
+		  * void RecordDraws( ... ) : Records the indirect draws, inside the render pass.
+	Implementation :
+		* Each mesh has MAX_LOD_COUNT consecutive stable draw indices, one per level of detail, so that the cull object of an entity
+		  is only rewritten when its model or level of detail changes. Levels are selected on the CPU (see LodSelector).
+		* The draw indices of a destroyed model are reused (see ReleaseModels()). Model ids never are : the cull objects written for
+		  the destroyed model do not match any entity's model anymore, so they are rewritten or cleared by the next Prepare().
+		* Instances of a mesh are in no particular order (no front to back sorting as on the CPU path).
+		* Prepare() stays linear in the resident entities : levels of detail are selected again each frame for every entity, and the
+		  instance range of each draw is sized from them. Per entity, it is a compare against the CullSource_t : only the cull
+		  objects that changed are written to the buffer.
+	*/
+	class GpuCuller {
+	public:
+		// @param frameCount number of frames in flight : each one has its own buffers.
+		void Init(const Device &device, const char *shaderPath, uint32_t frameCount);
+		void CleanUp(VkDevice device);
+
+		bool IsUsable() const { return m_Pipeline != VK_NULL_HANDLE; }
+
+		/*
+		@brief Writes the cull objects of the entities whose model or level of detail changed, and the frame's draw commands with an empty
+		instance range per mesh and level of detail.
+		@param entities resident entities. Their ObjectIndex must be smaller than 'objectCount'.
+		@param lods level of detail of each entity this frame.
+		@param firstInstance first instance the draws may use.
+		@returns one past the last instance the draws may use : the frame's instance buffer must hold that many indices.
+		*/
+		uint32_t Prepare(uint32_t currentFrame, const std::vector<const RenderedEntity *> &entities, const LodSelector &lods, uint32_t objectCount, uint32_t firstInstance);
+
+		/*
+		@brief Culls the frame's objects against the frustum, filling the draw commands and the instance buffer.
+		@param objects the frame's object buffer (ObjectData_t per ObjectIndex).
+		@param instanceIndices the frame's instance buffer, at least as large as what Prepare() asked for.
+		@param stats receives the binds recorded.
+		*/
+		void Dispatch(VkCommandBuffer buffer, uint32_t currentFrame, const Frustum_t &frustum, VkBuffer objects, VkBuffer instanceIndices, RenderStats_t &stats);
+
+		/*
+		@brief Binds each mesh used this frame, with the pipeline of its vertex format, and draws each of its levels of detail indirectly.
+		The descriptor set must be bound.
+		@param pFormatPipelines pipeline per VertexFormat_t. Meshes of a format whose pipeline is VK_NULL_HANDLE are not drawn.
+		@param stats receives the draws and binds recorded. Instances and triangles are decided by the GPU : not counted.
+		*/
+		void RecordDraws(VkCommandBuffer buffer, uint32_t currentFrame, const VkPipeline *pFormatPipelines, RenderStats_t &stats) const;
+
+		// Frees the draw indices of destroyed models, to be reused by the next ones. Must be called before Prepare().
+		void ReleaseModels(const std::vector<uint32_t> &modelIds);
+
+		// Visible objects counted by the GPU, MAX_FRAMES_IN_FLIGHT frames ago (read back once the frame's fence was waited).
+		uint32_t GetLastVisibleCount() const { return m_LastVisibleCount; }
+
+	private:
+		struct CullPushConstants_t {
+			glm::vec4 Planes[6];
+			uint32_t ObjectCount;
+		};
+
+		// Header of the draw buffer, followed by one VkDrawIndexedIndirectCommand per draw index.
+		struct DrawBufferHeader_t {
+			uint32_t VisibleCount;
+			uint32_t Padding[3];
+		};
+
+		struct CulledBuffer_t {
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			GpuAllocation_t Allocation{};
+			VkDeviceSize Capacity = 0;
+		};
+		// Grows the buffer, dropping its content, if it cannot hold 'size' bytes. @returns whether it grew.
+		bool Reserve(CulledBuffer_t &storage, VkDeviceSize size, VkBufferUsageFlags usage);
+		// First of MAX_LOD_COUNT consecutive draw indices, reusing those of a released model if possible.
+		uint32_t AllocateDrawRange();
+
+		// What a frame's cull object was written from, per ObjectIndex.
+		static constexpr uint32_t MESH_UNWRITTEN = UINT32_MAX;    // The buffer content is unknown.
+		static constexpr uint32_t MESH_NONE = UINT32_MAX - 1;     // Written with GPU_CULL_NO_DRAW.
+		struct CullSource_t {
+			uint32_t MeshId = MESH_UNWRITTEN;
+			uint32_t Lod = 0;
+			uint64_t LastSeen = 0;
+		};
+
+		struct FrameCulling_t {
+			CulledBuffer_t CullObjects; // GpuCullObject_t per ObjectIndex.
+			CulledBuffer_t Draws;       // DrawBufferHeader_t, then the draw commands.
+			std::vector<CullSource_t> Sources;
+			std::vector<giModel *> DrawModels; // Model of each draw index with instances this frame. nullptr otherwise.
+			uint32_t ObjectCount = 0;
+		};
+		std::vector<FrameCulling_t> m_Frames;
+
+		std::unordered_map<uint32_t, uint32_t> m_DrawIndices; // giModel::GetId() -> draw index of its full mesh, followed by its other levels.
+		std::vector<uint32_t> m_FreeDrawRanges;               // First draw index of the ranges of released models.
+		uint32_t m_DrawRangeCount = 0;                        // Ranges ever allocated : the draw commands of each frame.
+		std::vector<uint32_t> m_DrawInstanceCounts;           // Reused from frame to frame.
+		uint64_t m_PrepareCount = 0;
+		uint32_t m_LastVisibleCount = 0;
+
+		MemoryAllocator *m_pAllocator = nullptr;
+		VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_DescriptorSets;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		VkShaderModule m_ShaderModule = VK_NULL_HANDLE;
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+	};
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "gpu_profiler.h"
+#include "device.h"
+#include "../application.h"
+#include "../features_usage.h"
+#include "../error_macros.h"
+
+namespace gigno {
+
+	void GpuProfiler::Init(const Device &device, uint32_t frameCount) {
+	#if USE_PROFILER
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(device.GetPhysicalDevice(), &properties);
+
+		uint32_t queue_fam_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device.GetPhysicalDevice(), &queue_fam_count, nullptr);
+		std::vector<VkQueueFamilyProperties> queue_fam_properties(queue_fam_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(device.GetPhysicalDevice(), &queue_fam_count, queue_fam_properties.data());
+
+		const uint32_t valid_bits = queue_fam_properties[device.GetPhysicalDeviceQueueFamilyIndices().graphicFamily.value()].timestampValidBits;
+		if (valid_bits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+			return; // The graphics queue does not support timestamps.
+		}
+		m_TimestampMask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+		m_Device = device.GetDevice();
+
+		VkQueryPoolCreateInfo poolinfo{};
+		poolinfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolinfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolinfo.queryCount = GPU_PROFILER_MAX_SCOPES * 2;
+
+		m_Frames.resize(frameCount);
+		for (FrameQueries_t &frame : m_Frames) {
+			VkResult result = vkCreateQueryPool(m_Device, &poolinfo, nullptr, &frame.Pool);
+			if (result != VK_SUCCESS) {
+				CleanUp(m_Device);
+				ERR_MSG("Failed to create Timestamp Query Pool ! Vulkan Error Code : %d", (int)result);
+			}
+			frame.Scopes.reserve(GPU_PROFILER_MAX_SCOPES);
+		}
+		m_Results.resize(GPU_PROFILER_MAX_SCOPES * 2);
+	#else
+		(void)device;
+		(void)frameCount;
+	#endif
+	}
+
+	void GpuProfiler::CleanUp(VkDevice device) {
+		for (FrameQueries_t &frame : m_Frames) {
+			vkDestroyQueryPool(device, frame.Pool, nullptr);
+		}
+		m_Frames.clear();
+	}
+
+	void GpuProfiler::BeginFrame(VkCommandBuffer buffer, uint32_t currentFrame) {
+		if (!IsUsable()) {
+			return;
+		}
+		ASSERT(currentFrame < m_Frames.size());
+		ASSERT(m_OpenScopes.empty());
+		m_CurrentFrame = currentFrame;
+		FrameQueries_t &frame = m_Frames[currentFrame];
+
+		if (!frame.Scopes.empty()) {
+			const uint32_t query_count = static_cast<uint32_t>(frame.Scopes.size()) * 2;
+			// No wait flag : the frame's fence was waited, the results are available. VK_NOT_READY would only mean they are lost.
+			const VkResult result = vkGetQueryPoolResults(m_Device, frame.Pool, 0, query_count, sizeof(uint64_t) * query_count, m_Results.data(),
+														  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+			if (result == VK_SUCCESS) {
+				for (uint32_t i = 0; i < frame.Scopes.size(); i++) {
+					const uint64_t ticks = ((m_Results[i * 2 + 1] & m_TimestampMask) - (m_Results[i * 2] & m_TimestampMask)) & m_TimestampMask;
+					frame.Scopes[i].DurationUs = static_cast<float>(static_cast<double>(ticks) * m_TimestampPeriod / 1000.0);
+				}
+				Application::Singleton()->Debug()->Profiler()->SubmitGpuScopes(frame.Scopes.data(), static_cast<uint32_t>(frame.Scopes.size()));
+			}
+			frame.Scopes.clear();
+		}
+
+		vkCmdResetQueryPool(buffer, frame.Pool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+	}
+
+	void GpuProfiler::Begin(VkCommandBuffer buffer, const char *name) {
+		if (!IsUsable()) {
+			return;
+		}
+		FrameQueries_t &frame = m_Frames[m_CurrentFrame];
+		if (frame.Scopes.size() >= GPU_PROFILER_MAX_SCOPES) {
+			m_OpenScopes.push_back(NOT_TIMED);
+			return;
+		}
+
+		const uint32_t index = static_cast<uint32_t>(frame.Scopes.size());
+		frame.Scopes.push_back(GpuScopeTiming_t{ name, static_cast<uint32_t>(m_OpenScopes.size()), 0.0f });
+		m_OpenScopes.push_back(index);
+		vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.Pool, index * 2);
+	}
+
+	void GpuProfiler::End(VkCommandBuffer buffer) {
+		if (!IsUsable()) {
+			return;
+		}
+		ASSERT_MSG(!m_OpenScopes.empty(), "GpuProfiler::End() called without a matching Begin().");
+		const uint32_t index = m_OpenScopes.back();
+		m_OpenScopes.pop_back();
+		if (index != NOT_TIMED) {
+			vkCmdWriteTimestamp(buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Frames[m_CurrentFrame].Pool, index * 2 + 1);
+		}
+	}
+
+}
@@ -0,0 +1,71 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "../debug/profiling/profiling_server.h"
+
+namespace gigno {
+
+	class Device;
+
+	// Scopes a frame may time. Further scopes are ignored.
+	const uint32_t GPU_PROFILER_MAX_SCOPES = 64;
+
+	/*
+	Times scopes of the GPU's work with timestamp queries, and shows them in the ProfilingServer's GPU tree.
+
+	Usage :
+		* Initialisation : Init(). Owned by the SwapChain. Stays unusable (IsUsable() false) if the profiler is disabled or the
+		  graphics queue cannot write timestamps : every other function then does nothing.
+		* Clean Up : CleanUp(), with the same device.
+		* Key Functions (main thread only) :
+		  * void BeginFrame( ... ) : First thing recorded in the frame's command buffer, once the frame's fence was waited.
+		  * void Begin( ... ) / End( ... ) : Around the commands to time, outside or inside a render pass, in the primary command
+		    buffer or in a secondary one it executes. Scopes nest as they are begun on the CPU.
+	Implementation :
+		* Each frame in flight has its own query pool, two timestamps per scope. BeginFrame() reads back what the pool measured the last
+		  time the frame was recorded : its fence was waited, the results are ready and reading them never stalls. The timings shown
+		  are thus the number of frames in flight behind the CPU scopes.
+		* Begin() writes its timestamp at the top of the pipe, End() at the bottom : a scope covers all the work it recorded.
+	*/
+	class GpuProfiler {
+	public:
+		// @param frameCount number of frames in flight : each one has its own query pool.
+		void Init(const Device &device, uint32_t frameCount);
+		void CleanUp(VkDevice device);
+
+		bool IsUsable() const { return !m_Frames.empty(); }
+
+		/*
+		@brief Submits the timings the frame's pool holds to the profiler, then resets the pool. Must be recorded outside of any render pass.
+		*/
+		void BeginFrame(VkCommandBuffer buffer, uint32_t currentFrame);
+		// @param name must outlive the frames in flight (a literal).
+		void Begin(VkCommandBuffer buffer, const char *name);
+		void End(VkCommandBuffer buffer);
+
+	private:
+		struct FrameQueries_t {
+			VkQueryPool Pool = VK_NULL_HANDLE;
+			std::vector<GpuScopeTiming_t> Scopes; // Recorded in the pool, waiting to be read back. Begin at 2 * i, end at 2 * i + 1.
+		};
+		std::vector<FrameQueries_t> m_Frames;
+		std::vector<uint64_t> m_Results; // Reused from frame to frame.
+		uint32_t m_CurrentFrame = 0;
+
+		// Scopes begun and not ended yet, by index in the frame's scopes. NOT_TIMED if past GPU_PROFILER_MAX_SCOPES.
+		static constexpr uint32_t NOT_TIMED = UINT32_MAX;
+		std::vector<uint32_t> m_OpenScopes;
+
+		uint64_t m_TimestampMask = 0; // Valid bits of the graphics queue's timestamps.
+		float m_TimestampPeriod = 0.0f; // Nanoseconds per tick.
+		VkDevice m_Device = VK_NULL_HANDLE;
+	};
+
+}
+
+#endif
@@ -12,11 +12,15 @@
 #if USE_IMGUI
 namespace gigno
 {
+    // Headless : no platform nor renderer backend. ImGui frames are still built and ended, but never drawn.
+    static bool s_IsHeadless = false;
 
     void NewFrameImGui()
     {
-        ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
+        if (!s_IsHeadless) {
+            ImGui_ImplVulkan_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+        }
         ImGui::NewFrame();
     }
 
@@ -28,6 +32,16 @@ namespace gigno
         ImGuiIO &io = ImGui::GetIO();
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
+        s_IsHeadless = window == nullptr;
+        if (s_IsHeadless)
+        {
+            io.DisplaySize = ImVec2{(float)swapchain.GetWidth(), (float)swapchain.GetHeight()};
+            io.Fonts->Build();
+            ImGui::StyleColorsDark();
+            NewFrameImGui();
+            return true;
+        }
+
         ImGui_ImplGlfw_InitForVulkan(window, true);
 
         VkDescriptorPoolSize imgui_pool_sizes[] = {
@@ -79,16 +93,40 @@ namespace gigno
         return true;
     }
 
-    void RenderImGui(VkCommandBuffer commandBuffer)
+    void RenderImGui(VkCommandBuffer commandBuffer, RenderStats_t &stats)
     {
         ImGui::Render();
-        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+        if (s_IsHeadless) {
+            return;
+        }
+        ImDrawData *draw_data = ImGui::GetDrawData();
+        ImGui_ImplVulkan_RenderDrawData(draw_data, commandBuffer);
+
+        // As recorded by the backend : its state once, then a descriptor set and a draw per command (commands clipped out
+        // by the backend are counted too).
+        if (draw_data->TotalVtxCount <= 0) {
+            return;
+        }
+        stats[RENDER_STAT_PIPELINE_BINDS]++;
+        stats[RENDER_STAT_BUFFER_BINDS] += 2;
+        stats[RENDER_STAT_PUSH_CONSTANTS] += 2;
+        for (int i = 0; i < draw_data->CmdListsCount; i++) {
+            for (const ImDrawCmd &cmd : draw_data->CmdLists[i]->CmdBuffer) {
+                if (cmd.UserCallback) {
+                    continue;
+                }
+                stats[RENDER_STAT_DESCRIPTOR_BINDS]++;
+                stats.CountDraw(1, cmd.ElemCount / 3);
+            }
+        }
     }
 
     void ShutdownImGui()
     {
-        ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
+        if (!s_IsHeadless) {
+            ImGui_ImplVulkan_Shutdown();
+            ImGui_ImplGlfw_Shutdown();
+        }
         ImGui::DestroyContext();
     }
 
@@ -6,6 +6,7 @@
 #if USE_IMGUI
 
 #include "device.h"
+#include "render_stats.h"
 
 #include "imgui.h"
 
@@ -13,10 +14,15 @@ namespace gigno {
 
     void NewFrameImGui();
     
+    /*
+    @param window may be nullptr (headless). ImGui then still runs, so UI code does not have to check,
+                  but nothing is drawn.
+    */
     bool InitImGui(GLFWwindow *window, const Device &device, const SwapChain &swapchain);
 
 
-    void RenderImGui(VkCommandBuffer commandBuffer);
+    // @param stats receives the draws and binds of the ImGui backend.
+    void RenderImGui(VkCommandBuffer commandBuffer, RenderStats_t &stats);
 
     void ShutdownImGui();
 
@@ -0,0 +1,215 @@
+#include "light_clustering.h"
+#include "../threading/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gigno {
+
+	void LightClusterer::Build(const glm::mat4 &view, const glm::mat4 &projection, float near, float far, uint32_t width, uint32_t height, const std::vector<const Light *> &lights, ThreadPool *pool) {
+		m_Lights.clear();
+		m_LocalLights.clear();
+
+		// Lights reaching everything first : the shader goes through [0, m_GlobalLightCount) for every fragment.
+		for (const Light *light : lights) {
+			if (light->GetRange() <= 0.0f) {
+				m_Lights.emplace_back();
+				light->FillLightData(m_Lights.back());
+			}
+		}
+		m_GlobalLightCount = static_cast<uint32_t>(m_Lights.size());
+
+		for (const Light *light : lights) {
+			const float range = light->GetRange();
+			if (range <= 0.0f) {
+				continue;
+			}
+			m_Lights.emplace_back();
+			light->FillLightData(m_Lights.back());
+
+			LocalLight_t local{};
+			local.ViewCenter = glm::vec3{ view * glm::vec4{ glm::vec3{ m_Lights.back().PositionOrDirection }, 1.0f } };
+			local.Range = range;
+			local.LightIndex = static_cast<uint32_t>(m_Lights.size() - 1);
+			m_LocalLights.push_back(local);
+		}
+
+		m_Projection = projection;
+		SetupSlices(projection, near, far);
+		m_ScreenParams = glm::vec4{ static_cast<float>(CLUSTER_GRID_X) / std::max<uint32_t>(width, 1), static_cast<float>(CLUSTER_GRID_Y) / std::max<uint32_t>(height, 1), 0.0f, 0.0f };
+
+		pool->ParallelFor(static_cast<uint32_t>(m_LocalLights.size()), 64, [this](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				BoundLight(i);
+			}
+		});
+		pool->ParallelFor(CLUSTER_GRID_Z, 1, [this](uint32_t begin, uint32_t end) {
+			for (uint32_t z = begin; z < end; z++) {
+				BinSlice(z);
+			}
+		});
+
+		m_Clusters.resize(CLUSTER_COUNT);
+		m_LightIndices.clear();
+		for (uint32_t z = 0; z < CLUSTER_GRID_Z; z++) {
+			const SliceBins_t &bins = m_Slices[z];
+			const uint32_t base = static_cast<uint32_t>(m_LightIndices.size());
+			for (uint32_t tile = 0; tile < CLUSTER_GRID_X * CLUSTER_GRID_Y; tile++) {
+				ClusterRange_t &cluster = m_Clusters[z * CLUSTER_GRID_X * CLUSTER_GRID_Y + tile];
+				cluster.FirstIndex = base + bins.Offsets[tile];
+				cluster.Count = bins.Counts[tile];
+			}
+			m_LightIndices.insert(m_LightIndices.end(), bins.Indices.begin(), bins.Indices.end());
+		}
+	}
+
+	void LightClusterer::SetupSlices(const glm::mat4 &projection, float near, float far) {
+		m_IsPerspective = projection[2][3] != 0.0f;
+		m_Near = near;
+		m_Far = far > near ? far : near + 1.0f;
+		// A perspective projection with near <= 0 keeps the depth of everything past far below 1 : far clips nothing.
+		m_ClipsFar = !m_IsPerspective || near > 0.0f;
+
+		// The logarithm of the depth is only defined in front of the camera.
+		const bool is_exponential = m_IsPerspective && m_Near > 0.0f;
+		for (uint32_t z = 0; z <= CLUSTER_GRID_Z; z++) {
+			const float t = static_cast<float>(z) / CLUSTER_GRID_Z;
+			m_SliceDepths[z] = is_exponential ? m_Near * std::pow(m_Far / m_Near, t) : m_Near + (m_Far - m_Near) * t;
+		}
+
+		if (is_exponential) {
+			const float log_ratio = std::log(m_Far / m_Near);
+			m_DepthParams = glm::vec4{ CLUSTER_GRID_Z / log_ratio, -(CLUSTER_GRID_Z * std::log(m_Near)) / log_ratio, 1.0f, 0.0f };
+		} else {
+			m_DepthParams = glm::vec4{ CLUSTER_GRID_Z / (m_Far - m_Near), -(CLUSTER_GRID_Z * m_Near) / (m_Far - m_Near), 0.0f, 0.0f };
+		}
+	}
+
+	uint32_t LightClusterer::SliceOf(float viewDepth) const {
+		const float depth = m_DepthParams.z != 0.0f ? std::log(std::max(viewDepth, 1e-6f)) : viewDepth;
+		const float slice = std::floor(depth * m_DepthParams.x + m_DepthParams.y);
+		return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(CLUSTER_GRID_Z - 1)));
+	}
+
+	void LightClusterer::BoundLight(uint32_t localIndex) {
+		LocalLight_t &light = m_LocalLights[localIndex];
+		const glm::vec3 center = light.ViewCenter;
+		const float range = light.Range;
+
+		light.MinZ = 1;
+		light.MaxZ = 0;
+		if (center.z + range < m_Near || (m_ClipsFar && center.z - range > m_Far)) {
+			return;
+		}
+
+		glm::vec2 ndc_min{ -1.0f };
+		glm::vec2 ndc_max{ 1.0f };
+		// Crossing the near plane, the projected bounds are unbounded : the light may cover the whole screen.
+		if (!m_IsPerspective || center.z - range > m_Near) {
+			ndc_min = glm::vec2{ 2.0f };
+			ndc_max = glm::vec2{ -2.0f };
+			for (uint32_t corner = 0; corner < 8; corner++) {
+				const glm::vec3 offset{ (corner & 1) ? range : -range, (corner & 2) ? range : -range, (corner & 4) ? range : -range };
+				const glm::vec4 clip = m_Projection * glm::vec4{ center + offset, 1.0f };
+				const glm::vec2 ndc = glm::vec2{ clip } / clip.w;
+				ndc_min = glm::min(ndc_min, ndc);
+				ndc_max = glm::max(ndc_max, ndc);
+			}
+			if (ndc_max.x < -1.0f || ndc_max.y < -1.0f || ndc_min.x > 1.0f || ndc_min.y > 1.0f) {
+				return;
+			}
+		}
+
+		const auto tile_of = [](float ndc, uint32_t tileCount) {
+			const float tile = std::floor((ndc * 0.5f + 0.5f) * tileCount);
+			return static_cast<uint32_t>(std::clamp(tile, 0.0f, static_cast<float>(tileCount - 1)));
+		};
+		light.MinX = tile_of(ndc_min.x, CLUSTER_GRID_X);
+		light.MaxX = tile_of(ndc_max.x, CLUSTER_GRID_X);
+		light.MinY = tile_of(ndc_min.y, CLUSTER_GRID_Y);
+		light.MaxY = tile_of(ndc_max.y, CLUSTER_GRID_Y);
+		light.MinZ = SliceOf(std::max(center.z - range, m_Near));
+		light.MaxZ = SliceOf(std::min(center.z + range, m_Far));
+	}
+
+	void LightClusterer::BinSlice(uint32_t slice) {
+		SliceBins_t &bins = m_Slices[slice];
+		bins.Pairs.clear();
+		bins.Indices.clear();
+		std::memset(bins.Counts, 0, sizeof(bins.Counts));
+
+		const float near_depth = m_SliceDepths[slice];
+		float far_depth = m_SliceDepths[slice + 1];
+		if (!m_ClipsFar && slice == CLUSTER_GRID_Z - 1) {
+			// Nothing past far is clipped : the last slice reaches the farthest light binned into it.
+			for (const LocalLight_t &light : m_LocalLights) {
+				if (light.MinZ <= light.MaxZ && light.MaxZ == slice) {
+					far_depth = std::max(far_depth, light.ViewCenter.z + light.Range);
+				}
+			}
+		}
+
+		// View space x (resp. y) of an ndc coordinate at a depth, for the projections built by Camera.
+		const glm::mat4 &p = m_Projection;
+		const auto view_x = [&p](float ndc, float depth) { return (ndc * (p[2][3] * depth + p[3][3]) - p[2][0] * depth - p[3][0]) / p[0][0]; };
+		const auto view_y = [&p](float ndc, float depth) { return (ndc * (p[2][3] * depth + p[3][3]) - p[2][1] * depth - p[3][1]) / p[1][1]; };
+
+		// The view space box of cluster (x, y) of the slice is columns[x] * rows[y] * [near_depth, far_depth].
+		glm::vec2 columns[CLUSTER_GRID_X];
+		glm::vec2 rows[CLUSTER_GRID_Y];
+		for (uint32_t x = 0; x < CLUSTER_GRID_X; x++) {
+			const float ndc_0 = -1.0f + 2.0f * x / CLUSTER_GRID_X;
+			const float ndc_1 = -1.0f + 2.0f * (x + 1) / CLUSTER_GRID_X;
+			const float a = view_x(ndc_0, near_depth), b = view_x(ndc_0, far_depth), c = view_x(ndc_1, near_depth), d = view_x(ndc_1, far_depth);
+			columns[x] = { std::min(std::min(a, b), std::min(c, d)), std::max(std::max(a, b), std::max(c, d)) };
+		}
+		for (uint32_t y = 0; y < CLUSTER_GRID_Y; y++) {
+			const float ndc_0 = -1.0f + 2.0f * y / CLUSTER_GRID_Y;
+			const float ndc_1 = -1.0f + 2.0f * (y + 1) / CLUSTER_GRID_Y;
+			const float a = view_y(ndc_0, near_depth), b = view_y(ndc_0, far_depth), c = view_y(ndc_1, near_depth), d = view_y(ndc_1, far_depth);
+			rows[y] = { std::min(std::min(a, b), std::min(c, d)), std::max(std::max(a, b), std::max(c, d)) };
+		}
+
+		for (const LocalLight_t &light : m_LocalLights) {
+			if (slice < light.MinZ || slice > light.MaxZ) {
+				continue;
+			}
+
+			const float range_sq = light.Range * light.Range;
+			const float dz = std::max(std::max(near_depth - light.ViewCenter.z, light.ViewCenter.z - far_depth), 0.0f);
+			const float dz_sq = dz * dz;
+			for (uint32_t y = light.MinY; y <= light.MaxY; y++) {
+				const float dy = std::max(std::max(rows[y].x - light.ViewCenter.y, light.ViewCenter.y - rows[y].y), 0.0f);
+				const float dyz_sq = dy * dy + dz_sq;
+				if (dyz_sq > range_sq) {
+					continue;
+				}
+				for (uint32_t x = light.MinX; x <= light.MaxX; x++) {
+					const float dx = std::max(std::max(columns[x].x - light.ViewCenter.x, light.ViewCenter.x - columns[x].y), 0.0f);
+					if (dx * dx + dyz_sq > range_sq) {
+						continue;
+					}
+					const uint32_t tile = x + y * CLUSTER_GRID_X;
+					bins.Pairs.push_back((tile << 24) | light.LightIndex);
+					bins.Counts[tile]++;
+				}
+			}
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t tile = 0; tile < CLUSTER_GRID_X * CLUSTER_GRID_Y; tile++) {
+			bins.Offsets[tile] = offset;
+			offset += bins.Counts[tile];
+		}
+
+		// Counting sort by tile.
+		uint32_t cursors[CLUSTER_GRID_X * CLUSTER_GRID_Y];
+		std::memcpy(cursors, bins.Offsets, sizeof(cursors));
+		bins.Indices.resize(bins.Pairs.size());
+		for (uint32_t pair : bins.Pairs) {
+			bins.Indices[cursors[pair >> 24]++] = pair & 0x00FFFFFF;
+		}
+	}
+
+}
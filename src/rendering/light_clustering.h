@@ -0,0 +1,104 @@
+#ifndef LIGHT_CLUSTERING_H
+#define LIGHT_CLUSTERING_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "../entities/lights/light.h"
+
+namespace gigno {
+
+	class ThreadPool;
+
+	// Cluster grid : tiles of the screen times depth slices of the view frustum. Hard-coded in simple_shader.frag as well.
+	const uint32_t CLUSTER_GRID_X = 16;
+	const uint32_t CLUSTER_GRID_Y = 9;
+	const uint32_t CLUSTER_GRID_Z = 24;
+	const uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+	static_assert(CLUSTER_GRID_X * CLUSTER_GRID_Y <= 256, "The tile of a slice must fit in 8 bits (see LightClusterer::SliceBins_t).");
+
+	// Lights of a cluster : LightIndices[FirstIndex, FirstIndex + Count). Cluster (x, y, z) is at x + y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y.
+	struct ClusterRange_t {
+		uint32_t FirstIndex = 0;
+		uint32_t Count = 0;
+	};
+
+	/*
+	Bins the local lights of the scene into a view space cluster grid, so that a fragment only goes through the lights that can reach it.
+
+	Usage :
+		* Initialisation : Default constructor. Owned by the SwapChain.
+		* Key Functions :
+		  * void Build( ... ) : Once per frame, before reading anything back.
+		  * GetLights(), GetClusters(), GetLightIndices() : To copy to the frame's storage buffers.
+		  * GetDepthParams(), GetScreenParams() : How the shader finds its cluster (see UniformBufferData_t).
+	Implementation :
+		* Lights with no range (directional, environment) are not binned : they come first in GetLights() and every fragment goes through them.
+		* Slices split the camera's [near, far] depth range. They are exponential for perspective projections with near > 0, so that
+		  clusters stay roughly cubic far away, linear otherwise. When far does not clip (near <= 0), the last slice has no end.
+		* Each light is first bounded to a box of clusters (projected view space bounds, slices), then tested against the view space
+		  box of each of these clusters.
+		* Slices are binned in parallel on the thread pool, each in its own list, then concatenated.
+	*/
+	class LightClusterer {
+	public:
+		// @param near, far of the camera the projection was built by (see Camera::GetNear()).
+		void Build(const glm::mat4 &view, const glm::mat4 &projection, float near, float far, uint32_t width, uint32_t height, const std::vector<const Light *> &lights, ThreadPool *pool);
+
+		const std::vector<LightData_t> &GetLights() const { return m_Lights; }
+		uint32_t GetGlobalLightCount() const { return m_GlobalLightCount; }
+		const std::vector<ClusterRange_t> &GetClusters() const { return m_Clusters; }
+		const std::vector<uint32_t> &GetLightIndices() const { return m_LightIndices; }
+
+		// slice = floor(f(view depth) * x + y), f being log() if z != 0, identity otherwise.
+		glm::vec4 GetDepthParams() const { return m_DepthParams; }
+		// tile = floor(fragment coordinates * xy).
+		glm::vec4 GetScreenParams() const { return m_ScreenParams; }
+
+	private:
+		void SetupSlices(const glm::mat4 &projection, float near, float far);
+		void BoundLight(uint32_t localIndex);
+		void BinSlice(uint32_t slice);
+		uint32_t SliceOf(float viewDepth) const;
+
+		struct LocalLight_t {
+			glm::vec3 ViewCenter{};
+			float Range = 0.0f;
+			uint32_t LightIndex = 0;
+			// Box of clusters the light may touch. Empty if MinZ > MaxZ.
+			uint32_t MinX = 0, MaxX = 0;
+			uint32_t MinY = 0, MaxY = 0;
+			uint32_t MinZ = 1, MaxZ = 0;
+		};
+
+		struct SliceBins_t {
+			uint32_t Counts[CLUSTER_GRID_X * CLUSTER_GRID_Y]{};
+			uint32_t Offsets[CLUSTER_GRID_X * CLUSTER_GRID_Y]{};
+			std::vector<uint32_t> Pairs;   // Tile of the slice in the top 8 bits, index in m_Lights below. In binning order.
+			std::vector<uint32_t> Indices; // Light indices of the slice's clusters, one cluster after the other.
+		};
+
+		glm::mat4 m_Projection{ 1.0f };
+		bool m_IsPerspective = false;
+		float m_Near = 0.0f;
+		float m_Far = 1.0f;
+		bool m_ClipsFar = true; // Whether nothing past m_Far is drawn : otherwise, the last slice goes on forever.
+		float m_SliceDepths[CLUSTER_GRID_Z + 1]{};
+
+		std::vector<LightData_t> m_Lights;
+		uint32_t m_GlobalLightCount = 0;
+		std::vector<LocalLight_t> m_LocalLights;
+
+		SliceBins_t m_Slices[CLUSTER_GRID_Z];
+		std::vector<ClusterRange_t> m_Clusters;
+		std::vector<uint32_t> m_LightIndices;
+
+		glm::vec4 m_DepthParams{};
+		glm::vec4 m_ScreenParams{};
+	};
+
+}
+
+#endif
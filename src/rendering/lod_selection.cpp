@@ -0,0 +1,81 @@
+#include "lod_selection.h"
+#include "frustum_culling.h"
+#include "model.h"
+#include "../entities/rendered_entity.h"
+#include "../threading/thread_pool.h"
+
+#include <algorithm>
+
+namespace gigno {
+
+	// Below this, a batch is not worth handing to another thread.
+	const uint32_t LOD_SELECTION_MIN_BATCH = 256;
+
+	void LodSelector::Select(const glm::mat4 &view, const glm::mat4 &projection, uint32_t viewportHeight, float maxErrorPixels,
+							 const std::vector<const RenderedEntity *> &entities, uint32_t objectCount, const FrustumCuller &bounds, ThreadPool *pool) {
+		if (m_Lods.size() < objectCount) {
+			m_Lods.resize(objectCount, 0);
+		}
+
+		// View space depth is along +z (see Camera::GetViewMatrix()). Clip space w = depth * p[2][3] + p[3][3], for the projections built by Camera.
+		const glm::vec4 view_depth_row{ view[0][2], view[1][2], view[2][2], view[3][2] };
+		const float half_height_pixels = glm::abs(projection[1][1]) * 0.5f * viewportHeight;
+		const float w_per_depth = projection[2][3];
+		const float w_offset = projection[3][3];
+
+		pool->ParallelFor(static_cast<uint32_t>(entities.size()), LOD_SELECTION_MIN_BATCH, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				const RenderedEntity *entity = entities[i];
+				const uint32_t index = entity->ObjectIndex;
+				const giModel &model = *entity->pModel;
+				if (model.GetLodCount() == 1 || maxErrorPixels <= 0.0f) {
+					m_Lods[index] = 0;
+					continue;
+				}
+
+				const float radius = bounds.GetWorldRadius(index);
+				const float depth = glm::dot(view_depth_row, glm::vec4{ bounds.GetWorldCenter(index), 1.0f });
+				const float nearest_w = (depth - radius) * w_per_depth + w_offset;
+				if (nearest_w <= 1e-4f) {
+					m_Lods[index] = 0; // The camera is inside, or right against, the bounds.
+					continue;
+				}
+
+				const uint32_t current = std::min<uint32_t>(m_Lods[index], model.GetLodCount() - 1);
+				m_Lods[index] = static_cast<uint8_t>(SelectLod(model, radius, half_height_pixels / nearest_w, maxErrorPixels, current));
+			}
+		});
+
+		m_ReducedCount = 0;
+		for (const RenderedEntity *entity : entities) {
+			m_ReducedCount += m_Lods[entity->ObjectIndex] != 0 ? 1 : 0;
+		}
+	}
+
+	uint32_t LodSelector::SelectLod(const giModel &model, float worldRadius, float pixelsPerUnit, float maxErrorPixels, uint32_t currentLod) {
+		const float pixels_per_error = worldRadius * pixelsPerUnit;
+
+		// Coarsest levels first : errors grow with the level.
+		uint32_t coarsest_allowed = 0; // Coarsest level under the threshold.
+		uint32_t coarsest_settled = 0; // Coarsest level under the threshold minus the hysteresis margin. Never coarser than coarsest_allowed.
+		for (uint32_t lod = model.GetLodCount() - 1; lod > 0; lod--) {
+			const float error_pixels = model.GetLod(lod).Error * pixels_per_error;
+			if (coarsest_allowed == 0 && error_pixels <= maxErrorPixels) {
+				coarsest_allowed = lod;
+			}
+			if (coarsest_settled == 0 && error_pixels <= maxErrorPixels * (1.0f - LOD_HYSTERESIS)) {
+				coarsest_settled = lod;
+				break;
+			}
+		}
+
+		if (currentLod > coarsest_allowed) {
+			return coarsest_allowed; // Too coarse : refine right away.
+		}
+		if (currentLod < coarsest_settled) {
+			return coarsest_settled;
+		}
+		return currentLod;
+	}
+
+}
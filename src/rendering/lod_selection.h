@@ -0,0 +1,58 @@
+#ifndef LOD_SELECTION_H
+#define LOD_SELECTION_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace gigno {
+
+	class RenderedEntity;
+	class FrustumCuller;
+	class ThreadPool;
+	class giModel;
+
+	// A coarser level of detail is only switched to once its error is this fraction of the threshold below it.
+	const float LOD_HYSTERESIS = 0.25f;
+
+	/*
+	Picks the level of detail of each rendered entity from the size its simplification error projects to on screen.
+
+	Usage :
+		* Initialisation : Default constructor. Owned by the SwapChain.
+		* Key Functions :
+		  * void Select( ... ) : Once per frame, after the FrustumCuller's bounds were updated.
+		  * uint32_t GetLod( ... ) : Level of detail of an entity's ObjectIndex, as of the last Select().
+	Implementation :
+		* The error of a level (see MeshLod_t) is scaled by the entity's world bounding sphere, and projected at the sphere's
+		  nearest depth : the coarsest level whose error stays under the threshold, in pixels, is used.
+		* Hysteresis : the level of an entity only gets coarser once the error of the new level is under (1 - LOD_HYSTERESIS)
+		  times the threshold, so that an entity at the boundary does not switch back and forth every frame.
+		* Levels are kept per ObjectIndex from frame to frame.
+	*/
+	class LodSelector {
+	public:
+		/*
+		@param viewportHeight in pixels.
+		@param maxErrorPixels 0 to always use the full meshes.
+		@param entities resident entities, whose bounds are up to date in 'bounds'.
+		*/
+		void Select(const glm::mat4 &view, const glm::mat4 &projection, uint32_t viewportHeight, float maxErrorPixels,
+					const std::vector<const RenderedEntity *> &entities, uint32_t objectCount, const FrustumCuller &bounds, ThreadPool *pool);
+
+		uint32_t GetLod(uint32_t objectIndex) const { return m_Lods[objectIndex]; }
+		// Entities drawn with a simplified mesh, as of the last Select().
+		uint32_t GetReducedCount() const { return m_ReducedCount; }
+
+	private:
+		// @param pixelsPerUnit size on screen, in pixels, of a world unit at the entity's nearest depth.
+		static uint32_t SelectLod(const giModel &model, float worldRadius, float pixelsPerUnit, float maxErrorPixels, uint32_t currentLod);
+
+		std::vector<uint8_t> m_Lods; // Per ObjectIndex.
+		uint32_t m_ReducedCount = 0;
+	};
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+#include "memory_allocator.h"
+#include "../error_macros.h"
+
+#include <algorithm>
+
+namespace gigno {
+
+	MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physDevice) :
+		m_Device{ device }
+	{
+		vkGetPhysicalDeviceMemoryProperties(physDevice, &m_MemoryProperties);
+	}
+
+	void MemoryAllocator::CleanUp() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		for (Block_t &block : m_Blocks) {
+			if (block.Memory != VK_NULL_HANDLE) {
+				vkFreeMemory(m_Device, block.Memory, nullptr);
+			}
+		}
+		m_Blocks.clear();
+
+		m_UsedBytes = 0;
+		m_ReservedBytes = 0;
+		m_AllocationCount = 0;
+	}
+
+	bool MemoryAllocator::Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags props, AllocationStrategy_t strategy, GpuAllocation_t &allocation) {
+		const uint32_t memory_type_index = FindMemoryTypeIndex(requirements.memoryTypeBits, props);
+		if (memory_type_index == UINT32_MAX) {
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		if (strategy != ALLOCATION_STRATEGY_DEDICATED && requirements.size > GetBlockSize(memory_type_index) / 2) {
+			strategy = ALLOCATION_STRATEGY_DEDICATED;
+		}
+		if (strategy == ALLOCATION_STRATEGY_DEDICATED) {
+			return AllocateDedicated(requirements, memory_type_index, allocation);
+		}
+
+		for (uint32_t i = 0; i < m_Blocks.size(); i++) {
+			const Block_t &block = m_Blocks[i];
+			if (block.Memory == VK_NULL_HANDLE || block.MemoryTypeIndex != memory_type_index || block.Strategy != strategy) {
+				continue;
+			}
+			if (AllocateFromBlock(i, requirements, allocation)) {
+				return true;
+			}
+		}
+
+		const uint32_t block_index = CreateBlock(memory_type_index, strategy);
+		if (block_index == UINT32_MAX) {
+			// The heap cannot fit another block. The resource alone might still fit.
+			return AllocateDedicated(requirements, memory_type_index, allocation);
+		}
+		return AllocateFromBlock(block_index, requirements, allocation);
+	}
+
+	void MemoryAllocator::Free(GpuAllocation_t &allocation) {
+		if (allocation.Memory == VK_NULL_HANDLE) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		if (allocation.Strategy == ALLOCATION_STRATEGY_DEDICATED) {
+			vkFreeMemory(m_Device, allocation.Memory, nullptr); // Implicitly unmapped.
+			m_ReservedBytes -= allocation.Size;
+			m_DedicatedCount--;
+		} else {
+			Block_t &block = m_Blocks[allocation.BlockIndex];
+			if (block.Strategy == ALLOCATION_STRATEGY_TLSF) {
+				block.pTlsf->Free(allocation.Node);
+			} else if (--block.LinearCount == 0) {
+				block.LinearHead = 0;
+			}
+
+			// Keep a single empty block per memory type and strategy around, so that alternating allocations and frees do not
+			// hit the driver each time.
+			if (block.GetAllocationCount() == 0) {
+				for (uint32_t i = 0; i < m_Blocks.size(); i++) {
+					const Block_t &other = m_Blocks[i];
+					if (i != allocation.BlockIndex && other.Memory != VK_NULL_HANDLE && other.MemoryTypeIndex == block.MemoryTypeIndex &&
+						other.Strategy == block.Strategy && other.GetAllocationCount() == 0) {
+						ReleaseBlock(allocation.BlockIndex);
+						break;
+					}
+				}
+			}
+		}
+
+		m_UsedBytes -= allocation.Size;
+		m_AllocationCount--;
+
+		allocation = GpuAllocation_t{};
+	}
+
+	uint32_t MemoryAllocator::FindMemoryTypeIndex(uint32_t typeFilter, VkMemoryPropertyFlags props) const {
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1u << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & props) == props) {
+				return i;
+			}
+		}
+
+		ERR_MSG_V(UINT32_MAX, "Failed to find suitable memory type !");
+	}
+
+	GpuMemoryStats_t MemoryAllocator::GetStats() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		GpuMemoryStats_t stats{};
+		stats.UsedBytes = m_UsedBytes;
+		stats.ReservedBytes = m_ReservedBytes;
+		stats.DedicatedCount = m_DedicatedCount;
+		stats.AllocationCount = m_AllocationCount;
+		stats.TotalAllocations = m_TotalAllocations;
+		stats.TotalDeviceAllocations = m_TotalDeviceAllocations;
+		for (const Block_t &block : m_Blocks) {
+			if (block.Memory != VK_NULL_HANDLE) {
+				stats.BlockCount++;
+			}
+		}
+		return stats;
+	}
+
+	VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const {
+		const uint32_t heap_index = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		return std::min(DEFAULT_BLOCK_SIZE, m_MemoryProperties.memoryHeaps[heap_index].size / 8);
+	}
+
+	bool MemoryAllocator::AllocateDedicated(const VkMemoryRequirements &requirements, uint32_t memoryTypeIndex, GpuAllocation_t &allocation) {
+		void *mapped = nullptr;
+		VkDeviceMemory memory = AllocateDeviceMemory(requirements.size, memoryTypeIndex, &mapped);
+		if (memory == VK_NULL_HANDLE) {
+			return false;
+		}
+
+		allocation = GpuAllocation_t{};
+		allocation.Memory = memory;
+		allocation.Offset = 0;
+		allocation.Size = requirements.size;
+		allocation.pMapped = mapped;
+		allocation.MemoryTypeIndex = memoryTypeIndex;
+		allocation.Strategy = ALLOCATION_STRATEGY_DEDICATED;
+
+		m_ReservedBytes += requirements.size;
+		m_UsedBytes += requirements.size;
+		m_DedicatedCount++;
+		m_AllocationCount++;
+		m_TotalAllocations++;
+		return true;
+	}
+
+	bool MemoryAllocator::AllocateFromBlock(uint32_t blockIndex, const VkMemoryRequirements &requirements, GpuAllocation_t &allocation) {
+		Block_t &block = m_Blocks[blockIndex];
+
+		uint64_t offset = 0;
+		uint32_t node = TlsfAllocator::INVALID_NODE;
+		if (block.Strategy == ALLOCATION_STRATEGY_TLSF) {
+			node = block.pTlsf->Allocate(requirements.size, requirements.alignment, offset);
+			if (node == TlsfAllocator::INVALID_NODE) {
+				return false;
+			}
+		} else {
+			offset = (block.LinearHead + requirements.alignment - 1) & ~(requirements.alignment - 1);
+			if (offset + requirements.size > block.Size) {
+				return false;
+			}
+			block.LinearHead = offset + requirements.size;
+			block.LinearCount++;
+		}
+
+		allocation = GpuAllocation_t{};
+		allocation.Memory = block.Memory;
+		allocation.Offset = offset;
+		allocation.Size = requirements.size;
+		allocation.pMapped = block.pMapped ? static_cast<char *>(block.pMapped) + offset : nullptr;
+		allocation.MemoryTypeIndex = block.MemoryTypeIndex;
+		allocation.BlockIndex = blockIndex;
+		allocation.Node = node;
+		allocation.Strategy = block.Strategy;
+
+		m_UsedBytes += requirements.size;
+		m_AllocationCount++;
+		m_TotalAllocations++;
+		return true;
+	}
+
+	uint32_t MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, AllocationStrategy_t strategy) {
+		const VkDeviceSize size = GetBlockSize(memoryTypeIndex);
+
+		void *mapped = nullptr;
+		VkDeviceMemory memory = AllocateDeviceMemory(size, memoryTypeIndex, &mapped);
+		if (memory == VK_NULL_HANDLE) {
+			return UINT32_MAX;
+		}
+
+		uint32_t index = 0;
+		while (index < m_Blocks.size() && m_Blocks[index].Memory != VK_NULL_HANDLE) {
+			index++;
+		}
+		if (index == m_Blocks.size()) {
+			m_Blocks.emplace_back();
+		}
+
+		Block_t &block = m_Blocks[index];
+		block.Memory = memory;
+		block.Size = size;
+		block.pMapped = mapped;
+		block.MemoryTypeIndex = memoryTypeIndex;
+		block.Strategy = strategy;
+		block.pTlsf = strategy == ALLOCATION_STRATEGY_TLSF ? std::make_unique<TlsfAllocator>(size) : nullptr;
+		block.LinearHead = 0;
+		block.LinearCount = 0;
+
+		m_ReservedBytes += size;
+		return index;
+	}
+
+	void MemoryAllocator::ReleaseBlock(uint32_t blockIndex) {
+		Block_t &block = m_Blocks[blockIndex];
+		vkFreeMemory(m_Device, block.Memory, nullptr);
+		m_ReservedBytes -= block.Size;
+		block = Block_t{};
+	}
+
+	VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **ppMapped) {
+		VkMemoryAllocateInfo allocinfo{};
+		allocinfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocinfo.pNext = nullptr;
+		allocinfo.allocationSize = size;
+		allocinfo.memoryTypeIndex = memoryTypeIndex;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkResult result = vkAllocateMemory(m_Device, &allocinfo, nullptr, &memory);
+		if (result != VK_SUCCESS) {
+			ERR_MSG_V(VK_NULL_HANDLE, "Failed to allocate GPU memory ! Vulkan Error Code : %d", (int)result);
+		}
+		m_TotalDeviceAllocations++;
+
+		*ppMapped = nullptr;
+		if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			result = vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, ppMapped);
+			if (result != VK_SUCCESS) {
+				vkFreeMemory(m_Device, memory, nullptr);
+				ERR_MSG_V(VK_NULL_HANDLE, "Failed to map GPU memory ! Vulkan Error Code : %d", (int)result);
+			}
+		}
+
+		return memory;
+	}
+
+}
@@ -0,0 +1,126 @@
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "../algorithm/tlsf.h"
+
+namespace gigno {
+
+	enum AllocationStrategy_t {
+		ALLOCATION_STRATEGY_TLSF,      // General purpose sub-allocation. Long lived resources (meshes, uniform buffers).
+		ALLOCATION_STRATEGY_LINEAR,    // Bump sub-allocation. Short lived resources freed together (staging, readback). A block is reset once all its allocations are freed.
+		ALLOCATION_STRATEGY_DEDICATED  // One VkDeviceMemory for the resource alone. Render targets and very large resources.
+	};
+
+	/*
+	A range of GPU memory handed out by the MemoryAllocator. Bind resources at Memory + Offset.
+	*/
+	struct GpuAllocation_t {
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		void *pMapped = nullptr; // Host visible memory only : persistently mapped pointer to Offset. nullptr otherwise.
+
+		uint32_t MemoryTypeIndex = UINT32_MAX;
+		uint32_t BlockIndex = UINT32_MAX;
+		uint32_t Node = TlsfAllocator::INVALID_NODE;
+		AllocationStrategy_t Strategy = ALLOCATION_STRATEGY_TLSF;
+	};
+
+	struct GpuMemoryStats_t {
+		VkDeviceSize UsedBytes = 0;     // Bytes handed out to resources.
+		VkDeviceSize ReservedBytes = 0; // Bytes allocated from the driver (blocks + dedicated allocations).
+		uint32_t BlockCount = 0;
+		uint32_t DedicatedCount = 0;
+		uint32_t AllocationCount = 0;
+		// Since creation, never decreasing : per frame counts are their differences (see RenderStats_t).
+		uint64_t TotalAllocations = 0;       // Successful Allocate() calls.
+		uint64_t TotalDeviceAllocations = 0; // Successful vkAllocateMemory calls.
+	};
+
+	/*
+	Carves GPU memory out of large per-memory-type blocks instead of calling vkAllocateMemory per resource.
+
+	Usage :
+		* Initialisation : Initialized by constructor, owned by the Device.
+		* Clean Up : CleanUp() must be called before the VkDevice is destroyed. Releases every block, even if still in use.
+		* Key Functions :
+		  * bool Allocate( ... )
+		  * void Free( ... )
+		* Pooled blocks only hold buffers : bufferImageGranularity is not handled, images must use ALLOCATION_STRATEGY_DEDICATED.
+		* Host visible blocks are mapped once on creation and stay mapped (see GpuAllocation_t::pMapped).
+		* Thread safe.
+	*/
+	class MemoryAllocator {
+	public:
+		MemoryAllocator(VkDevice device, VkPhysicalDevice physDevice);
+		MemoryAllocator(const MemoryAllocator &) = delete;
+		MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+		void CleanUp();
+
+		/*
+		@brief Finds memory for a resource. Falls back to ALLOCATION_STRATEGY_DEDICATED for resources larger than half a block.
+		@param allocation filled on success. Pass it back to Free().
+		@returns whether the allocation succeeded.
+		*/
+		bool Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags props, AllocationStrategy_t strategy, GpuAllocation_t &allocation);
+		// Resets 'allocation'. Does nothing if it was already freed.
+		void Free(GpuAllocation_t &allocation);
+
+		uint32_t FindMemoryTypeIndex(uint32_t typeFilter, VkMemoryPropertyFlags props) const;
+
+		GpuMemoryStats_t GetStats() const;
+		VkDevice GetDevice() const { return m_Device; }
+
+	private:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		struct Block_t {
+			VkDeviceMemory Memory = VK_NULL_HANDLE; // VK_NULL_HANDLE : unused slot.
+			VkDeviceSize Size = 0;
+			void *pMapped = nullptr;
+			uint32_t MemoryTypeIndex = UINT32_MAX;
+			AllocationStrategy_t Strategy = ALLOCATION_STRATEGY_TLSF;
+
+			std::unique_ptr<TlsfAllocator> pTlsf; // TLSF blocks only.
+			VkDeviceSize LinearHead = 0;          // LINEAR blocks only.
+			uint32_t LinearCount = 0;             // LINEAR blocks only.
+
+			uint32_t GetAllocationCount() const { return pTlsf ? pTlsf->GetAllocationCount() : LinearCount; }
+		};
+
+		VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex) const;
+
+		bool AllocateDedicated(const VkMemoryRequirements &requirements, uint32_t memoryTypeIndex, GpuAllocation_t &allocation);
+		bool AllocateFromBlock(uint32_t blockIndex, const VkMemoryRequirements &requirements, GpuAllocation_t &allocation);
+		// Returns the index of the new block, UINT32_MAX on failure.
+		uint32_t CreateBlock(uint32_t memoryTypeIndex, AllocationStrategy_t strategy);
+		void ReleaseBlock(uint32_t blockIndex);
+
+		// Allocates and maps (if host visible) a VkDeviceMemory. Returns VK_NULL_HANDLE on failure.
+		VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **ppMapped);
+
+		VkDevice m_Device;
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+
+		std::vector<Block_t> m_Blocks;
+
+		VkDeviceSize m_UsedBytes = 0;
+		VkDeviceSize m_ReservedBytes = 0;
+		uint32_t m_DedicatedCount = 0;
+		uint32_t m_AllocationCount = 0;
+		uint64_t m_TotalAllocations = 0;
+		uint64_t m_TotalDeviceAllocations = 0;
+
+		mutable std::mutex m_Mutex;
+	};
+
+}
+
+#endif
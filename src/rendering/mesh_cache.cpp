@@ -0,0 +1,233 @@
+#include "mesh_cache.h"
+#include "device.h"
+#include "upload_manager.h"
+#include "swapchain.h"
+#include "mesh_file.h"
+#include "../error_macros.h"
+
+#include "application.h"
+
+#include "../threading/thread_pool.h"
+#include "../debug/console/command.h"
+
+#include <thread>
+
+namespace gigno {
+
+	CONSOLE_COMMAND_HELP(mesh_cache, "Usage : mesh_cache\nLogs the mesh cache hit rate and the memory used by cached meshes.") {
+		const MeshCacheStats_t stats = Application::Singleton()->GetRenderer()->GetMeshCacheStats();
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		console->LogInfo("Mesh cache : %u hits, %u misses (%.1f%% hit rate), %u misses loaded from mesh files, %u loads in progress.", stats.Hits, stats.Misses, stats.HitRate() * 100.0f, stats.FileLoads, stats.PendingLoads);
+		console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  %u meshes alive, %.2f MiB used, %.2f MiB saved by hits.", stats.MeshCount,
+			stats.GpuBytes / (1024.0 * 1024.0), stats.SavedBytes / (1024.0 * 1024.0));
+	}
+
+	MeshCache::MeshCache(const Device &device, UploadManager &uploadManager) :
+		m_Device{ device },
+		m_UploadManager{ uploadManager }
+	{
+	}
+
+	MeshHandle::MeshHandle(std::shared_ptr<giModel> model) :
+		m_pSlot{ std::make_shared<Slot_t>() } {
+		m_pSlot->pModel = std::move(model);
+	}
+
+	void MeshCache::CleanUp() {
+		// Requests use the device : let them finish. They may wait for a Flush() to free the staging ring.
+		while (m_RunningRequests.load(std::memory_order_acquire) > 0) {
+			m_UploadManager.Flush();
+			std::this_thread::yield();
+		}
+		// Released outside of the lock : the models retire themselves.
+		std::vector<LoadedRequest_t> loaded_requests{};
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			loaded_requests.swap(m_LoadedRequests);
+		}
+		loaded_requests.clear();
+		m_PendingRequests.clear();
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		for (RetiredModel_t &retired : m_RetiredModels) {
+			delete retired.pModel;
+		}
+		m_RetiredModels.clear();
+		m_Entries.clear();
+	}
+
+	std::shared_ptr<giModel> MeshCache::Load(const std::string &path, const ModelImportOptions_t &options) {
+		Key_t key{ path, options };
+		if (std::shared_ptr<giModel> cached = FindCached(key, true)) {
+			return cached;
+		}
+
+		// Import outside of the lock : it is by far the longest part.
+		bool is_from_file = false;
+		std::shared_ptr<giModel> model = MakeShared(Import(path, options, is_from_file), &key);
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Entries[key] = model;
+		m_FileLoads += is_from_file ? 1 : 0;
+		return model;
+	}
+
+	MeshHandle MeshCache::Request(const std::string &path, const ModelImportOptions_t &options, ThreadPool *pool) {
+		Key_t key{ path, options };
+		if (std::shared_ptr<giModel> cached = FindCached(key, false)) {
+			return MeshHandle{ std::move(cached) };
+		}
+
+		auto pending = m_PendingRequests.find(key);
+		if (pending != m_PendingRequests.end()) {
+			return MeshHandle{ pending->second };
+		}
+
+		std::shared_ptr<MeshHandle::Slot_t> slot = std::make_shared<MeshHandle::Slot_t>();
+		m_PendingRequests.emplace(key, slot);
+		m_RunningRequests.fetch_add(1, std::memory_order_relaxed);
+		pool->Submit([this, key]() {
+			std::shared_ptr<giModel> model = Load(key.Path, key.Options);
+			{
+				std::lock_guard<std::mutex> lock{ m_Mutex };
+				m_LoadedRequests.push_back({ key, std::move(model) });
+			}
+			m_RunningRequests.fetch_sub(1, std::memory_order_release);
+		});
+		return MeshHandle{ std::move(slot) };
+	}
+
+	giModel *MeshCache::Import(const std::string &path, const ModelImportOptions_t &options, bool &isFromFile) {
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		MeshFile file;
+		if (IsMeshFilePath(path)) {
+			if (!file.Open(path)) {
+				// As for a source that cannot be imported : the model is empty.
+				ERR_MSG_V(new giModel(m_Device, ModelData_t{}, m_UploadManager), "'%s' is not a valid mesh file (version %u expected) !", path.c_str(), MESH_FILE_VERSION);
+			}
+			return new giModel(m_Device, file.GetStreams(), m_UploadManager);
+		}
+
+		// The mesh file next to the source is reused as long as the source and the options did not change.
+		const uint64_t source_hash = HashMeshSource(path, options);
+		const std::string cache_path = GetMeshFilePath(path, options);
+		if (source_hash != 0 && file.Open(cache_path, source_hash)) {
+			isFromFile = true;
+			return new giModel(m_Device, file.GetStreams(), m_UploadManager);
+		}
+
+		ModelData_t data = ModelData_t::FromObjFile(path.c_str(), options);
+		if (data.Optimization.IsOptimized) {
+			console->LogInfo("Optimized '%s' : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f.", path.c_str(),
+				data.Optimization.Before.ACMR, data.Optimization.After.ACMR, data.Optimization.Before.ATVR, data.Optimization.After.ATVR);
+		}
+		if (data.Lods.size() > 1) {
+			console->LogInfo("Simplified '%s' : %u levels of detail, %u to %u triangles.", path.c_str(),
+				static_cast<uint32_t>(data.Lods.size()), data.Lods.front().IndexCount / 3, data.Lods.back().IndexCount / 3);
+		}
+
+		const EncodedMesh_t encoded = EncodedMesh_t::FromModelData(data);
+		if (source_hash != 0 && !WriteMeshFile(cache_path, encoded, source_hash)) {
+			console->LogWarning("Could not write the mesh file '%s'. '%s' will be imported again on the next load.", cache_path.c_str(), path.c_str());
+		}
+		return new giModel(m_Device, encoded.GetStreams(), m_UploadManager);
+	}
+
+	std::shared_ptr<giModel> MeshCache::Create(const ModelData_t &data) {
+		return MakeShared(new giModel(m_Device, data, m_UploadManager), nullptr);
+	}
+
+	void MeshCache::Update(uint64_t frameIndex) {
+		std::vector<LoadedRequest_t> loaded_requests{};
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			loaded_requests.swap(m_LoadedRequests);
+		}
+		// Outside of the lock : a model whose handles were all dropped while it loaded retires itself when its slot dies.
+		for (LoadedRequest_t &loaded : loaded_requests) {
+			auto pending = m_PendingRequests.find(loaded.Key);
+			pending->second->pModel = std::move(loaded.pModel);
+			m_PendingRequests.erase(pending);
+		}
+		loaded_requests.clear();
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_FrameIndex = frameIndex;
+
+		m_DestroyedModelIds.clear();
+		for (size_t i = 0; i < m_RetiredModels.size();) {
+			if (frameIndex >= m_RetiredModels[i].RetiredAtFrame + MAX_FRAMES_IN_FLIGHT) {
+				m_DestroyedModelIds.push_back(m_RetiredModels[i].pModel->GetId());
+				delete m_RetiredModels[i].pModel;
+				m_RetiredModels[i] = m_RetiredModels.back();
+				m_RetiredModels.pop_back();
+			} else {
+				i++;
+			}
+		}
+	}
+
+	MeshCacheStats_t MeshCache::GetStats() const {
+		MeshCacheStats_t stats{};
+		// Released after the lock : the last reference to a model retires it, which locks again.
+		std::vector<std::shared_ptr<giModel>> models{};
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			stats.Hits = m_Hits;
+			stats.Misses = m_Misses;
+			stats.SavedBytes = m_SavedBytes;
+			stats.FileLoads = m_FileLoads;
+			stats.PendingLoads = m_RunningRequests.load(std::memory_order_relaxed);
+			models.reserve(m_Entries.size());
+			for (const auto &entry : m_Entries) {
+				if (std::shared_ptr<giModel> model = entry.second.lock()) {
+					stats.MeshCount++;
+					stats.GpuBytes += model->GetGpuMemorySize();
+					models.push_back(std::move(model));
+				}
+			}
+		}
+		return stats;
+	}
+
+	std::shared_ptr<giModel> MeshCache::FindCached(const Key_t &key, bool countMiss) {
+		// Returned out of the lock : if every other reference is dropped meanwhile, this one retires the model, which locks again.
+		std::shared_ptr<giModel> model{};
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Entries.find(key);
+		if (it != m_Entries.end()) {
+			model = it->second.lock();
+		}
+		if (model) {
+			m_Hits++;
+			m_SavedBytes += model->GetGpuMemorySize();
+		} else if (countMiss) {
+			m_Misses++;
+		}
+		return model;
+	}
+
+	std::shared_ptr<giModel> MeshCache::MakeShared(giModel *model, const Key_t *key) {
+		if (key) {
+			Key_t key_copy = *key;
+			return std::shared_ptr<giModel>(model, [this, key_copy](giModel *released) { Retire(released, &key_copy); });
+		}
+		return std::shared_ptr<giModel>(model, [this](giModel *released) { Retire(released, nullptr); });
+	}
+
+	void MeshCache::Retire(giModel *model, const Key_t *key) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		if (key) {
+			auto it = m_Entries.find(*key);
+			if (it != m_Entries.end() && it->second.expired()) {
+				m_Entries.erase(it);
+			}
+		}
+
+		// Frames up to the current one may still read the model's buffers.
+		m_RetiredModels.push_back({ model, m_FrameIndex });
+	}
+
+}
@@ -0,0 +1,159 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "vulkan/vulkan.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "model.h"
+
+namespace gigno {
+
+	class Device;
+	class UploadManager;
+	class ThreadPool;
+
+	struct MeshCacheStats_t {
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;
+		uint32_t FileLoads = 0;      // Misses loaded from an up to date mesh file instead of imported.
+		uint32_t PendingLoads = 0;   // Requests still loading on the thread pool.
+		uint32_t MeshCount = 0;      // Cached meshes currently alive.
+		VkDeviceSize GpuBytes = 0;   // Device memory used by the cached meshes alive.
+		VkDeviceSize SavedBytes = 0; // Device memory that hits did not have to allocate.
+
+		float HitRate() const { return Hits + Misses == 0 ? 0.0f : static_cast<float>(Hits) / static_cast<float>(Hits + Misses); }
+	};
+
+	/*
+	A mesh requested from the MeshCache : empty until the mesh is loaded, then shares it as a std::shared_ptr<giModel> would.
+	Can be held before the mesh exists. Main thread only.
+	*/
+	class MeshHandle {
+	public:
+		MeshHandle() = default;
+		// Handle of a model already loaded.
+		explicit MeshHandle(std::shared_ptr<giModel> model);
+
+		// 'nullptr' until the mesh is loaded.
+		giModel *Get() const { return m_pSlot ? m_pSlot->pModel.get() : nullptr; }
+		giModel *operator->() const { return Get(); }
+		giModel &operator*() const { return *Get(); }
+
+		bool IsLoaded() const { return Get() != nullptr; }
+		// Loaded and its buffers uploaded : it can be drawn.
+		bool IsResident() const { return IsLoaded() && Get()->IsResident(); }
+
+	private:
+		friend class MeshCache;
+
+		// Shared by every handle of a request. Filled by MeshCache::Update() once the request completes.
+		struct Slot_t {
+			std::shared_ptr<giModel> pModel;
+		};
+		explicit MeshHandle(std::shared_ptr<Slot_t> slot) : m_pSlot{ std::move(slot) } {}
+
+		std::shared_ptr<Slot_t> m_pSlot;
+	};
+
+	/*
+	Shares giModels between every user of the same asset.
+
+	Usage :
+		* Initialisation : Initialized by constructor, owned by the RenderingServer.
+		* Clean Up : Must call CleanUp() once the GPU is idle and every model was released.
+		* Key Functions :
+		  * std::shared_ptr<giModel> Load( ... ) : Imports the file on the first request. Later requests get the same giModel.
+		    Loads mesh files (.gmesh, see mesh_file.h) as they are. Other files are imported once : the result is written to a mesh
+		    file next to them, loaded instead as long as the source and the import options do not change.
+		  * MeshHandle Request( ... ) : As Load(), on the thread pool : returns right away with a handle the mesh is given to
+		    once loaded. Requests of a mesh already loaded, or already requested, share it without waiting for the pool.
+		  * std::shared_ptr<giModel> Create( ... ) : Uncached model from procedural data, with the same lifetime rules.
+		  * void Update( ... ) : Once per frame, hands the loaded meshes to their handles, and destroys the models released by
+		    their last user that no frame in flight uses.
+		* The cache only holds weak references : a model dies with its last user, the cache never keeps one alive.
+		* Thread safe, except Request() and Update() : main thread only.
+	Implementation :
+		* A request is imported by Load() on a worker. Its buffers are uploaded through the UploadManager's staging ring like any
+		  other model's, so a handle's mesh is loaded some frames before it is resident.
+	*/
+	class MeshCache {
+	public:
+		MeshCache(const Device &device, UploadManager &uploadManager);
+		MeshCache(const MeshCache &) = delete;
+		MeshCache &operator=(const MeshCache &) = delete;
+
+		void CleanUp();
+
+		std::shared_ptr<giModel> Load(const std::string &path, const ModelImportOptions_t &options = {});
+		MeshHandle Request(const std::string &path, const ModelImportOptions_t &options, ThreadPool *pool);
+		std::shared_ptr<giModel> Create(const ModelData_t &data);
+
+		// @param frameIndex number of frames submitted so far. The fence of the current frame must have been waited.
+		// Main thread only.
+		void Update(uint64_t frameIndex);
+		// Ids of the models the last Update() destroyed : no frame in flight uses them anymore. Main thread only.
+		const std::vector<uint32_t> &GetDestroyedModelIds() const { return m_DestroyedModelIds; }
+
+		MeshCacheStats_t GetStats() const;
+
+	private:
+		struct Key_t {
+			std::string Path;
+			ModelImportOptions_t Options;
+
+			bool operator==(const Key_t &other) const { return other.Path == Path && other.Options == Options; }
+		};
+		struct KeyHasher_t {
+			size_t operator()(const Key_t &key) const { return std::hash<std::string>()(key.Path) ^ (key.Options.Hash() << 1); }
+		};
+
+		struct RetiredModel_t {
+			giModel *pModel;
+			uint64_t RetiredAtFrame;
+		};
+
+		struct LoadedRequest_t {
+			Key_t Key;
+			std::shared_ptr<giModel> pModel;
+		};
+
+		// @param isFromFile set to true if the model was loaded from an up to date mesh file.
+		giModel *Import(const std::string &path, const ModelImportOptions_t &options, bool &isFromFile);
+		// The loaded model of 'key', counted as a hit, or nullptr (counted as a miss if 'countMiss').
+		std::shared_ptr<giModel> FindCached(const Key_t &key, bool countMiss);
+		// Wraps a new model in a shared_ptr whose deleter retires it instead of destroying it.
+		std::shared_ptr<giModel> MakeShared(giModel *model, const Key_t *key);
+		void Retire(giModel *model, const Key_t *key);
+
+		const Device &m_Device;
+		UploadManager &m_UploadManager;
+
+		std::unordered_map<Key_t, std::weak_ptr<giModel>, KeyHasher_t> m_Entries;
+		std::vector<RetiredModel_t> m_RetiredModels;
+		std::vector<uint32_t> m_DestroyedModelIds;
+		uint64_t m_FrameIndex = 0;
+
+		// Requests on the thread pool, by key, so that a request already loading is shared. Main thread only.
+		std::unordered_map<Key_t, std::shared_ptr<MeshHandle::Slot_t>, KeyHasher_t> m_PendingRequests;
+		// Loaded by the workers, handed to their slots by Update().
+		std::vector<LoadedRequest_t> m_LoadedRequests;
+		// Requests whose job did not finish : CleanUp() waits for them.
+		std::atomic<uint32_t> m_RunningRequests{ 0 };
+
+		uint32_t m_Hits = 0;
+		uint32_t m_Misses = 0;
+		uint32_t m_FileLoads = 0;
+		VkDeviceSize m_SavedBytes = 0;
+
+		mutable std::mutex m_Mutex;
+	};
+
+}
+
+#endif
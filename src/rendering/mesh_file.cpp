@@ -0,0 +1,255 @@
+#include "mesh_file.h"
+
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <type_traits>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace gigno {
+
+	static_assert(std::is_trivially_copyable<MeshFileHeader_t>::value, "Mesh file headers are read straight from the mapping.");
+
+	static uint64_t AlignToMeshFile(uint64_t offset) {
+		return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+	}
+
+	// Whether [offset, offset + size) is within [0, total), without overflowing.
+	static bool FitsIn(uint64_t offset, uint64_t size, uint64_t total) {
+		return offset <= total && size <= total - offset;
+	}
+
+	// The header is read from a file anything may have written : every range the GPU will read must be checked.
+	static bool IsValidHeader(const MeshFileHeader_t &header, uint64_t fileSize) {
+		const MeshDescription_t &description = header.Description;
+		if (!FitsIn(header.VertexDataOffset, header.VertexDataSize, fileSize) || !FitsIn(header.IndexDataOffset, header.IndexDataSize, fileSize) ||
+			description.LodCount < 1 || description.LodCount > MAX_LOD_COUNT || static_cast<uint32_t>(description.VertexFormat) >= VERTEX_FORMAT_MAX_ENUM) {
+			return false;
+		}
+
+		uint64_t index_size = 0;
+		if (description.IndexType == VK_INDEX_TYPE_UINT16) {
+			index_size = sizeof(uint16_t);
+		} else if (description.IndexType == VK_INDEX_TYPE_UINT32) {
+			index_size = sizeof(uint32_t);
+		} else {
+			return false;
+		}
+		const uint64_t index_count = header.IndexDataSize / index_size;
+		for (uint32_t i = 0; i < description.LodCount; i++) {
+			if (!FitsIn(description.Lods[i].FirstIndex, description.Lods[i].IndexCount, index_count)) {
+				return false;
+			}
+		}
+
+		// Positions from the start of the vertex data, the other attributes from AttributesOffset (see giModel::Bind()).
+		const VertexLayout_t layout = VertexLayout_t::FromFormat(description.VertexFormat);
+		const uint64_t position_size = static_cast<uint64_t>(description.VertexCount) * layout.Bindings[VERTEX_POSITION_BINDING].stride;
+		const uint64_t attributes_size = static_cast<uint64_t>(description.VertexCount) * layout.Bindings[VERTEX_ATTRIBUTE_BINDING].stride;
+		return FitsIn(0, position_size, header.VertexDataSize) && FitsIn(description.AttributesOffset, attributes_size, header.VertexDataSize);
+	}
+
+	// FNV-1a, 64 bits.
+	static void HashBytes(uint64_t &hash, const void *data, size_t size) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+		}
+	}
+
+	// Unlike ModelImportOptions_t::Hash(), the same on every platform and build : it names files.
+	static uint64_t HashImportOptions(const ModelImportOptions_t &options) {
+		uint64_t hash = 0xCBF29CE484222325ull;
+		const uint8_t flags = (options.DeduplicateVertices ? 1 : 0) | (options.OptimizeVertexCache ? 2 : 0) | (options.OptimizeOverdraw ? 4 : 0) | (options.OptimizeVertexFetch ? 8 : 0);
+		const uint32_t vertex_format = static_cast<uint32_t>(options.VertexFormat);
+		HashBytes(hash, &flags, sizeof(flags));
+		HashBytes(hash, &vertex_format, sizeof(vertex_format));
+		HashBytes(hash, options.LodRatios, sizeof(options.LodRatios));
+		return hash;
+	}
+
+	MappedFile::~MappedFile() {
+		Close();
+	}
+
+	bool MappedFile::Open(const std::string &path) {
+		Close();
+	#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			return false;
+		}
+		const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		m_File = file;
+		m_Mapping = mapping;
+		m_pData = static_cast<const uint8_t *>(data);
+		m_Size = static_cast<size_t>(size.QuadPart);
+	#else
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat status{};
+		if (fstat(file, &status) != 0 || status.st_size == 0) {
+			close(file);
+			return false;
+		}
+		void *data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file); // The mapping keeps its own reference to the file.
+		if (data == MAP_FAILED) {
+			return false;
+		}
+		m_pData = static_cast<const uint8_t *>(data);
+		m_Size = static_cast<size_t>(status.st_size);
+	#endif
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (!m_pData) {
+			return;
+		}
+	#ifdef _WIN32
+		UnmapViewOfFile(m_pData);
+		CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = nullptr;
+	#else
+		munmap(const_cast<uint8_t *>(m_pData), m_Size);
+	#endif
+		m_pData = nullptr;
+		m_Size = 0;
+	}
+
+	bool MeshFile::Open(const std::string &path, uint64_t expectedSourceHash) {
+		if (!m_File.Open(path)) {
+			return false;
+		}
+
+		bool is_valid = m_File.GetSize() >= sizeof(MeshFileHeader_t);
+		if (is_valid) {
+			const MeshFileHeader_t &header = GetHeader();
+			is_valid = header.Magic == MESH_FILE_MAGIC && header.Version == MESH_FILE_VERSION &&
+					   (expectedSourceHash == 0 || header.SourceHash == expectedSourceHash) &&
+					   IsValidHeader(header, m_File.GetSize());
+		}
+		if (!is_valid) {
+			m_File.Close();
+		}
+		return is_valid;
+	}
+
+	MeshStreams_t MeshFile::GetStreams() const {
+		const MeshFileHeader_t &header = GetHeader();
+		MeshStreams_t streams{};
+		streams.Description = header.Description;
+		streams.pVertexData = m_File.GetData() + header.VertexDataOffset;
+		streams.VertexDataSize = header.VertexDataSize;
+		streams.pIndexData = m_File.GetData() + header.IndexDataOffset;
+		streams.IndexDataSize = header.IndexDataSize;
+		return streams;
+	}
+
+	bool WriteMeshFile(const std::string &path, const EncodedMesh_t &mesh, uint64_t sourceHash) {
+		MeshFileHeader_t header{};
+		header.SourceHash = sourceHash;
+		header.Description = mesh.Description;
+		header.VertexDataOffset = AlignToMeshFile(sizeof(MeshFileHeader_t));
+		header.VertexDataSize = mesh.VertexData.size();
+		header.IndexDataOffset = AlignToMeshFile(header.VertexDataOffset + header.VertexDataSize);
+		header.IndexDataSize = mesh.IndexData.size();
+
+		// Unique to the writer : requests of the same mesh on other threads, or other processes, may write it at the same time.
+		static std::atomic<uint32_t> s_WriteCount{ 0 };
+	#ifdef _WIN32
+		const unsigned long process_id = GetCurrentProcessId();
+	#else
+		const unsigned long process_id = static_cast<unsigned long>(getpid());
+	#endif
+		char suffix[48];
+		snprintf(suffix, sizeof(suffix), ".%lu-%u.tmp", process_id, s_WriteCount.fetch_add(1, std::memory_order_relaxed));
+		const std::string temporary_path = path + suffix;
+		bool is_written = false;
+		{
+			std::ofstream file{ temporary_path, std::ios::binary | std::ios::trunc };
+			if (file) {
+				const char padding[MESH_FILE_ALIGNMENT]{};
+				file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+				file.write(padding, header.VertexDataOffset - sizeof(header));
+				file.write(reinterpret_cast<const char *>(mesh.VertexData.data()), mesh.VertexData.size());
+				file.write(padding, header.IndexDataOffset - (header.VertexDataOffset + header.VertexDataSize));
+				file.write(reinterpret_cast<const char *>(mesh.IndexData.data()), mesh.IndexData.size());
+				file.close();
+				is_written = !file.fail();
+			}
+		}
+
+		// Closed first : an open file cannot be removed everywhere.
+		std::error_code error;
+		if (!is_written) {
+			std::filesystem::remove(temporary_path, error);
+			return false;
+		}
+		std::filesystem::rename(temporary_path, path, error);
+		if (error) {
+			std::filesystem::remove(temporary_path, error);
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t HashMeshSource(const std::string &path, const ModelImportOptions_t &options) {
+		MappedFile file;
+		if (!file.Open(path)) {
+			return 0;
+		}
+
+		uint64_t hash = 0xCBF29CE484222325ull;
+		HashBytes(hash, file.GetData(), file.GetSize());
+		const uint64_t options_hash = HashImportOptions(options);
+		HashBytes(hash, &options_hash, sizeof(options_hash));
+		HashBytes(hash, &MESH_FILE_VERSION, sizeof(MESH_FILE_VERSION));
+
+		return hash != 0 ? hash : 1;
+	}
+
+	std::string GetMeshFilePath(const std::string &sourcePath, const ModelImportOptions_t &options) {
+		char options_hash[24];
+		snprintf(options_hash, sizeof(options_hash), ".%016llx", (unsigned long long)HashImportOptions(options));
+		return sourcePath + options_hash + MESH_FILE_EXTENSION;
+	}
+
+	bool IsMeshFilePath(const std::string &path) {
+		const size_t extension_length = std::strlen(MESH_FILE_EXTENSION);
+		return path.size() >= extension_length && path.compare(path.size() - extension_length, extension_length, MESH_FILE_EXTENSION) == 0;
+	}
+
+}
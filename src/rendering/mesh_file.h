@@ -0,0 +1,108 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "model.h"
+
+namespace gigno {
+
+	const char *const MESH_FILE_EXTENSION = ".gmesh";
+	const uint32_t MESH_FILE_MAGIC = 0x48534D47; // "GMSH"
+	// Bumped whenever MeshFileHeader_t, MeshDescription_t, the encoding of the streams or what the importer outputs changes : older files are then rebuilt.
+	const uint32_t MESH_FILE_VERSION = 2;
+	// Alignment of the streams in the file.
+	const uint64_t MESH_FILE_ALIGNMENT = 64;
+
+	/*
+	Start of a mesh file, followed by the vertex data then the index data, each at an offset multiple of MESH_FILE_ALIGNMENT.
+	The streams are stored as uploaded (see EncodedMesh_t) : loading is a copy to the staging memory.
+	*/
+	struct MeshFileHeader_t {
+		uint32_t Magic = MESH_FILE_MAGIC;
+		uint32_t Version = MESH_FILE_VERSION;
+		uint64_t SourceHash = 0; // Of the source file and import options the mesh was built from. 0 if it has no source.
+		MeshDescription_t Description{};
+		uint64_t VertexDataOffset = 0;
+		uint64_t VertexDataSize = 0;
+		uint64_t IndexDataOffset = 0;
+		uint64_t IndexDataSize = 0;
+	};
+
+	/*
+	Read-only view of a whole file, mapped in memory.
+
+	Usage :
+		* Initialisation : Default constructor, then Open().
+		* Clean Up : Unmapped by Close() or on destruction.
+	*/
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		// @returns whether the file could be mapped. Empty files cannot.
+		bool Open(const std::string &path);
+		void Close();
+
+		const uint8_t *GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		const uint8_t *m_pData = nullptr;
+		size_t m_Size = 0;
+	#ifdef _WIN32
+		void *m_File = nullptr;
+		void *m_Mapping = nullptr;
+	#endif
+	};
+
+	/*
+	A mesh file, mapped : its streams are read straight from the mapping.
+
+	Usage :
+		* Initialisation : Default constructor, then Open().
+		* Key Functions :
+		  * MeshStreams_t GetStreams() : Pointing into the mapping : valid until the MeshFile is closed or destroyed.
+	*/
+	class MeshFile {
+	public:
+		/*
+		@param expectedSourceHash if not 0, the file is only valid if it was built from that source (see HashMeshSource()).
+		@returns whether the file is a valid mesh file of the current version. Logs nothing : an invalid cache is simply rebuilt.
+		*/
+		bool Open(const std::string &path, uint64_t expectedSourceHash = 0);
+		void Close() { m_File.Close(); }
+
+		const MeshFileHeader_t &GetHeader() const { return *reinterpret_cast<const MeshFileHeader_t *>(m_File.GetData()); }
+		MeshStreams_t GetStreams() const;
+
+	private:
+		MappedFile m_File;
+	};
+
+	/*
+	@brief Writes the mesh to a temporary file of its own, then replaces 'path' with it, so that a reader never sees a partial file.
+	Concurrent writers of the same path each write their own file : the last rename wins.
+	@returns whether the file was written.
+	*/
+	bool WriteMeshFile(const std::string &path, const EncodedMesh_t &mesh, uint64_t sourceHash);
+
+	/*
+	@brief Hash of the content of a source file (FNV-1a, 64 bits) and of the import options.
+	@returns 0 if the file cannot be read.
+	*/
+	uint64_t HashMeshSource(const std::string &path, const ModelImportOptions_t &options);
+
+	// Mesh file a source imported with 'options' is cached to : "<source>.<options hash>.gmesh", so that option sets do not overwrite each other.
+	std::string GetMeshFilePath(const std::string &sourcePath, const ModelImportOptions_t &options);
+
+	bool IsMeshFilePath(const std::string &path);
+
+}
+
+#endif
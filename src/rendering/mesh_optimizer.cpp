@@ -0,0 +1,251 @@
+#include "mesh_optimizer.h"
+#include "model.h"
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+
+namespace gigno {
+
+	static_assert(std::is_same<indice_t, uint32_t>::value, "The mesh optimizer works on 32 bits indices.");
+
+	// Clusters used for overdraw ordering when the triangles were not reordered for the vertex cache.
+	static const uint32_t DEFAULT_CLUSTER_TRIANGLE_COUNT = 64;
+
+	VertexCacheStats_t AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize) {
+		VertexCacheStats_t stats{};
+		if (indices.size() < 3 || vertexCount == 0) {
+			return stats;
+		}
+
+		// A vertex is in the cache if it entered it during the last 'cacheSize' misses.
+		std::vector<uint32_t> entered_at(vertexCount, UINT32_MAX);
+		std::vector<uint8_t> is_used(vertexCount, 0);
+		uint32_t misses = 0;
+		uint32_t used_count = 0;
+		for (uint32_t index : indices) {
+			if (entered_at[index] == UINT32_MAX || misses - entered_at[index] >= cacheSize) {
+				entered_at[index] = misses;
+				misses++;
+			}
+			if (!is_used[index]) {
+				is_used[index] = 1;
+				used_count++;
+			}
+		}
+
+		stats.ACMR = static_cast<float>(misses) / (indices.size() / 3);
+		stats.ATVR = static_cast<float>(misses) / used_count;
+		return stats;
+	}
+
+	void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, std::vector<uint32_t> *pClusters) {
+		const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (pClusters) {
+			pClusters->clear();
+		}
+		if (triangle_count == 0) {
+			return;
+		}
+
+		// Triangles using each vertex : adjacency[adjacency_offsets[v], adjacency_offsets[v + 1]).
+		std::vector<uint32_t> live_count(vertexCount, 0);
+		for (uint32_t index : indices) {
+			live_count[index]++;
+		}
+		std::vector<uint32_t> adjacency_offsets(vertexCount + 1, 0);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + live_count[v];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> cursors(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (uint32_t t = 0; t < triangle_count; t++) {
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					adjacency[cursors[indices[3 * t + corner]]++] = t;
+				}
+			}
+		}
+
+		std::vector<uint32_t> cache_time(vertexCount, 0);
+		std::vector<uint8_t> is_emitted(triangle_count, 0);
+		std::vector<uint32_t> dead_end_stack;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		uint32_t time = VERTEX_CACHE_SIZE + 1;
+		uint32_t cursor = 0; // Next vertex to look at once the dead-end stack is empty.
+		int64_t fanning = 0;
+		bool starts_cluster = true;
+		while (fanning >= 0) {
+			if (starts_cluster && pClusters) {
+				pClusters->push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+
+			// Emit every triangle around the fanning vertex.
+			candidates.clear();
+			const uint32_t f = static_cast<uint32_t>(fanning);
+			for (uint32_t a = adjacency_offsets[f]; a < adjacency_offsets[f + 1]; a++) {
+				const uint32_t t = adjacency[a];
+				if (is_emitted[t]) {
+					continue;
+				}
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					const uint32_t v = indices[3 * t + corner];
+					output.push_back(v);
+					dead_end_stack.push_back(v);
+					candidates.push_back(v);
+					live_count[v]--;
+					if (time - cache_time[v] > VERTEX_CACHE_SIZE) {
+						cache_time[v] = time;
+						time++;
+					}
+				}
+				is_emitted[t] = 1;
+			}
+
+			// Next fanning vertex : the candidate still in the cache that will stay there the longest once its triangles are emitted.
+			int64_t best = -1;
+			int64_t best_priority = -1;
+			for (uint32_t v : candidates) {
+				if (live_count[v] == 0) {
+					continue;
+				}
+				int64_t priority = 0;
+				if (time - cache_time[v] + 2 * live_count[v] <= VERTEX_CACHE_SIZE) {
+					priority = time - cache_time[v];
+				}
+				if (priority > best_priority) {
+					best_priority = priority;
+					best = v;
+				}
+			}
+
+			starts_cluster = best < 0;
+			if (best < 0) {
+				// Dead end : most recently used vertex with triangles left, then any vertex with triangles left.
+				while (!dead_end_stack.empty() && best < 0) {
+					const uint32_t v = dead_end_stack.back();
+					dead_end_stack.pop_back();
+					if (live_count[v] > 0) {
+						best = v;
+					}
+				}
+				while (best < 0 && cursor < vertexCount) {
+					if (live_count[cursor] > 0) {
+						best = cursor;
+					}
+					cursor++;
+				}
+			}
+			fanning = best;
+		}
+
+		indices.swap(output);
+	}
+
+	void OptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &clusters) {
+		const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (clusters.size() < 2) {
+			return;
+		}
+
+		// Area weighted : a large triangle pulls the centroid more than a sliver.
+		glm::vec3 mesh_centroid{ 0.0f };
+		float mesh_area = 0.0f;
+		struct Cluster_t {
+			uint32_t FirstTriangle = 0;
+			uint32_t EndTriangle = 0;
+			glm::vec3 Centroid{ 0.0f };
+			glm::vec3 Normal{ 0.0f };
+			float Sort = 0.0f;
+		};
+		std::vector<Cluster_t> cluster_infos(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++) {
+			Cluster_t &cluster = cluster_infos[c];
+			cluster.FirstTriangle = clusters[c];
+			cluster.EndTriangle = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+
+			float area = 0.0f;
+			for (uint32_t t = cluster.FirstTriangle; t < cluster.EndTriangle; t++) {
+				const glm::vec3 &p0 = vertices[indices[3 * t + 0]].Position;
+				const glm::vec3 &p1 = vertices[indices[3 * t + 1]].Position;
+				const glm::vec3 &p2 = vertices[indices[3 * t + 2]].Position;
+				const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0); // Twice the area, along the normal.
+				const float triangle_area = glm::length(cross);
+				cluster.Centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+				cluster.Normal += cross;
+				area += triangle_area;
+			}
+			mesh_centroid += cluster.Centroid;
+			mesh_area += area;
+			if (area > 0.0f) {
+				cluster.Centroid /= area;
+			}
+			const float normal_length = glm::length(cluster.Normal);
+			if (normal_length > 0.0f) {
+				cluster.Normal /= normal_length;
+			}
+		}
+		if (mesh_area > 0.0f) {
+			mesh_centroid /= mesh_area;
+		}
+
+		for (Cluster_t &cluster : cluster_infos) {
+			cluster.Sort = glm::dot(cluster.Centroid - mesh_centroid, cluster.Normal);
+		}
+		std::stable_sort(cluster_infos.begin(), cluster_infos.end(), [](const Cluster_t &a, const Cluster_t &b) { return a.Sort > b.Sort; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (const Cluster_t &cluster : cluster_infos) {
+			output.insert(output.end(), indices.begin() + 3 * cluster.FirstTriangle, indices.begin() + 3 * cluster.EndTriangle);
+		}
+		indices.swap(output);
+	}
+
+	void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Vertex> output;
+		output.reserve(vertices.size());
+		for (uint32_t &index : indices) {
+			if (remap[index] == UINT32_MAX) {
+				remap[index] = static_cast<uint32_t>(output.size());
+				output.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(output);
+	}
+
+	MeshOptimizationStats_t OptimizeMesh(ModelData_t &data, const ModelImportOptions_t &options) {
+		MeshOptimizationStats_t stats{};
+		if (!options.OptimizeVertexCache && !options.OptimizeOverdraw && !options.OptimizeVertexFetch) {
+			return stats;
+		}
+		const uint32_t vertex_count = static_cast<uint32_t>(data.Vertices.size());
+		stats.Before = AnalyzeVertexCache(data.Indices, vertex_count);
+
+		std::vector<uint32_t> clusters;
+		if (options.OptimizeVertexCache) {
+			OptimizeVertexCache(data.Indices, vertex_count, &clusters);
+		} else {
+			const uint32_t triangle_count = static_cast<uint32_t>(data.Indices.size() / 3);
+			for (uint32_t t = 0; t < triangle_count; t += DEFAULT_CLUSTER_TRIANGLE_COUNT) {
+				clusters.push_back(t);
+			}
+		}
+		if (options.OptimizeOverdraw) {
+			OptimizeOverdraw(data.Indices, data.Vertices, clusters);
+		}
+		if (options.OptimizeVertexFetch) {
+			OptimizeVertexFetch(data.Vertices, data.Indices);
+		}
+
+		stats.After = AnalyzeVertexCache(data.Indices, static_cast<uint32_t>(data.Vertices.size()));
+		stats.IsOptimized = true;
+		return stats;
+	}
+
+}
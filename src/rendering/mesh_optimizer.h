@@ -0,0 +1,60 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+
+namespace gigno {
+
+	struct Vertex;
+	struct ModelData_t;
+	struct ModelImportOptions_t;
+
+	// FIFO post-transform cache size the triangle order is optimized and measured for.
+	const uint32_t VERTEX_CACHE_SIZE = 16;
+
+	struct VertexCacheStats_t {
+		float ACMR = 0.0f; // Average Cache Miss Ratio : vertex shader runs per triangle. 0.5 at best, 3 at worst.
+		float ATVR = 0.0f; // Average Transform to Vertex Ratio : vertex shader runs per vertex. 1 at best.
+	};
+
+	struct MeshOptimizationStats_t {
+		bool IsOptimized = false;
+		VertexCacheStats_t Before{};
+		VertexCacheStats_t After{};
+	};
+
+	/*
+	@brief Simulates a FIFO post-transform vertex cache over the triangle list.
+	@param indices triangle list. Every index must be smaller than 'vertexCount'.
+	*/
+	VertexCacheStats_t AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+	/*
+	@brief Reorders the triangles so that consecutive triangles share vertices still in the post-transform cache (Tipsify, Sander et al. 2007).
+	@param pClusters if not null, filled with the first triangle of each run of triangles built around neighbouring vertices.
+	*/
+	void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, std::vector<uint32_t> *pClusters = nullptr);
+
+	/*
+	@brief Reorders the clusters of triangles so that those facing away from the mesh center are drawn first (view independent,
+	Sander et al. 2007) : whatever the view, the nearest surfaces tend to be drawn before what they hide. Triangles inside a cluster keep their order.
+	@param clusters first triangle of each cluster, in increasing order.
+	*/
+	void OptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &clusters);
+
+	/*
+	@brief Reorders the vertices in the order the triangles first use them, and remaps the indices, so that vertex fetches are close in memory.
+	Drops the vertices no triangle uses.
+	*/
+	void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+	/*
+	@brief Runs the optimizations enabled in the options, in order : vertex cache, overdraw, vertex fetch.
+	@returns the vertex cache stats before and after.
+	*/
+	MeshOptimizationStats_t OptimizeMesh(ModelData_t &data, const ModelImportOptions_t &options);
+
+}
+
+#endif
@@ -0,0 +1,373 @@
+#include "mesh_simplifier.h"
+#include "model.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+namespace gigno {
+
+	// Weight of the quadrics keeping open borders in place, relative to the planes of the triangles.
+	static const double BORDER_WEIGHT = 10.0;
+	// A level of detail must have at most this fraction of the previous level's triangles to be kept.
+	static const float LOD_MIN_REDUCTION = 0.85f;
+
+	/*
+	Sum of squared distances to planes : Q(p) = p^T A p + 2 b.p + c, A symmetric.
+	Planes are not weighted by area : sqrt(Q(p)) is then at least the distance to the farthest plane, a conservative error.
+	*/
+	struct Quadric_t {
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+
+		// Plane dot(normal, p) + d = 0, normal normalized.
+		static Quadric_t FromPlane(const glm::dvec3 &normal, double d, double weight) {
+			Quadric_t q{};
+			q.A00 = weight * normal.x * normal.x; q.A01 = weight * normal.x * normal.y; q.A02 = weight * normal.x * normal.z;
+			q.A11 = weight * normal.y * normal.y; q.A12 = weight * normal.y * normal.z;
+			q.A22 = weight * normal.z * normal.z;
+			q.B0 = weight * d * normal.x; q.B1 = weight * d * normal.y; q.B2 = weight * d * normal.z;
+			q.C = weight * d * d;
+			return q;
+		}
+
+		void Add(const Quadric_t &other) {
+			A00 += other.A00; A01 += other.A01; A02 += other.A02;
+			A11 += other.A11; A12 += other.A12;
+			A22 += other.A22;
+			B0 += other.B0; B1 += other.B1; B2 += other.B2;
+			C += other.C;
+		}
+
+		double Evaluate(const glm::dvec3 &p) const {
+			const double ax = A00 * p.x + A01 * p.y + A02 * p.z;
+			const double ay = A01 * p.x + A11 * p.y + A12 * p.z;
+			const double az = A02 * p.x + A12 * p.y + A22 * p.z;
+			return std::max(p.x * ax + p.y * ay + p.z * az + 2.0 * (B0 * p.x + B1 * p.y + B2 * p.z) + C, 0.0);
+		}
+	};
+
+	struct Collapse_t {
+		double Cost;
+		uint32_t From;
+		uint32_t To;
+		uint32_t FromVersion;
+		uint32_t ToVersion;
+
+		bool operator>(const Collapse_t &other) const { return Cost > other.Cost; }
+	};
+
+	std::vector<SimplifiedMesh_t> SimplifyMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &targetIndexCounts) {
+		std::vector<SimplifiedMesh_t> results;
+		results.reserve(targetIndexCounts.size());
+		const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+		// Weld the vertices sharing a position : the collapses work on positions, seams included.
+		std::unordered_map<glm::vec3, uint32_t> welded_ids;
+		std::vector<uint32_t> welded_of(vertices.size());
+		std::vector<glm::dvec3> positions;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			auto inserted = welded_ids.try_emplace(vertices[i].Position, static_cast<uint32_t>(positions.size()));
+			if (inserted.second) {
+				positions.push_back(glm::dvec3{ vertices[i].Position });
+			}
+			welded_of[i] = inserted.first->second;
+		}
+		const uint32_t welded_count = static_cast<uint32_t>(positions.size());
+
+		// Vertices of each welded position : wedges[wedge_offsets[w], wedge_offsets[w + 1]).
+		std::vector<uint32_t> wedge_offsets(welded_count + 1, 0);
+		for (uint32_t w : welded_of) {
+			wedge_offsets[w + 1]++;
+		}
+		for (uint32_t w = 0; w < welded_count; w++) {
+			wedge_offsets[w + 1] += wedge_offsets[w];
+		}
+		std::vector<uint32_t> wedges(vertices.size());
+		{
+			std::vector<uint32_t> cursors(wedge_offsets.begin(), wedge_offsets.end() - 1);
+			for (uint32_t i = 0; i < vertices.size(); i++) {
+				wedges[cursors[welded_of[i]]++] = i;
+			}
+		}
+
+		std::vector<uint32_t> triangles(indices.size());
+		std::vector<uint8_t> is_live(triangle_count, 0);
+		std::vector<std::vector<uint32_t>> adjacency(welded_count);
+		std::vector<Quadric_t> quadrics(welded_count);
+		std::unordered_map<uint64_t, uint32_t> edge_uses;
+		uint32_t live_count = 0;
+		for (uint32_t t = 0; t < triangle_count; t++) {
+			uint32_t *triangle = &triangles[3 * t];
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				triangle[corner] = welded_of[indices[3 * t + corner]];
+			}
+			if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+				continue;
+			}
+			is_live[t] = 1;
+			live_count++;
+
+			const glm::dvec3 cross = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+			const double double_area = glm::length(cross);
+			const glm::dvec3 normal = double_area > 0.0 ? cross / double_area : glm::dvec3{ 0.0 };
+			const Quadric_t plane = Quadric_t::FromPlane(normal, -glm::dot(normal, positions[triangle[0]]), 1.0);
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				quadrics[triangle[corner]].Add(plane);
+				adjacency[triangle[corner]].push_back(t);
+
+				const uint32_t a = triangle[corner];
+				const uint32_t b = triangle[(corner + 1) % 3];
+				edge_uses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+			}
+		}
+
+		// Open borders : a plane through the edge, perpendicular to its triangle, keeps the edge from moving inwards.
+		for (uint32_t t = 0; t < triangle_count; t++) {
+			if (!is_live[t]) {
+				continue;
+			}
+			const uint32_t *triangle = &triangles[3 * t];
+			const glm::dvec3 face = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				const uint32_t a = triangle[corner];
+				const uint32_t b = triangle[(corner + 1) % 3];
+				if (edge_uses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)] != 1) {
+					continue;
+				}
+				const glm::dvec3 edge = positions[b] - positions[a];
+				const glm::dvec3 perpendicular = glm::cross(edge, face);
+				const double length = glm::length(perpendicular);
+				if (length <= 0.0) {
+					continue;
+				}
+				const glm::dvec3 normal = perpendicular / length;
+				const Quadric_t border = Quadric_t::FromPlane(normal, -glm::dot(normal, positions[a]), BORDER_WEIGHT);
+				quadrics[a].Add(border);
+				quadrics[b].Add(border);
+			}
+		}
+
+		std::vector<uint32_t> versions(welded_count, 0);
+		std::vector<uint32_t> collapsed_to(welded_count);
+		for (uint32_t w = 0; w < welded_count; w++) {
+			collapsed_to[w] = w;
+		}
+
+		const auto error_of = [&quadrics](uint32_t from, uint32_t to, const glm::dvec3 &position) {
+			Quadric_t q = quadrics[from];
+			q.Add(quadrics[to]);
+			return q.Evaluate(position);
+		};
+
+		std::priority_queue<Collapse_t, std::vector<Collapse_t>, std::greater<Collapse_t>> queue;
+		const auto push_edges_of = [&](uint32_t w) {
+			for (uint32_t t : adjacency[w]) {
+				if (!is_live[t]) {
+					continue;
+				}
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					const uint32_t other = triangles[3 * t + corner];
+					if (other == w) {
+						continue;
+					}
+					queue.push({ error_of(other, w, positions[w]), other, w, versions[other], versions[w] });
+					queue.push({ error_of(w, other, positions[other]), w, other, versions[w], versions[other] });
+				}
+			}
+		};
+		for (uint32_t w = 0; w < welded_count; w++) {
+			push_edges_of(w);
+		}
+
+		// Moving 'from' to 'to' must not flip a triangle, and 'from' and 'to' must not share more neighbours than triangles (link condition).
+		std::vector<uint32_t> neighbours_from;
+		std::vector<uint32_t> neighbours_to;
+		const auto is_valid = [&](uint32_t from, uint32_t to) {
+			neighbours_from.clear();
+			neighbours_to.clear();
+			uint32_t shared_triangles = 0;
+			for (uint32_t t : adjacency[from]) {
+				if (!is_live[t]) {
+					continue;
+				}
+				const uint32_t *triangle = &triangles[3 * t];
+				const bool has_to = triangle[0] == to || triangle[1] == to || triangle[2] == to;
+				shared_triangles += has_to ? 1 : 0;
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					if (triangle[corner] != from) {
+						neighbours_from.push_back(triangle[corner]);
+					}
+				}
+				if (has_to) {
+					continue;
+				}
+
+				const uint32_t c = (triangle[0] == from) ? 0 : (triangle[1] == from ? 1 : 2);
+				const glm::dvec3 &p1 = positions[triangle[(c + 1) % 3]];
+				const glm::dvec3 &p2 = positions[triangle[(c + 2) % 3]];
+				const glm::dvec3 before = glm::cross(p1 - positions[from], p2 - positions[from]);
+				const glm::dvec3 after = glm::cross(p1 - positions[to], p2 - positions[to]);
+				if (glm::dot(before, after) <= 0.0) {
+					return false;
+				}
+			}
+			for (uint32_t t : adjacency[to]) {
+				if (!is_live[t]) {
+					continue;
+				}
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					if (triangles[3 * t + corner] != to) {
+						neighbours_to.push_back(triangles[3 * t + corner]);
+					}
+				}
+			}
+			std::sort(neighbours_from.begin(), neighbours_from.end());
+			neighbours_from.erase(std::unique(neighbours_from.begin(), neighbours_from.end()), neighbours_from.end());
+			std::sort(neighbours_to.begin(), neighbours_to.end());
+			neighbours_to.erase(std::unique(neighbours_to.begin(), neighbours_to.end()), neighbours_to.end());
+
+			uint32_t shared_neighbours = 0;
+			for (uint32_t n : neighbours_from) {
+				shared_neighbours += std::binary_search(neighbours_to.begin(), neighbours_to.end(), n) ? 1 : 0;
+			}
+			return shared_neighbours <= shared_triangles;
+		};
+
+		const auto find = [&collapsed_to](uint32_t w) {
+			uint32_t root = w;
+			while (collapsed_to[root] != root) {
+				root = collapsed_to[root];
+			}
+			while (collapsed_to[w] != root) {
+				const uint32_t next = collapsed_to[w];
+				collapsed_to[w] = root;
+				w = next;
+			}
+			return root;
+		};
+
+		// The vertex of the welded position a collapsed vertex ends up on : the one with the closest attributes.
+		std::vector<uint32_t> vertex_remap(vertices.size());
+		const auto snapshot = [&](double maxError) {
+			for (uint32_t v = 0; v < vertices.size(); v++) {
+				const uint32_t w = find(welded_of[v]);
+				if (w == welded_of[v]) {
+					vertex_remap[v] = v;
+					continue;
+				}
+				float best_score = -1e30f;
+				for (uint32_t i = wedge_offsets[w]; i < wedge_offsets[w + 1]; i++) {
+					const Vertex &candidate = vertices[wedges[i]];
+					const glm::vec2 uv_offset = candidate.uv - vertices[v].uv;
+					const float score = glm::dot(candidate.Normal, vertices[v].Normal) - glm::dot(uv_offset, uv_offset) -
+										glm::length(candidate.Color - vertices[v].Color);
+					if (score > best_score) {
+						best_score = score;
+						vertex_remap[v] = wedges[i];
+					}
+				}
+			}
+
+			SimplifiedMesh_t mesh{};
+			mesh.Indices.reserve(live_count * 3);
+			for (uint32_t t = 0; t < triangle_count; t++) {
+				if (is_live[t]) {
+					mesh.Indices.push_back(vertex_remap[indices[3 * t + 0]]);
+					mesh.Indices.push_back(vertex_remap[indices[3 * t + 1]]);
+					mesh.Indices.push_back(vertex_remap[indices[3 * t + 2]]);
+				}
+			}
+			mesh.Error = static_cast<float>(glm::sqrt(maxError));
+			results.push_back(std::move(mesh));
+		};
+
+		double max_error = 0.0;
+		size_t target = 0;
+		while (target < targetIndexCounts.size()) {
+			if (live_count * 3 <= targetIndexCounts[target] || queue.empty()) {
+				snapshot(max_error);
+				target++;
+				continue;
+			}
+
+			const Collapse_t collapse = queue.top();
+			queue.pop();
+			const uint32_t from = collapse.From;
+			const uint32_t to = collapse.To;
+			if (collapsed_to[from] != from || collapsed_to[to] != to || versions[from] != collapse.FromVersion || versions[to] != collapse.ToVersion) {
+				continue; // Stale : one of the vertices moved or was collapsed since.
+			}
+			if (!is_valid(from, to)) {
+				continue;
+			}
+
+			for (uint32_t t : adjacency[from]) {
+				if (!is_live[t]) {
+					continue;
+				}
+				uint32_t *triangle = &triangles[3 * t];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+					is_live[t] = 0;
+					live_count--;
+					continue;
+				}
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					if (triangle[corner] == from) {
+						triangle[corner] = to;
+					}
+				}
+				adjacency[to].push_back(t);
+			}
+			adjacency[from].clear();
+			adjacency[from].shrink_to_fit();
+
+			// Keep the list short : triangles collapsed around 'to' are gone for good.
+			std::vector<uint32_t> &around = adjacency[to];
+			around.erase(std::remove_if(around.begin(), around.end(), [&is_live](uint32_t t) { return !is_live[t]; }), around.end());
+
+			max_error = std::max(max_error, collapse.Cost);
+			quadrics[to].Add(quadrics[from]);
+			collapsed_to[from] = to;
+			versions[to]++;
+			push_edges_of(to);
+		}
+
+		return results;
+	}
+
+	void GenerateLods(ModelData_t &data, const ModelImportOptions_t &options) {
+		const uint32_t full_index_count = static_cast<uint32_t>(data.Indices.size());
+		data.Lods.assign(1, MeshLod_t{ 0, full_index_count, 0.0f });
+
+		std::vector<uint32_t> targets;
+		const uint32_t triangle_count = full_index_count / 3;
+		for (uint32_t i = 0; i < MAX_LOD_COUNT - 1 && options.LodRatios[i] > 0.0f; i++) {
+			targets.push_back(static_cast<uint32_t>(triangle_count * std::min(options.LodRatios[i], 1.0f)) * 3);
+		}
+		if (targets.empty() || triangle_count == 0) {
+			return;
+		}
+
+		std::vector<SimplifiedMesh_t> simplified = SimplifyMesh(data.Vertices, data.Indices, targets);
+
+		// Errors relative to the bounding sphere : the renderer scales them by each entity's world radius.
+		const float radius = Bounds_t::FromVertices(data.Vertices).Radius;
+		uint32_t previous_count = full_index_count;
+		for (SimplifiedMesh_t &mesh : simplified) {
+			const uint32_t index_count = static_cast<uint32_t>(mesh.Indices.size());
+			if (index_count == 0 || index_count > previous_count * LOD_MIN_REDUCTION) {
+				break;
+			}
+			if (options.OptimizeVertexCache) {
+				OptimizeVertexCache(mesh.Indices, static_cast<uint32_t>(data.Vertices.size()));
+			}
+
+			data.Lods.push_back({ static_cast<uint32_t>(data.Indices.size()), index_count, radius > 0.0f ? mesh.Error / radius : 0.0f });
+			data.Indices.insert(data.Indices.end(), mesh.Indices.begin(), mesh.Indices.end());
+			previous_count = index_count;
+		}
+	}
+
+}
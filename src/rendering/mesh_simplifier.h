@@ -0,0 +1,35 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+
+namespace gigno {
+
+	struct Vertex;
+	struct ModelData_t;
+	struct ModelImportOptions_t;
+
+	struct SimplifiedMesh_t {
+		std::vector<uint32_t> Indices; // Into the same vertices as the source mesh.
+		float Error = 0.0f;            // Model space distance, conservative : the largest quadric error of the collapses, square rooted.
+	};
+
+	/*
+	@brief Simplifies a triangle list by quadric error edge collapses (Garland & Heckbert 1997), always collapsing a vertex onto one of
+	its neighbours : the simplified meshes index the source vertices, so that every level of detail can share a single vertex buffer.
+	Vertices sharing a position (normal or uv seams) are collapsed together. Open borders are kept in place by perpendicular quadrics.
+	@param targetIndexCounts in decreasing order. The collapses stop at the last one.
+	@returns one mesh per target, in the same order. A mesh may have more indices than its target if no more collapse was possible.
+	*/
+	std::vector<SimplifiedMesh_t> SimplifyMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &targetIndexCounts);
+
+	/*
+	@brief Appends the levels of detail asked by the options to the mesh's indices, each one simplified from the full mesh, and fills
+	data.Lods. Stops at the first level that does not remove enough triangles to be worth drawing instead of the previous one.
+	*/
+	void GenerateLods(ModelData_t &data, const ModelImportOptions_t &options);
+
+}
+
+#endif
@@ -3,158 +3,269 @@
 #include "../error_macros.h"
 #include "rendering_utils.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "../vendor/tiny_object_loader/tiny_obj_loader.h"
+#include "obj_importer.h"
 
 #include "../application.h"
 
+#include "glm/gtc/packing.hpp"
+
+#include <atomic>
+#include <cstring>
+
 namespace gigno
 {
 
-	VkVertexInputBindingDescription Vertex::GetBindingDescription() {
-		VkVertexInputBindingDescription description{};
-		description.binding = 0;
-		description.stride = sizeof(Vertex);
-		description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	// Attributes of the compact formats, in VERTEX_ATTRIBUTE_BINDING.
+	struct CompactAttributes_t {
+		uint32_t Normal; // Octahedral, snorm16x2.
+		uint32_t Color;  // unorm8x4.
+		uint32_t UV;     // half2.
+	};
+	static_assert(sizeof(CompactAttributes_t) == 12, "CompactAttributes_t must be tightly packed.");
+
+	VertexLayout_t VertexLayout_t::FromFormat(VertexFormat_t format, bool positionOnly) {
+		VertexLayout_t layout{};
+		const auto add_binding = [&layout](uint32_t binding, uint32_t stride) {
+			layout.Bindings[layout.BindingCount++] = { binding, stride, VK_VERTEX_INPUT_RATE_VERTEX };
+		};
+		const auto add_attribute = [&layout](uint32_t location, uint32_t binding, VkFormat attributeFormat, uint32_t offset) {
+			layout.Attributes[layout.AttributeCount++] = { location, binding, attributeFormat, offset };
+		};
+
+		switch (format) {
+		case VERTEX_FORMAT_FLOAT:
+			add_binding(VERTEX_POSITION_BINDING, sizeof(Vertex));
+			add_attribute(0, VERTEX_POSITION_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Position));
+			if (!positionOnly) {
+				add_binding(VERTEX_ATTRIBUTE_BINDING, sizeof(Vertex));
+				add_attribute(1, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Color));
+				add_attribute(2, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Normal));
+				add_attribute(3, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv));
+			}
+			break;
+		case VERTEX_FORMAT_COMPACT:
+		case VERTEX_FORMAT_COMPACT_POSITIONS:
+			if (format == VERTEX_FORMAT_COMPACT) {
+				add_binding(VERTEX_POSITION_BINDING, sizeof(glm::vec3));
+				add_attribute(0, VERTEX_POSITION_BINDING, VK_FORMAT_R32G32B32_SFLOAT, 0);
+			} else {
+				// The fourth component pads the stride to 8 bytes.
+				add_binding(VERTEX_POSITION_BINDING, sizeof(uint16_t) * 4);
+				add_attribute(0, VERTEX_POSITION_BINDING, VK_FORMAT_R16G16B16A16_UNORM, 0);
+			}
+			if (!positionOnly) {
+				add_binding(VERTEX_ATTRIBUTE_BINDING, sizeof(CompactAttributes_t));
+				add_attribute(1, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactAttributes_t, Color));
+				add_attribute(2, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SNORM, offsetof(CompactAttributes_t, Normal));
+				add_attribute(3, VERTEX_ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactAttributes_t, UV));
+			}
+			break;
+		default:
+			ERR_MSG_V(layout, "Unknown vertex format %d !", (int)format);
+		}
 
-		return description;
+		return layout;
 	}
 
-	std::array<VkVertexInputAttributeDescription, 4> Vertex::GetAttributeDescriptions()
-	{
-		std::array<VkVertexInputAttributeDescription, 4> descriptions{};
-
-		descriptions[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Position)};
-		descriptions[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Color)};
-		descriptions[2] = {2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Normal)};
-		descriptions[3] = {3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)};
-
-		return descriptions;
+	// Octahedral mapping of a direction to [-1, 1]^2 (Cigolle et al. 2014). Decoded by DecodeNormal() in simple_shader.vert.
+	static glm::vec2 EncodeOctahedral(glm::vec3 direction) {
+		const float norm = glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z);
+		if (norm == 0.0f) {
+			return glm::vec2{ 0.0f };
+		}
+		direction /= norm;
+		glm::vec2 encoded{ direction.x, direction.y };
+		if (direction.z < 0.0f) {
+			const glm::vec2 sign_not_zero{ direction.x >= 0.0f ? 1.0f : -1.0f, direction.y >= 0.0f ? 1.0f : -1.0f };
+			encoded = (1.0f - glm::abs(glm::vec2{ direction.y, direction.x })) * sign_not_zero;
+		}
+		return encoded;
 	}
 
-	ModelData_t ModelData_t::FromObjFile(const char *path) {
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		
-		std::string warn;
-		std::string err;
+	Bounds_t Bounds_t::FromVertices(const std::vector<Vertex> &vertices) {
+		Bounds_t bounds{};
+		if (vertices.empty()) {
+			return bounds;
+		}
 
-		if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
-			ERR_MSG_V(ModelData_t{}, "Tiny Object Loader Error ");
+		glm::vec3 min = vertices[0].Position;
+		glm::vec3 max = vertices[0].Position;
+		for (const Vertex &vertex : vertices) {
+			min = glm::min(min, vertex.Position);
+			max = glm::max(max, vertex.Position);
+		}
+		bounds.Center = (min + max) * 0.5f;
+		bounds.Extents = (max - min) * 0.5f;
+
+		// Tighter than the box's half diagonal for round shapes.
+		float radius_squared = 0.0f;
+		for (const Vertex &vertex : vertices) {
+			const glm::vec3 offset = vertex.Position - bounds.Center;
+			radius_squared = glm::max(radius_squared, glm::dot(offset, offset));
 		}
+		bounds.Radius = glm::sqrt(radius_squared);
 
+		return bounds;
+	}
+
+	ModelData_t ModelData_t::FromObjFile(const char *path, const ModelImportOptions_t &options) {
 		ModelData_t data{};
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-		for(const tinyobj::shape_t &shape : shapes) {
-			data.Indices.reserve(shape.mesh.indices.size());
-			for(const tinyobj::index_t& index : shape.mesh.indices) {
-				Vertex vertex{};
-
-				vertex.Position = { attrib.vertices[3 * index.vertex_index + 0],
-									attrib.vertices[3 * index.vertex_index + 1],
-									attrib.vertices[3 * index.vertex_index + 2]};
-				
-				uint32_t colorIndex = 3 * index.vertex_index + 2;
-				if(colorIndex < attrib.colors.size()) {
-					vertex.Color = {attrib.colors[colorIndex - 0],
-									attrib.colors[colorIndex - 1],
-									attrib.colors[colorIndex - 2]};
-				}
-
-				vertex.Normal = {attrib.normals[3 * index.normal_index + 0],
-								attrib.normals[3 * index.normal_index + 1],
-								attrib.normals[3 * index.normal_index + 2]};
-				vertex.uv = {attrib.texcoords[2 * index.texcoord_index + 0],
-							 attrib.texcoords[2 * index.texcoord_index + 1]};
-
-				if(uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(data.Vertices.size());
-					data.Vertices.push_back(vertex);
-				}
-
-				data.Indices.push_back(uniqueVertices[vertex]);
-			}
+		data.VertexFormat = options.VertexFormat;
+		ObjImportStats_t stats{};
+		if (!ImportObj(path, options.DeduplicateVertices, Application::Singleton()->GetThreadPool(), data.Vertices, data.Indices, &stats)) {
+			ERR_MSG_V(ModelData_t{}, "Could not read '%s' !", path);
 		}
+		if (stats.InvalidTriangles > 0) {
+			Application::Singleton()->Debug()->GetConsole()->LogWarning("'%s' : %u triangles with out of range indices were dropped.", path, stats.InvalidTriangles);
+		}
+
+		data.Optimization = OptimizeMesh(data, options);
+		GenerateLods(data, options);
 
 		return data;
 	}
 
-	giModel::giModel(const Device &device, const ModelData_t &data, VkCommandPool commandPool) :
-		m_Vertices{ data.Vertices }, 
-		m_Indices{ data.Indices } {
-		CreateVertexBuffer(device.GetDevice(), device.GetPhysicalDevice(), commandPool, device.GetGraphicsQueue());
-		CreateIndexBuffer(device.GetDevice(), device.GetPhysicalDevice(), commandPool, device.GetGraphicsQueue());
-	}
+	// Converts the vertices to the description's format : positions, then the other attributes from AttributesOffset.
+	static std::vector<uint8_t> EncodeVertices(const std::vector<Vertex> &vertices, MeshDescription_t &description) {
+		const bool quantize_positions = description.VertexFormat == VERTEX_FORMAT_COMPACT_POSITIONS;
+		const size_t position_stride = quantize_positions ? sizeof(uint16_t) * 4 : sizeof(glm::vec3);
 
-	giModel::~giModel() {
+		// Positions are stored relative to the bounding box : unorm16 keeps 1/65535th of the mesh size as precision.
+		if (quantize_positions) {
+			const glm::vec3 size = description.Bounds.Extents * 2.0f;
+			description.PositionOffset = glm::vec4{ description.Bounds.Center - description.Bounds.Extents, 0.0f };
+			description.PositionScale = glm::vec4{ size, 1.0f };
+		}
+		const glm::vec3 inverse_size{
+			description.PositionScale.x > 0.0f ? 1.0f / description.PositionScale.x : 0.0f,
+			description.PositionScale.y > 0.0f ? 1.0f / description.PositionScale.y : 0.0f,
+			description.PositionScale.z > 0.0f ? 1.0f / description.PositionScale.z : 0.0f
+		};
+
+		// Streams start on a 16 bytes boundary.
+		description.AttributesOffset = (position_stride * vertices.size() + 15) & ~static_cast<VkDeviceSize>(15);
+		std::vector<uint8_t> encoded(static_cast<size_t>(description.AttributesOffset) + sizeof(CompactAttributes_t) * vertices.size());
+
+		uint8_t *positions = encoded.data();
+		CompactAttributes_t *attributes = reinterpret_cast<CompactAttributes_t *>(encoded.data() + description.AttributesOffset);
+		for (size_t i = 0; i < vertices.size(); i++) {
+			const Vertex &vertex = vertices[i];
+
+			if (quantize_positions) {
+				const glm::vec3 normalized = (vertex.Position - glm::vec3{ description.PositionOffset }) * inverse_size;
+				const uint64_t packed = glm::packUnorm4x16(glm::vec4{ normalized, 0.0f });
+				std::memcpy(positions + i * position_stride, &packed, sizeof(packed));
+			} else {
+				std::memcpy(positions + i * position_stride, &vertex.Position, sizeof(glm::vec3));
+			}
+
+			attributes[i].Normal = glm::packSnorm2x16(EncodeOctahedral(vertex.Normal));
+			attributes[i].Color = glm::packUnorm4x8(glm::vec4{ vertex.Color, 1.0f });
+			attributes[i].UV = glm::packHalf2x16(vertex.uv);
+		}
 
+		return encoded;
 	}
 
-	void giModel::CleanUp(VkDevice device) {
-		vkDestroyBuffer(device, m_VertexBuffer, nullptr);
-		vkFreeMemory(device, m_VertexBufferMemory, nullptr);
+	EncodedMesh_t EncodedMesh_t::FromModelData(const ModelData_t &data) {
+		EncodedMesh_t mesh{};
+		MeshDescription_t &description = mesh.Description;
+		description.VertexFormat = data.VertexFormat;
+		description.IndexType = data.GetIndexType();
+		description.VertexCount = static_cast<uint32_t>(data.Vertices.size());
+		description.Bounds = Bounds_t::FromVertices(data.Vertices);
+		if (data.Lods.empty()) {
+			description.Lods[0] = { 0, static_cast<uint32_t>(data.Indices.size()), 0.0f };
+		} else {
+			description.LodCount = static_cast<uint32_t>(std::min<size_t>(data.Lods.size(), MAX_LOD_COUNT));
+			std::copy(data.Lods.begin(), data.Lods.begin() + description.LodCount, description.Lods);
+		}
 
-		vkDestroyBuffer(device, m_IndexBuffer, nullptr);
-		vkFreeMemory(device, m_IndexBufferMemory, nullptr);
-	}
+		if (description.VertexFormat == VERTEX_FORMAT_FLOAT) {
+			const uint8_t *vertex_bytes = reinterpret_cast<const uint8_t *>(data.Vertices.data());
+			mesh.VertexData.assign(vertex_bytes, vertex_bytes + sizeof(Vertex) * data.Vertices.size());
+		} else {
+			mesh.VertexData = EncodeVertices(data.Vertices, description);
+		}
 
-	void giModel::Bind(VkCommandBuffer buffer) {
-		VkBuffer buffers[] = { m_VertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(buffer, 0, 1, buffers, offsets);
+		// Narrowed here : the GPU only ever sees the 16 bits indices.
+		if (description.IndexType == VK_INDEX_TYPE_UINT16) {
+			mesh.IndexData.resize(sizeof(uint16_t) * data.Indices.size());
+			uint16_t *narrow_indices = reinterpret_cast<uint16_t *>(mesh.IndexData.data());
+			for (size_t i = 0; i < data.Indices.size(); i++) {
+				narrow_indices[i] = static_cast<uint16_t>(data.Indices[i]);
+			}
+		} else {
+			const uint8_t *index_bytes = reinterpret_cast<const uint8_t *>(data.Indices.data());
+			mesh.IndexData.assign(index_bytes, index_bytes + sizeof(indice_t) * data.Indices.size());
+		}
 
-		vkCmdBindIndexBuffer(buffer, m_IndexBuffer, 0, GetIndexType());
+		return mesh;
 	}
 
-	void giModel::Draw(VkCommandBuffer buffer) {
-		vkCmdDrawIndexed(buffer, static_cast<uint32_t>(m_Indices.size()), 1, 0, 0, 0);
+	giModel::giModel(const Device &device, const ModelData_t &data, UploadManager &uploadManager) :
+		giModel(device, EncodedMesh_t::FromModelData(data).GetStreams(), uploadManager) {
 	}
 
-	void giModel::CreateVertexBuffer(VkDevice device, VkPhysicalDevice physDevice, VkCommandPool commandPool, VkQueue queue) {
-		VkDeviceSize buffer_size = sizeof(m_Vertices[0]) * m_Vertices.size();
-
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
-
-		CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					 staging_buffer, staging_buffer_memory);
+	giModel::giModel(const Device &device, const MeshStreams_t &streams, UploadManager &uploadManager) :
+		m_Description{ streams.Description },
+		m_pAllocator{ device.GetAllocator() },
+		m_pUploadManager{ &uploadManager } {
+		static std::atomic<uint32_t> s_NextId{ 1 };
+		m_Id = s_NextId.fetch_add(1);
 
-		void *data;
-		vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, m_Vertices.data(), (size_t)buffer_size);
-		vkUnmapMemory(device, staging_buffer_memory);
+		CreateDeviceBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, streams.pVertexData, streams.VertexDataSize, m_VertexBuffer, m_VertexBufferAllocation);
+		CreateDeviceBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, streams.pIndexData, streams.IndexDataSize, m_IndexBuffer, m_IndexBufferAllocation);
+	}
 
-		CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VertexBuffer, m_VertexBufferMemory);
+	giModel::~giModel() {
+		CleanUp();
+	}
 
-		CopyBuffer(device, staging_buffer, m_VertexBuffer, buffer_size, commandPool, queue);
+	void giModel::CleanUp() {
+		if (!m_pAllocator) {
+			return;
+		}
+		if (!m_IsResident) {
+			m_pUploadManager->Wait(m_UploadTicket); // Do not free memory the transfer queue still writes to.
+		}
+		DestroyBuffer(m_pAllocator, m_VertexBuffer, m_VertexBufferAllocation);
+		DestroyBuffer(m_pAllocator, m_IndexBuffer, m_IndexBufferAllocation);
+	}
 
-		vkDestroyBuffer(device, staging_buffer, nullptr);
-		vkFreeMemory(device, staging_buffer_memory, nullptr);
+	bool giModel::IsResident() {
+		if (!m_IsResident) {
+			m_IsResident = m_pUploadManager->IsComplete(m_UploadTicket);
+		}
+		return m_IsResident;
 	}
 
-	void giModel::CreateIndexBuffer(VkDevice device, VkPhysicalDevice physDevice, VkCommandPool commandPool, VkQueue queue) {
-		VkDeviceSize buffer_size = sizeof(indice_t) * m_Indices.size();
+	void giModel::Bind(VkCommandBuffer buffer) {
+		VkBuffer buffers[] = { m_VertexBuffer, m_VertexBuffer };
+		VkDeviceSize offsets[] = { 0, m_Description.AttributesOffset };
+		vkCmdBindVertexBuffers(buffer, VERTEX_POSITION_BINDING, 2, buffers, offsets);
 
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+		vkCmdBindIndexBuffer(buffer, m_IndexBuffer, 0, GetIndexType());
+	}
 
-		CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					 staging_buffer, staging_buffer_memory);
+	void giModel::BindPositions(VkCommandBuffer buffer) {
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(buffer, VERTEX_POSITION_BINDING, 1, &m_VertexBuffer, &offset);
 
-		void *data{};
-		vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, m_Indices.data(), (size_t)buffer_size);
-		vkUnmapMemory(device, staging_buffer_memory);
+		vkCmdBindIndexBuffer(buffer, m_IndexBuffer, 0, GetIndexType());
+	}
 
-		CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_IndexBuffer, m_IndexBufferMemory);
+	void giModel::Draw(VkCommandBuffer buffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) {
+		const MeshLod_t &mesh_lod = m_Description.Lods[lod];
+		vkCmdDrawIndexed(buffer, mesh_lod.IndexCount, instanceCount, mesh_lod.FirstIndex, 0, firstInstance);
+	}
 
-		CopyBuffer(device, staging_buffer, m_IndexBuffer, buffer_size, commandPool, queue);
+	void giModel::CreateDeviceBuffer(VkBufferUsageFlags usage, const void *data, VkDeviceSize size, VkBuffer &buffer, GpuAllocation_t &allocation) {
+		CreateBuffer(m_pAllocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+					 buffer, allocation, ALLOCATION_STRATEGY_TLSF, m_pUploadManager->GetQueueFamilies());
 
-		vkDestroyBuffer(device, staging_buffer, nullptr);
-		vkFreeMemory(device, staging_buffer_memory, nullptr);
+		// Batches complete in order : the ticket of the last buffer covers the first one too.
+		m_UploadTicket = m_pUploadManager->UploadToBuffer(buffer, 0, data, size);
 	}
 
 }
\ No newline at end of file
@@ -8,9 +8,15 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
+
+#include "memory_allocator.h"
+#include "upload_manager.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
 
 namespace gigno {
-	typedef uint32_t indice_t;
+	typedef uint32_t indice_t; // While importing and processing. Meshes with few enough vertices are drawn with 16 bits indices.
 	class Device;
 
 	struct Vertex {
@@ -22,9 +28,6 @@ namespace gigno {
 		glm::vec3 Normal{glm::sqrt(3.0f)};
 		glm::vec2 uv{};
 
-		static VkVertexInputBindingDescription GetBindingDescription();
-		static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions();
-
 		// Need Equal operator for unordered map
 		bool operator==(const Vertex &other) const {
 			return other.Position == Position && other.Color == Color && other.Normal == Normal && other.uv == uv;
@@ -38,8 +41,12 @@ namespace std {
 	template<>
 	struct hash<gigno::Vertex> {
 		size_t operator()(const gigno::Vertex &key) const {
-			return hash<glm::vec3>()(key.Position) ^ hash<glm::vec3>()(key.Color) ^ 
-			hash<glm::vec3>()(key.Normal) ^ hash<glm::vec2>()(key.uv);
+			// Combined in order : a plain xor cancels out equal fields and collides for every permutation of them.
+			size_t seed = hash<glm::vec3>()(key.Position);
+			glm::detail::hash_combine(seed, hash<glm::vec3>()(key.Color));
+			glm::detail::hash_combine(seed, hash<glm::vec3>()(key.Normal));
+			glm::detail::hash_combine(seed, hash<glm::vec2>()(key.uv));
+			return seed;
 		}
 	};
 
@@ -47,38 +54,194 @@ namespace std {
 
 namespace gigno{
 
+	/*
+	How the vertices of a model are stored on the GPU. Vertex is what they are imported as.
+	Positions are bound to VERTEX_POSITION_BINDING and the other attributes to VERTEX_ATTRIBUTE_BINDING, so that a depth-only
+	pass only fetches positions.
+	*/
+	enum VertexFormat_t {
+		VERTEX_FORMAT_FLOAT,             // 44 bytes. Vertex as is : both bindings read the same interleaved buffer.
+		VERTEX_FORMAT_COMPACT,           // 24 bytes. float32 positions. Octahedral snorm16x2 normal, unorm8x4 color and half2 uv.
+		VERTEX_FORMAT_COMPACT_POSITIONS, // 20 bytes. As VERTEX_FORMAT_COMPACT, with unorm16 positions relative to the mesh bounds.
+		VERTEX_FORMAT_MAX_ENUM
+	};
+
+	const uint32_t VERTEX_POSITION_BINDING = 0;
+	const uint32_t VERTEX_ATTRIBUTE_BINDING = 1;
+
+	/*
+	Vertex input state of a VertexFormat_t. Locations match simple_shader.vert : position, color, normal, uv.
+	*/
+	struct VertexLayout_t {
+		uint32_t BindingCount = 0;
+		VkVertexInputBindingDescription Bindings[3]{}; // Room for a per-instance binding (see AddDebugShapeInstanceLayout()).
+		uint32_t AttributeCount = 0;
+		VkVertexInputAttributeDescription Attributes[9]{};
+
+		// @param positionOnly only the position binding, for depth-only passes.
+		static VertexLayout_t FromFormat(VertexFormat_t format, bool positionOnly = false);
+	};
+
+	// Levels of detail of a mesh, the full mesh included.
+	const uint32_t MAX_LOD_COUNT = 4;
+
+	/*
+	Range of a level of detail in the mesh's index buffer. Every level indexes the same vertices.
+	*/
+	struct MeshLod_t {
+		uint32_t FirstIndex = 0;
+		uint32_t IndexCount = 0;
+		float Error = 0.0f; // Simplification error, relative to the radius of the mesh's bounding sphere. 0 for the full mesh.
+	};
+
+	/*
+	Options changing the data produced by an import. Part of the mesh cache key : the same file imported with different options
+	is a different mesh.
+	*/
+	struct ModelImportOptions_t {
+		bool DeduplicateVertices = true; // Merge identical vertices and index them. Otherwise every face corner is its own vertex.
+		VertexFormat_t VertexFormat = VERTEX_FORMAT_FLOAT; // Quantized formats about halve the vertex memory and bandwidth.
+		// Run after deduplication, in this order (see mesh_optimizer.h).
+		bool OptimizeVertexCache = true; // Reorder triangles for the post-transform vertex cache.
+		bool OptimizeOverdraw = true;    // Reorder clusters of triangles so that outer surfaces are drawn first.
+		bool OptimizeVertexFetch = true; // Reorder vertices in the order triangles use them.
+		// Fraction of the full mesh's triangles each simplified level of detail targets, decreasing. The first 0 ends the chain.
+		float LodRatios[MAX_LOD_COUNT - 1] = { 0.5f, 0.25f, 0.125f };
+
+		bool operator==(const ModelImportOptions_t &other) const {
+			return other.DeduplicateVertices == DeduplicateVertices && other.VertexFormat == VertexFormat &&
+				   other.OptimizeVertexCache == OptimizeVertexCache && other.OptimizeOverdraw == OptimizeOverdraw && other.OptimizeVertexFetch == OptimizeVertexFetch &&
+				   std::equal(std::begin(LodRatios), std::end(LodRatios), std::begin(other.LodRatios));
+		}
+		size_t Hash() const {
+			const size_t flags = (DeduplicateVertices ? 1 : 0) | (OptimizeVertexCache ? 2 : 0) | (OptimizeOverdraw ? 4 : 0) | (OptimizeVertexFetch ? 8 : 0);
+			size_t hash = std::hash<size_t>()(flags) ^ (std::hash<int>()(VertexFormat) << 1);
+			for (float ratio : LodRatios) {
+				hash = hash * 31 + std::hash<float>()(ratio);
+			}
+			return hash;
+		}
+	};
+
+	/*
+	Model space bounding volumes. The sphere shares the box's center : a bounds test can use whichever of the two is the tightest.
+	*/
+	struct Bounds_t {
+		glm::vec3 Center{};  // Center of the box and of the sphere.
+		glm::vec3 Extents{}; // Half size of the axis aligned box.
+		float Radius = 0.0f; // Radius of the sphere.
+
+		static Bounds_t FromVertices(const std::vector<Vertex> &vertices);
+	};
+
 	struct ModelData_t {
 		std::vector<Vertex> Vertices;
-		std::vector<indice_t> Indices;
+		std::vector<indice_t> Indices; // Every level of detail, one after the other.
+		// Full mesh first. If empty, Indices is a single level of detail.
+		std::vector<MeshLod_t> Lods;
+		VertexFormat_t VertexFormat = VERTEX_FORMAT_FLOAT; // What the vertices are converted to on upload.
+		MeshOptimizationStats_t Optimization{}; // Of the import.
+
+		// Type of the uploaded index buffer : 16 bits whenever every vertex can be indexed with them.
+		VkIndexType GetIndexType() const { return Vertices.size() <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+
+		static ModelData_t FromObjFile(const char *path, const ModelImportOptions_t &options = {});
+	};
+
+	/*
+	Everything about a mesh's GPU data but the data itself.
+	Stored as is in mesh files (see mesh_file.h) : must stay trivially copyable, and MESH_FILE_VERSION must change with it.
+	*/
+	struct MeshDescription_t {
+		VertexFormat_t VertexFormat = VERTEX_FORMAT_FLOAT;
+		VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+		uint32_t VertexCount = 0;
+		uint32_t LodCount = 1; // At least one : the full mesh.
+		MeshLod_t Lods[MAX_LOD_COUNT]{};
+		Bounds_t Bounds{};
+		VkDeviceSize AttributesOffset = 0; // In the vertex data : positions first, then the other attributes from there.
+		// Model space position of a vertex : offset + stored position * scale. Identity unless positions are quantized.
+		glm::vec4 PositionOffset{ 0.0f };
+		glm::vec4 PositionScale{ 1.0f };
+	};
 
-		static ModelData_t FromObjFile(const char *path);
+	/*
+	A mesh's data as uploaded. The data is not owned : it only has to live until the giModel built from it is constructed.
+	*/
+	struct MeshStreams_t {
+		MeshDescription_t Description{};
+		const void *pVertexData = nullptr;
+		VkDeviceSize VertexDataSize = 0;
+		const void *pIndexData = nullptr;
+		VkDeviceSize IndexDataSize = 0;
+	};
+
+	/*
+	A mesh converted to what is uploaded : vertices in their VertexFormat_t, indices narrowed to their index type.
+	*/
+	struct EncodedMesh_t {
+		MeshDescription_t Description{};
+		std::vector<uint8_t> VertexData;
+		std::vector<uint8_t> IndexData;
+
+		MeshStreams_t GetStreams() const { return { Description, VertexData.data(), VertexData.size(), IndexData.data(), IndexData.size() }; }
+
+		static EncodedMesh_t FromModelData(const ModelData_t &data);
 	};
 
 	class giModel {
 	public:
-		static VkIndexType GetIndexType() {return VK_INDEX_TYPE_UINT32;} 
-
 		giModel();
-		giModel(const Device &device, const ModelData_t &data, VkCommandPool commandPool);
+		// Buffers are filled asynchronously : the model can be drawn once IsResident().
+		giModel(const Device &device, const ModelData_t &data, UploadManager &uploadManager);
+		// Streams already encoded (see EncodedMesh_t, MeshFile) : copied to the staging memory as they are.
+		giModel(const Device &device, const MeshStreams_t &streams, UploadManager &uploadManager);
 		~giModel();
-
-		void CleanUp(VkDevice device);
+		giModel(const giModel &) = delete;
+		giModel &operator=(const giModel &) = delete;
+
+		// Gives the buffers' memory back to the allocator. Called on destruction. The GPU must be done with the model.
+		void CleanUp();
+
+		// Whether the upload of the buffers completed. Never blocks.
+		bool IsResident();
+		// Device memory used by the buffers.
+		VkDeviceSize GetGpuMemorySize() const { return m_VertexBufferAllocation.Size + m_IndexBufferAllocation.Size; }
+		const Bounds_t &GetBounds() const { return m_Description.Bounds; }
+		// Unique per model (until it wraps around). Used to sort draws by mesh.
+		uint32_t GetId() const { return m_Id; }
+		// Levels of detail, full mesh first. At least one.
+		uint32_t GetLodCount() const { return m_Description.LodCount; }
+		const MeshLod_t &GetLod(uint32_t lod) const { return m_Description.Lods[lod]; }
+		VkIndexType GetIndexType() const { return m_Description.IndexType; }
+		VertexFormat_t GetVertexFormat() const { return m_Description.VertexFormat; }
+		// Model space position of a vertex : offset + stored position * scale. Identity unless positions are quantized.
+		glm::vec4 GetPositionOffset() const { return m_Description.PositionOffset; }
+		glm::vec4 GetPositionScale() const { return m_Description.PositionScale; }
 
 		void Bind(VkCommandBuffer buffer);
-		void Draw(VkCommandBuffer buffer);
+		// Binds the position stream and the index buffer only, for depth-only passes.
+		void BindPositions(VkCommandBuffer buffer);
+		// @param firstInstance index of the first instance in the frame's instance buffer (gl_InstanceIndex of the first instance).
+		// @param lod smaller than GetLodCount(). Every level of detail uses the buffers bound by Bind().
+		void Draw(VkCommandBuffer buffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
 
 	private:
-		void CreateVertexBuffer(VkDevice device, VkPhysicalDevice physDevice, VkCommandPool commandPool, VkQueue queue);
-		void CreateIndexBuffer(VkDevice device, VkPhysicalDevice physDevice, VkCommandPool commandPool, VkQueue queue);
+		// No CPU copy is kept : the upload manager copies the data to its staging memory right away.
+		void CreateDeviceBuffer(VkBufferUsageFlags usage, const void *data, VkDeviceSize size, VkBuffer &buffer, GpuAllocation_t &allocation);
 
+		MeshDescription_t m_Description{};
+		uint32_t m_Id = 0;
 
-		std::vector<Vertex> m_Vertices;
-		std::vector<indice_t> m_Indices;
+		MemoryAllocator *m_pAllocator = nullptr;
+		UploadManager *m_pUploadManager = nullptr;
+		UploadTicket_t m_UploadTicket = 0;
+		bool m_IsResident = false;
 
-		VkBuffer m_VertexBuffer;
-		VkDeviceMemory m_VertexBufferMemory;
-		VkBuffer m_IndexBuffer;
-		VkDeviceMemory m_IndexBufferMemory;
+		VkBuffer m_VertexBuffer = VK_NULL_HANDLE;
+		GpuAllocation_t m_VertexBufferAllocation{};
+		VkBuffer m_IndexBuffer = VK_NULL_HANDLE;
+		GpuAllocation_t m_IndexBufferAllocation{};
 	};
 
 }
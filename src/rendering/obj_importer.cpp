@@ -0,0 +1,707 @@
+#include "obj_importer.h"
+#include "model.h"
+#include "mesh_file.h"
+#include "../threading/thread_pool.h"
+#include "../error_macros.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "../vendor/tiny_object_loader/tiny_obj_loader.h"
+
+#include "application.h"
+
+#include "../debug/console/command.h"
+
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+
+namespace gigno {
+
+	// Below this, a chunk of the file is not worth handing to another thread.
+	const size_t OBJ_MIN_CHUNK_SIZE = 256 * 1024;
+	// Index of a face corner attribute the face did not give.
+	const uint32_t OBJ_ABSENT_INDEX = UINT32_MAX;
+	// Index 0 in a face : never valid in OBJ, dropped with its triangle.
+	const uint32_t OBJ_INVALID_INDEX = UINT32_MAX - 1;
+
+	namespace {
+		struct ObjCorner_t {
+			// Position, uv and normal, 0 based. While a chunk is parsed, indices marked in RelativeMask are relative to the chunk's
+			// first element of that attribute (and may be negative) : they are resolved once every chunk was parsed.
+			uint32_t Index[3];
+			uint32_t RelativeMask;
+		};
+
+		// A corner and its index in the index buffer, once bucketed by range of positions for deduplication.
+		struct ObjBucketedCorner_t {
+			ObjCorner_t Corner;
+			uint32_t Index;
+		};
+
+		// The lines of the file from pBegin to pEnd, and what was read from them.
+		struct ObjChunk_t {
+			const char *pBegin = nullptr;
+			const char *pEnd = nullptr;
+
+			std::vector<float> Positions; // xyz.
+			std::vector<float> Colors;    // rgb, one per position.
+			std::vector<float> Uvs;       // uv.
+			std::vector<float> Normals;   // xyz.
+			std::vector<ObjCorner_t> Corners; // Three per triangle.
+			uint32_t InvalidTriangles = 0;
+
+			uint32_t GetCount(uint32_t attribute) const {
+				switch (attribute) {
+				case 0: return static_cast<uint32_t>(Positions.size() / 3);
+				case 1: return static_cast<uint32_t>(Uvs.size() / 2);
+				default: return static_cast<uint32_t>(Normals.size() / 3);
+				}
+			}
+		};
+
+		// Open addressing table (linear probing) from a corner's attribute indices to its vertex.
+		class ObjCornerTable {
+		public:
+			explicit ObjCornerTable(uint32_t expectedCount) {
+				uint32_t capacity = 64;
+				while (capacity < expectedCount * 2) {
+					capacity *= 2;
+				}
+				m_Slots.resize(capacity, Slot_t{ 0, 0, 0, OBJ_ABSENT_INDEX });
+			}
+
+			// @returns the vertex of the corner, 'newVertex' if it was not in the table yet.
+			uint32_t FindOrInsert(const ObjCorner_t &corner, uint32_t newVertex) {
+				if ((m_Count + 1) * 2 > m_Slots.size()) {
+					Grow();
+				}
+				const uint32_t mask = static_cast<uint32_t>(m_Slots.size() - 1);
+				for (uint32_t slot = Hash(corner) & mask; ; slot = (slot + 1) & mask) {
+					Slot_t &entry = m_Slots[slot];
+					if (entry.Vertex == OBJ_ABSENT_INDEX) {
+						entry = Slot_t{ corner.Index[0], corner.Index[1], corner.Index[2], newVertex };
+						m_Count++;
+						return newVertex;
+					}
+					if (entry.Position == corner.Index[0] && entry.Uv == corner.Index[1] && entry.Normal == corner.Index[2]) {
+						return entry.Vertex;
+					}
+				}
+			}
+
+		private:
+			struct Slot_t {
+				uint32_t Position, Uv, Normal;
+				uint32_t Vertex; // OBJ_ABSENT_INDEX if the slot is empty.
+			};
+
+			// Every bit of the key affects every bit of the hash (MurmurHash3's finalizer) : neighbouring corners do not cluster.
+			static uint32_t Hash(const ObjCorner_t &corner) {
+				uint64_t hash = ((static_cast<uint64_t>(corner.Index[0]) << 32) | corner.Index[1]) ^ (corner.Index[2] * 0x9E3779B97F4A7C15ull);
+				hash ^= hash >> 33;
+				hash *= 0xFF51AFD7ED558CCDull;
+				hash ^= hash >> 33;
+				hash *= 0xC4CEB9FE1A85EC53ull;
+				hash ^= hash >> 33;
+				return static_cast<uint32_t>(hash);
+			}
+
+			void Grow() {
+				std::vector<Slot_t> slots{};
+				slots.swap(m_Slots);
+				m_Slots.resize(slots.size() * 2, Slot_t{ 0, 0, 0, OBJ_ABSENT_INDEX });
+				m_Count = 0;
+				for (const Slot_t &slot : slots) {
+					if (slot.Vertex != OBJ_ABSENT_INDEX) {
+						FindOrInsert(ObjCorner_t{ { slot.Position, slot.Uv, slot.Normal }, 0 }, slot.Vertex);
+					}
+				}
+			}
+
+			std::vector<Slot_t> m_Slots;
+			uint32_t m_Count = 0;
+		};
+	}
+
+	static bool IsObjSpace(char character) {
+		return character == ' ' || character == '\t' || character == '\r';
+	}
+
+	static void SkipObjSpaces(const char *&pCurrent, const char *pEnd) {
+		while (pCurrent < pEnd && IsObjSpace(*pCurrent)) {
+			pCurrent++;
+		}
+	}
+
+	/*
+	@brief Parses a decimal number (sign, digits, fraction, exponent) after any spaces. The digits are accumulated as an integer then
+	scaled once, in double precision : exact for every float an exporter writes, at a fraction of strtof's cost.
+	@returns false, without moving pCurrent, if there is no number.
+	*/
+	static bool ParseObjFloat(const char *&pCurrent, const char *pEnd, float &value) {
+		static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+												1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char *p = pCurrent;
+		SkipObjSpaces(p, pEnd);
+		bool is_negative = false;
+		if (p < pEnd && (*p == '-' || *p == '+')) {
+			is_negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int32_t exponent = 0;
+		uint32_t digit_count = 0;
+		for (; p < pEnd && *p >= '0' && *p <= '9'; p++, digit_count++) {
+			if (mantissa < 1000000000000000000ull) {
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			} else {
+				exponent++; // Beyond what a double holds : only the magnitude matters.
+			}
+		}
+		if (p < pEnd && *p == '.') {
+			for (p++; p < pEnd && *p >= '0' && *p <= '9'; p++, digit_count++) {
+				if (mantissa < 1000000000000000000ull) {
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digit_count == 0) {
+			return false;
+		}
+		if (p < pEnd && (*p == 'e' || *p == 'E')) {
+			const char *exponent_start = p++;
+			bool is_exponent_negative = false;
+			if (p < pEnd && (*p == '-' || *p == '+')) {
+				is_exponent_negative = *p == '-';
+				p++;
+			}
+			if (p < pEnd && *p >= '0' && *p <= '9') {
+				int32_t written_exponent = 0;
+				for (; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+					written_exponent = std::min(written_exponent * 10 + (*p - '0'), 10000);
+				}
+				exponent += is_exponent_negative ? -written_exponent : written_exponent;
+			} else {
+				p = exponent_start; // Not an exponent : 'e' is part of what follows.
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (exponent < 0) {
+			result = exponent >= -22 ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+		} else if (exponent > 0) {
+			result = exponent <= 22 ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+		}
+		value = static_cast<float>(is_negative ? -result : result);
+		pCurrent = p;
+		return true;
+	}
+
+	// @returns false, without moving pCurrent, if there is no integer.
+	static bool ParseObjInt(const char *&pCurrent, const char *pEnd, int64_t &value) {
+		const char *p = pCurrent;
+		bool is_negative = false;
+		if (p < pEnd && (*p == '-' || *p == '+')) {
+			is_negative = *p == '-';
+			p++;
+		}
+		if (p >= pEnd || *p < '0' || *p > '9') {
+			return false;
+		}
+		int64_t result = 0;
+		for (; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+			result = std::min<int64_t>(result * 10 + (*p - '0'), INT64_C(1) << 40);
+		}
+		value = is_negative ? -result : result;
+		pCurrent = p;
+		return true;
+	}
+
+	// Parses 'p', 'p/t', 'p//n' or 'p/t/n' into a corner, still relative to the chunk (see ObjCorner_t).
+	static bool ParseObjCorner(const char *&pCurrent, const char *pEnd, const ObjChunk_t &chunk, ObjCorner_t &corner) {
+		corner = ObjCorner_t{ { OBJ_ABSENT_INDEX, OBJ_ABSENT_INDEX, OBJ_ABSENT_INDEX }, 0 };
+		for (uint32_t attribute = 0; attribute < 3; attribute++) {
+			if (attribute > 0) {
+				if (pCurrent >= pEnd || *pCurrent != '/') {
+					break;
+				}
+				pCurrent++;
+			}
+			int64_t index;
+			if (!ParseObjInt(pCurrent, pEnd, index)) {
+				if (attribute == 0) {
+					return false;
+				}
+				continue; // 'p//n' : no uv.
+			}
+			if (index > 0) {
+				corner.Index[attribute] = index - 1 < OBJ_INVALID_INDEX ? static_cast<uint32_t>(index - 1) : OBJ_INVALID_INDEX;
+			} else if (index < 0) {
+				// Relative to the end of the file so far. May point before the chunk : the offset added later makes it positive.
+				corner.Index[attribute] = static_cast<uint32_t>(static_cast<int64_t>(chunk.GetCount(attribute)) + index);
+				corner.RelativeMask |= 1u << attribute;
+			} else {
+				corner.Index[attribute] = OBJ_INVALID_INDEX;
+			}
+		}
+		return true;
+	}
+
+	static void ParseObjLine(const char *p, const char *pEnd, ObjChunk_t &chunk, std::vector<ObjCorner_t> &polygon) {
+		SkipObjSpaces(p, pEnd);
+		if (pEnd - p < 2) {
+			return;
+		}
+
+		float values[6];
+		if (p[0] == 'v' && IsObjSpace(p[1])) {
+			p += 2;
+			uint32_t count = 0;
+			while (count < 6 && ParseObjFloat(p, pEnd, values[count])) {
+				count++;
+			}
+			for (uint32_t i = count; i < 3; i++) {
+				values[i] = 0.0f;
+			}
+			chunk.Positions.insert(chunk.Positions.end(), values, values + 3);
+			if (count == 6) {
+				chunk.Colors.insert(chunk.Colors.end(), values + 3, values + 6);
+			} else {
+				chunk.Colors.insert(chunk.Colors.end(), 3, 1.0f);
+			}
+		} else if (p[0] == 'v' && p[1] == 't') {
+			p += 2;
+			values[0] = values[1] = 0.0f;
+			ParseObjFloat(p, pEnd, values[0]) && ParseObjFloat(p, pEnd, values[1]);
+			chunk.Uvs.insert(chunk.Uvs.end(), values, values + 2);
+		} else if (p[0] == 'v' && p[1] == 'n') {
+			p += 2;
+			values[0] = values[1] = values[2] = 0.0f;
+			ParseObjFloat(p, pEnd, values[0]) && ParseObjFloat(p, pEnd, values[1]) && ParseObjFloat(p, pEnd, values[2]);
+			chunk.Normals.insert(chunk.Normals.end(), values, values + 3);
+		} else if (p[0] == 'f' && IsObjSpace(p[1])) {
+			p += 2;
+			polygon.clear();
+			ObjCorner_t corner;
+			for (SkipObjSpaces(p, pEnd); p < pEnd && ParseObjCorner(p, pEnd, chunk, corner); SkipObjSpaces(p, pEnd)) {
+				polygon.push_back(corner);
+			}
+			// Fan : exact for the convex polygons exporters write.
+			for (size_t i = 2; i < polygon.size(); i++) {
+				chunk.Corners.push_back(polygon[0]);
+				chunk.Corners.push_back(polygon[i - 1]);
+				chunk.Corners.push_back(polygon[i]);
+			}
+		}
+	}
+
+	static void ParseObjChunk(ObjChunk_t &chunk) {
+		// Reserved from the usual density of OBJ files, to skip most reallocations.
+		const size_t size = static_cast<size_t>(chunk.pEnd - chunk.pBegin);
+		chunk.Positions.reserve(size / 96);
+		chunk.Colors.reserve(size / 96);
+		chunk.Corners.reserve(size / 24);
+
+		std::vector<ObjCorner_t> polygon{};
+		const char *p = chunk.pBegin;
+		while (p < chunk.pEnd) {
+			const char *line_end = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(chunk.pEnd - p)));
+			if (!line_end) {
+				line_end = chunk.pEnd;
+			}
+			ParseObjLine(p, line_end, chunk, polygon);
+			p = line_end + 1;
+		}
+	}
+
+	static void RunObjParallel(ThreadPool *pool, uint32_t count, uint32_t minBatchSize, const std::function<void(uint32_t, uint32_t)> &job) {
+		if (pool) {
+			pool->ParallelFor(count, minBatchSize, job);
+		} else {
+			job(0, count);
+		}
+	}
+
+	bool ImportObj(const char *path, bool deduplicate, ThreadPool *pool, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, ObjImportStats_t *pStats) {
+		vertices.clear();
+		indices.clear();
+
+		MappedFile file;
+		if (!file.Open(path)) {
+			if (std::filesystem::exists(path) && std::filesystem::file_size(path) == 0) {
+				return true; // Empty files cannot be mapped.
+			}
+			return false;
+		}
+
+		// Chunks of whole lines : each boundary is moved to the start of the next line.
+		const char *data = reinterpret_cast<const char *>(file.GetData());
+		const size_t size = file.GetSize();
+		const size_t max_chunk_count = pool ? pool->GetConcurrency() * 4 : 1;
+		const uint32_t chunk_count = static_cast<uint32_t>(std::max<size_t>(1, std::min(max_chunk_count, size / OBJ_MIN_CHUNK_SIZE)));
+		std::vector<ObjChunk_t> chunks(chunk_count);
+		const char *chunk_begin = data;
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			const char *chunk_end = data + size;
+			if (i + 1 < chunk_count) {
+				chunk_end = std::max(chunk_begin, data + size * (i + 1) / chunk_count);
+				const char *line_end = static_cast<const char *>(std::memchr(chunk_end, '\n', static_cast<size_t>(data + size - chunk_end)));
+				chunk_end = line_end ? line_end + 1 : data + size;
+			}
+			chunks[i].pBegin = chunk_begin;
+			chunks[i].pEnd = chunk_end;
+			chunk_begin = chunk_end;
+		}
+
+		RunObjParallel(pool, chunk_count, 1, [&chunks](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				ParseObjChunk(chunks[i]);
+			}
+		});
+
+		// Offsets of each chunk's first element of each attribute, to resolve relative indices and concatenate the attributes.
+		std::vector<std::array<uint32_t, 3>> first_elements(chunk_count);
+		std::array<uint32_t, 3> totals{ 0, 0, 0 };
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			first_elements[i] = totals;
+			for (uint32_t attribute = 0; attribute < 3; attribute++) {
+				totals[attribute] += chunks[i].GetCount(attribute);
+			}
+		}
+
+		std::vector<float> positions(totals[0] * 3);
+		std::vector<float> colors(totals[0] * 3);
+		std::vector<float> uvs(totals[1] * 2);
+		std::vector<float> normals(totals[2] * 3);
+		RunObjParallel(pool, chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				ObjChunk_t &chunk = chunks[i];
+				std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + first_elements[i][0] * 3);
+				std::copy(chunk.Colors.begin(), chunk.Colors.end(), colors.begin() + first_elements[i][0] * 3);
+				std::copy(chunk.Uvs.begin(), chunk.Uvs.end(), uvs.begin() + first_elements[i][1] * 2);
+				std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + first_elements[i][2] * 3);
+
+				for (size_t triangle = 0; triangle < chunk.Corners.size(); triangle += 3) {
+					bool is_valid = true;
+					for (size_t corner = triangle; corner < triangle + 3; corner++) {
+						ObjCorner_t &current = chunk.Corners[corner];
+						for (uint32_t attribute = 0; attribute < 3; attribute++) {
+							uint32_t &index = current.Index[attribute];
+							if (current.RelativeMask & (1u << attribute)) {
+								index += first_elements[i][attribute]; // Wraps back to positive if it pointed before the chunk.
+							} else if (index == OBJ_ABSENT_INDEX) {
+								is_valid &= attribute != 0;
+								continue;
+							}
+							is_valid &= index < totals[attribute];
+						}
+						current.RelativeMask = 0;
+					}
+					if (!is_valid) {
+						chunk.Corners[triangle].Index[0] = OBJ_ABSENT_INDEX;
+						chunk.InvalidTriangles++;
+					}
+				}
+			}
+		});
+
+		// Index of each chunk's first valid corner : the corners keep the order of the file.
+		std::vector<uint32_t> first_corners(chunk_count);
+		uint32_t corner_count = 0;
+		uint32_t invalid_triangles = 0;
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			first_corners[i] = corner_count;
+			corner_count += static_cast<uint32_t>(chunks[i].Corners.size()) - chunks[i].InvalidTriangles * 3;
+			invalid_triangles += chunks[i].InvalidTriangles;
+		}
+		// Calls 'job(corner, index)' for the valid corners of the chunks from 'begin' to 'end'.
+		const auto for_each_corner = [&chunks, &first_corners](uint32_t begin, uint32_t end, const auto &job) {
+			for (uint32_t i = begin; i < end; i++) {
+				const std::vector<ObjCorner_t> &corners = chunks[i].Corners;
+				uint32_t index = first_corners[i];
+				for (size_t triangle = 0; triangle < corners.size(); triangle += 3) {
+					if (corners[triangle].Index[0] == OBJ_ABSENT_INDEX) {
+						continue;
+					}
+					for (size_t corner = triangle; corner < triangle + 3; corner++) {
+						job(corners[corner], index++);
+					}
+				}
+			}
+		};
+
+		indices.resize(corner_count);
+		std::vector<ObjCorner_t> vertex_corners{};
+		if (!deduplicate) {
+			vertex_corners.resize(corner_count);
+			RunObjParallel(pool, chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+				for_each_corner(begin, end, [&](const ObjCorner_t &corner, uint32_t index) {
+					vertex_corners[index] = corner;
+					indices[index] = index;
+				});
+			});
+			chunks.clear();
+		} else {
+			// Corners of different positions never match : each range of positions is deduplicated on its own, in parallel. Vertices
+			// are grouped by range, in the order their first corner appears in.
+			const uint32_t partition_count = std::max<uint32_t>(1, std::min(pool ? pool->GetConcurrency() : 1, totals[0]));
+			const auto get_partition = [partition_count, &totals](const ObjCorner_t &corner) {
+				return static_cast<uint32_t>(static_cast<uint64_t>(corner.Index[0]) * partition_count / totals[0]);
+			};
+
+			// Corners bucketed by partition in one pass : a histogram per chunk, then each chunk writes from its offset in each partition.
+			// Within a partition, corners keep the order of the file.
+			std::vector<uint32_t> chunk_offsets(static_cast<size_t>(chunk_count) * partition_count, 0); // [chunk * partition_count + partition]
+			RunObjParallel(pool, chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t chunk = begin; chunk < end; chunk++) {
+					uint32_t *counts = &chunk_offsets[static_cast<size_t>(chunk) * partition_count];
+					for_each_corner(chunk, chunk + 1, [&](const ObjCorner_t &corner, uint32_t) {
+						counts[get_partition(corner)]++;
+					});
+				}
+			});
+			std::vector<uint32_t> partition_begins(partition_count + 1);
+			uint32_t bucketed_count = 0;
+			for (uint32_t partition = 0; partition < partition_count; partition++) {
+				partition_begins[partition] = bucketed_count;
+				for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+					uint32_t &offset = chunk_offsets[static_cast<size_t>(chunk) * partition_count + partition];
+					const uint32_t count = offset;
+					offset = bucketed_count;
+					bucketed_count += count;
+				}
+			}
+			partition_begins[partition_count] = bucketed_count;
+
+			std::vector<ObjBucketedCorner_t> bucketed(bucketed_count);
+			RunObjParallel(pool, chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t chunk = begin; chunk < end; chunk++) {
+					uint32_t *offsets = &chunk_offsets[static_cast<size_t>(chunk) * partition_count];
+					for_each_corner(chunk, chunk + 1, [&](const ObjCorner_t &corner, uint32_t index) {
+						bucketed[offsets[get_partition(corner)]++] = ObjBucketedCorner_t{ corner, index };
+					});
+				}
+			});
+
+			std::vector<std::vector<ObjCorner_t>> partition_vertices(partition_count);
+			RunObjParallel(pool, partition_count, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t partition = begin; partition < end; partition++) {
+					std::vector<ObjCorner_t> &partition_corners = partition_vertices[partition];
+					partition_corners.reserve(totals[0] / partition_count);
+					ObjCornerTable table{ totals[0] / partition_count };
+					for (uint32_t i = partition_begins[partition]; i < partition_begins[partition + 1]; i++) {
+						const ObjBucketedCorner_t &bucketed_corner = bucketed[i];
+						const uint32_t new_vertex = static_cast<uint32_t>(partition_corners.size());
+						const uint32_t vertex = table.FindOrInsert(bucketed_corner.Corner, new_vertex);
+						if (vertex == new_vertex) {
+							partition_corners.push_back(bucketed_corner.Corner);
+						}
+						indices[bucketed_corner.Index] = vertex; // Within the partition, offset below.
+					}
+				}
+			});
+
+			std::vector<uint32_t> first_vertices(partition_count);
+			for (uint32_t partition = 0; partition < partition_count; partition++) {
+				first_vertices[partition] = static_cast<uint32_t>(vertex_corners.size());
+				vertex_corners.insert(vertex_corners.end(), partition_vertices[partition].begin(), partition_vertices[partition].end());
+			}
+			partition_vertices.clear();
+			if (partition_count > 1) {
+				RunObjParallel(pool, partition_count, 1, [&](uint32_t begin, uint32_t end) {
+					for (uint32_t partition = begin; partition < end; partition++) {
+						for (uint32_t i = partition_begins[partition]; i < partition_begins[partition + 1]; i++) {
+							indices[bucketed[i].Index] += first_vertices[partition];
+						}
+					}
+				});
+			}
+			chunks.clear();
+		}
+
+		vertices.resize(vertex_corners.size());
+		std::atomic<bool> is_missing_normals{ false };
+		RunObjParallel(pool, static_cast<uint32_t>(vertices.size()), 4096, [&](uint32_t begin, uint32_t end) {
+			bool is_batch_missing_normals = false;
+			for (uint32_t i = begin; i < end; i++) {
+				const ObjCorner_t &corner = vertex_corners[i];
+				Vertex &vertex = vertices[i];
+				const float *position = &positions[corner.Index[0] * size_t{ 3 }];
+				const float *color = &colors[corner.Index[0] * size_t{ 3 }];
+				vertex.Position = { position[0], position[1], position[2] };
+				vertex.Color = { color[0], color[1], color[2] };
+				if (corner.Index[1] != OBJ_ABSENT_INDEX) {
+					vertex.uv = { uvs[corner.Index[1] * size_t{ 2 }], uvs[corner.Index[1] * size_t{ 2 } + 1] };
+				}
+				if (corner.Index[2] != OBJ_ABSENT_INDEX) {
+					const float *normal = &normals[corner.Index[2] * size_t{ 3 }];
+					vertex.Normal = { normal[0], normal[1], normal[2] };
+				} else {
+					is_batch_missing_normals = true;
+				}
+			}
+			if (is_batch_missing_normals) {
+				is_missing_normals = true;
+			}
+		});
+
+		// Smooth normals for the corners without one, shared by every vertex at a position whatever its uv.
+		if (is_missing_normals) {
+			std::vector<glm::vec3> position_normals(totals[0], glm::vec3{ 0.0f });
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				const glm::vec3 &a = vertices[indices[i]].Position;
+				const glm::vec3 &b = vertices[indices[i + 1]].Position;
+				const glm::vec3 &c = vertices[indices[i + 2]].Position;
+				const glm::vec3 face_normal = glm::cross(b - a, c - a); // Its length is twice the area : the average is area weighted.
+				for (size_t corner = i; corner < i + 3; corner++) {
+					position_normals[vertex_corners[indices[corner]].Index[0]] += face_normal;
+				}
+			}
+			for (size_t i = 0; i < vertices.size(); i++) {
+				if (vertex_corners[i].Index[2] == OBJ_ABSENT_INDEX) {
+					const glm::vec3 &normal = position_normals[vertex_corners[i].Index[0]];
+					const float length = glm::length(normal);
+					vertices[i].Normal = length > 0.0f ? normal / length : glm::vec3{ 0.0f, 1.0f, 0.0f };
+				}
+			}
+		}
+
+		if (pStats) {
+			pStats->PositionCount = totals[0];
+			pStats->TriangleCount = static_cast<uint32_t>(indices.size() / 3);
+			pStats->InvalidTriangles = invalid_triangles;
+			pStats->HasGeneratedNormals = is_missing_normals;
+		}
+		return true;
+	}
+
+	// The importer ImportObj() replaced, timed against it.
+	static bool ImportObjWithTinyObjLoader(const char *path, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn;
+		std::string err;
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
+			return false;
+		}
+
+		std::unordered_map<Vertex, uint32_t> unique_vertices{};
+		for (const tinyobj::shape_t &shape : shapes) {
+			for (const tinyobj::index_t &index : shape.mesh.indices) {
+				Vertex vertex{};
+				vertex.Position = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2] };
+				if (index.normal_index >= 0) {
+					vertex.Normal = { attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2] };
+				}
+				if (index.texcoord_index >= 0) {
+					vertex.uv = { attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1] };
+				}
+				const auto inserted = unique_vertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+				if (inserted.second) {
+					vertices.push_back(vertex);
+				}
+				indices.push_back(inserted.first->second);
+			}
+		}
+		return true;
+	}
+
+	// Writes a grid of 'triangleCount' triangles (at least), as quads with positions, uvs and normals.
+	static bool WriteObjGrid(const std::string &path, uint32_t triangleCount) {
+		const uint32_t side = static_cast<uint32_t>(glm::ceil(glm::sqrt(triangleCount / 2.0f))) + 1;
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file) {
+			return false;
+		}
+
+		char line[128];
+		std::string buffer{};
+		buffer.reserve(1 << 20);
+		const auto flush = [&file, &buffer](bool force) {
+			if (force || buffer.size() > (1 << 20) - 128) {
+				file.write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		};
+		for (uint32_t y = 0; y < side; y++) {
+			for (uint32_t x = 0; x < side; x++) {
+				const float u = x / static_cast<float>(side - 1);
+				const float v = y / static_cast<float>(side - 1);
+				const float height = 0.05f * glm::sin(u * 31.0f) * glm::cos(v * 17.0f);
+				buffer.append(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", u, height, v, u, v, 0.0f, 1.0f, 0.0f));
+				flush(false);
+			}
+		}
+		for (uint32_t y = 0; y + 1 < side; y++) {
+			for (uint32_t x = 0; x + 1 < side; x++) {
+				const uint32_t a = y * side + x + 1;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + side + 1;
+				const uint32_t d = a + side;
+				buffer.append(line, std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d));
+				flush(false);
+			}
+		}
+		flush(true);
+		return static_cast<bool>(file);
+	}
+
+	CONSOLE_COMMAND_HELP(bench_obj_import, "Usage : bench_obj_import [path | triangles]\nTimes the import of an OBJ file with the previous importer (Tiny Object Loader, unordered_map) then with ImportObj, on one thread and on the thread pool. Without a path, a grid of 'triangles' (2 million by default) is written to the temporary directory and imported.") {
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		std::string path = args.GetArgC() > 0 ? args.GetArg(0) : "";
+		char *pNumberEnd = nullptr;
+		const uint32_t triangle_count = path.empty() ? 2000000 : static_cast<uint32_t>(std::strtoul(path.c_str(), &pNumberEnd, 10));
+		const bool is_generated = path.empty() || (*pNumberEnd == '\0' && triangle_count > 0);
+		if (is_generated) {
+			path = (std::filesystem::temp_directory_path() / "gigno_bench_obj_import.obj").string();
+			if (!WriteObjGrid(path, triangle_count)) {
+				console->LogError("Could not write '%s'.", path.c_str());
+				return;
+			}
+		}
+		std::error_code error;
+		const double size_mib = std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+
+		using clock_t = std::chrono::steady_clock;
+		const auto milliseconds_since = [](clock_t::time_point start) {
+			return std::chrono::duration<double, std::milli>(clock_t::now() - start).count();
+		};
+
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+		clock_t::time_point start = clock_t::now();
+		if (!ImportObjWithTinyObjLoader(path.c_str(), vertices, indices)) {
+			console->LogError("Could not import '%s'.", path.c_str());
+			return;
+		}
+		const double previous_ms = milliseconds_since(start);
+		console->LogInfo("Importing '%s' (%.1f MiB, %u triangles, %u vertices) :", path.c_str(), size_mib,
+			static_cast<uint32_t>(indices.size() / 3), static_cast<uint32_t>(vertices.size()));
+		console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  Tiny Object Loader : %.1f ms (%.1f MiB/s).", previous_ms, size_mib * 1000.0 / previous_ms);
+
+		ThreadPool *pool = Application::Singleton()->GetThreadPool();
+		for (ThreadPool *current_pool : { static_cast<ThreadPool *>(nullptr), pool }) {
+			start = clock_t::now();
+			ImportObj(path.c_str(), true, current_pool, vertices, indices);
+			const double import_ms = milliseconds_since(start);
+			console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  ImportObj, %u thread(s) : %.1f ms (%.1f MiB/s, x%.1f).", current_pool ? current_pool->GetConcurrency() : 1,
+				import_ms, size_mib * 1000.0 / import_ms, previous_ms / import_ms);
+		}
+
+		if (is_generated) {
+			std::filesystem::remove(path, error);
+		}
+	}
+
+}
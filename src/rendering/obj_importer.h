@@ -0,0 +1,35 @@
+#ifndef OBJ_IMPORTER_H
+#define OBJ_IMPORTER_H
+
+#include <vector>
+#include <cstdint>
+
+namespace gigno {
+
+	struct Vertex;
+	class ThreadPool;
+
+	struct ObjImportStats_t {
+		uint32_t PositionCount = 0;
+		uint32_t TriangleCount = 0;   // Kept, after triangulation.
+		uint32_t InvalidTriangles = 0; // Dropped : an index was out of range.
+		bool HasGeneratedNormals = false; // Some corners had no normal : smooth normals were computed for them.
+	};
+
+	/*
+	@brief Imports the triangles of an OBJ file (v, vt, vn and f lines, polygons triangulated as fans). Materials, groups and
+	smoothing groups are ignored.
+	The file is mapped and split in chunks of whole lines, tokenized in parallel. The chunks' attributes are then concatenated and
+	their relative (negative) indices resolved, and the face corners deduplicated on their (position, uv, normal) indices through
+	open addressing tables, one per range of positions, in parallel.
+	Corners without uv get (0, 0). Corners without normal get a smooth normal : the area weighted average of the faces around
+	their position. Positions without color (v x y z r g b) are white.
+	@param pool parses on the calling thread alone if null.
+	@param deduplicate if false, every face corner is its own vertex.
+	@returns false if the file cannot be read. An empty file is valid.
+	*/
+	bool ImportObj(const char *path, bool deduplicate, ThreadPool *pool, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, ObjImportStats_t *pStats = nullptr);
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "pipeline.h"
 #include "model.h"
+#include "debug_drawer.h"
 
 #include <fstream>
 #include "../error_macros.h"
@@ -14,6 +15,9 @@ namespace gigno {
 
 		CreateShaderModule(device, vertCode, &m_VertShaderModule);
 		CreateShaderModule(device, fragCode, &m_FragShaderModule);
+		if (m_VertShaderModule == VK_NULL_HANDLE || m_FragShaderModule == VK_NULL_HANDLE) {
+			return; // Already logged. Stays invalid.
+		}
 
 		CreateGraphicsPipeline(device, vertFilepath, fragFilepath, createInfo);
 	}
@@ -47,16 +51,19 @@ namespace gigno {
 		shaderStageCreateInfos[1].pName = "main";
 		shaderStageCreateInfos[1].pSpecializationInfo = nullptr;
 
-		VkVertexInputBindingDescription bindingDescription = Vertex::GetBindingDescription();
-		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = Vertex::GetAttributeDescriptions();
+		VertexLayout_t vertex_layout = VertexLayout_t::FromFormat(createInfo.vertexFormat, createInfo.positionOnly);
+		if (createInfo.debugShapeInstances) {
+			AddDebugShapeInstanceLayout(vertex_layout);
+		}
 
 		VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
 		vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputCreateInfo.pNext = nullptr;
-		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-		vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+		vertexInputCreateInfo.flags = 0;
+		vertexInputCreateInfo.vertexBindingDescriptionCount = vertex_layout.BindingCount;
+		vertexInputCreateInfo.pVertexBindingDescriptions = vertex_layout.Bindings;
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = vertex_layout.AttributeCount;
+		vertexInputCreateInfo.pVertexAttributeDescriptions = vertex_layout.Attributes;
 
 		VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
 		graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -79,14 +86,20 @@ namespace gigno {
 		graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 		graphicsPipelineCreateInfo.basePipelineIndex = -1;
 
-		VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &m_VkPipeline);
+		VkResult result = vkCreateGraphicsPipelines(device, createInfo.pipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &m_VkPipeline);
 
 		if (result != VK_SUCCESS) {
+			m_VkPipeline = VK_NULL_HANDLE;
 			ERR_MSG("Failed to create Graphics Pipeline ! Vulkand error code : %d", (int)result);
 		}
 	}
 
 	void giPipeline::CreateShaderModule(VkDevice device, std::vector<char> code, VkShaderModule *shaderModule) {
+		*shaderModule = VK_NULL_HANDLE;
+		if (code.empty() || code.size() % sizeof(uint32_t) != 0) {
+			ERR_MSG("Cannot create ShaderModule : the SPIR-V code is empty or truncated (%zu bytes).", code.size());
+		}
+
 		VkShaderModuleCreateInfo createInfo;
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.pNext = nullptr;
@@ -95,6 +108,7 @@ namespace gigno {
 
 		VkResult result = vkCreateShaderModule(device, &createInfo, nullptr, shaderModule);
 		if (result != VK_SUCCESS) {
+			*shaderModule = VK_NULL_HANDLE;
 			ERR_MSG("Failed to create ShaderModule ! Vulkan error code : %d. \n "
 			"If the error code is -13, make sure the shader files are present in the running directory (from which the executable is ran) in the folder 'shader/'.", (int)result);
 		}
@@ -104,7 +118,7 @@ namespace gigno {
 		std::ifstream infile{ path, std::ios::ate | std::ios::binary };
 
 		if (!infile.is_open()) {
-			ERR_MSG_V(std::vector<char> {}, "failed to open file: %s", path);
+			ERR_MSG_V(std::vector<char> {}, "failed to open file: %s", path.c_str());
 		}
 
 		size_t filesize = static_cast<size_t>(infile.tellg());
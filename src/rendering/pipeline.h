@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include "device.h"
+#include "model.h"
 
 namespace gigno {
 	struct giPipelineConfigInfo {
@@ -22,6 +23,10 @@ namespace gigno {
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		VertexFormat_t vertexFormat = VERTEX_FORMAT_FLOAT;
+		bool positionOnly = false; // Only the position binding (see VertexLayout_t).
+		bool debugShapeInstances = false; // Adds the per-instance binding of the debug shapes (see AddDebugShapeInstanceLayout()).
 	};
 
 	class giPipeline {
@@ -32,20 +37,24 @@ namespace gigno {
 		void CleanUp(VkDevice device);
 
 		VkPipeline GetVkPipeline() { return m_VkPipeline; }
+		// False if a shader could not be read or the pipeline could not be created (already logged). Must still be cleaned up.
+		bool IsValid() const { return m_VkPipeline != VK_NULL_HANDLE; }
 
 		giPipeline(const giPipeline &) = delete;
 		giPipeline(giPipeline &) = delete;
 
 		static void DefaultConfig(giPipelineConfigInfo &configInfo);
+
+		// Whole content of a binary file (SPIR-V). Empty if the file could not be opened.
+		static std::vector<char> ReadFile(std::string filePath);
 	private:
 		void CreateGraphicsPipeline(VkDevice device, const std::string &vertFilepath, const std::string &fragFilepath, const giPipelineConfigInfo& createInfo);
+		// Leaves shaderModule VK_NULL_HANDLE on failure.
 		void CreateShaderModule(VkDevice device, const std::vector<char> code, VkShaderModule *shaderModule);
 
-		static std::vector<char> ReadFile(std::string filePath);
-
-		VkPipeline m_VkPipeline;
-		VkShaderModule m_VertShaderModule;
-		VkShaderModule m_FragShaderModule;
+		VkPipeline m_VkPipeline = VK_NULL_HANDLE;
+		VkShaderModule m_VertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_FragShaderModule = VK_NULL_HANDLE;
 	};
 
 }
@@ -0,0 +1,133 @@
+#include "pipeline_cache.h"
+#include "../error_macros.h"
+
+#include "application.h"
+
+#include "../debug/console/command.h"
+
+#include <vector>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+namespace gigno {
+
+	CONSOLE_COMMAND_HELP(pipeline_cache, "Usage : pipeline_cache\nLogs whether the pipelines were created from a saved cache (warm start), how long it took, and how long swap chain recreations take.") {
+		RenderingServer *renderer = Application::Singleton()->GetRenderer();
+		const PipelineCacheStats_t &stats = renderer->GetPipelineCacheStats();
+		const SwapChainTimings_t &timings = renderer->GetSwapChainTimings();
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		if (stats.IsWarm) {
+			console->LogInfo("Pipeline cache : warm start, %zu bytes loaded.", stats.LoadedBytes);
+		} else {
+			console->LogInfo("Pipeline cache : cold start (%s).", stats.pColdReason ? stats.pColdReason : "unknown");
+		}
+		console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  Pipelines created in %.2f ms on startup.", timings.PipelineCreationMs);
+		console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  %u swap chain recreations : last %.2f ms, worst %.2f ms.", timings.RecreateCount, timings.LastRecreateMs, timings.MaxRecreateMs);
+	}
+
+	void PipelineCache::Load(VkDevice device, VkPhysicalDevice physDevice, const char *path) {
+		m_pPath = path;
+
+		std::vector<char> data{};
+		std::ifstream infile{ path, std::ios::ate | std::ios::binary };
+		if (infile.is_open()) {
+			data.resize(static_cast<size_t>(infile.tellg()));
+			infile.seekg(0);
+			infile.read(data.data(), data.size());
+			if (!infile) {
+				data.clear();
+			}
+		}
+
+		if (data.empty()) {
+			m_Stats.pColdReason = "no cache file";
+		} else if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+			m_Stats.pColdReason = "truncated cache file";
+			data.clear();
+		} else {
+			VkPipelineCacheHeaderVersionOne header{};
+			std::memcpy(&header, data.data(), sizeof(header));
+
+			VkPhysicalDeviceProperties properties{};
+			vkGetPhysicalDeviceProperties(physDevice, &properties);
+
+			if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+				m_Stats.pColdReason = "unknown cache header";
+				data.clear();
+			} else if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+				m_Stats.pColdReason = "cache made for another GPU";
+				data.clear();
+			} else if (std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+				m_Stats.pColdReason = "cache made by another driver version";
+				data.clear();
+			}
+		}
+
+		VkPipelineCacheCreateInfo createinfo{};
+		createinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createinfo.initialDataSize = data.size();
+		createinfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkResult result = vkCreatePipelineCache(device, &createinfo, nullptr, &m_Cache);
+		if (result != VK_SUCCESS && !data.empty()) {
+			// The driver refused the data : start empty rather than without a cache.
+			m_Stats.pColdReason = "cache data refused by the driver";
+			data.clear();
+			createinfo.initialDataSize = 0;
+			createinfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(device, &createinfo, nullptr, &m_Cache);
+		}
+		if (result != VK_SUCCESS) {
+			m_Cache = VK_NULL_HANDLE;
+			ERR_MSG("Failed to create Pipeline Cache ! Vulkan Error Code : %d", (int)result);
+		}
+
+		m_Stats.IsWarm = !data.empty();
+		m_Stats.LoadedBytes = data.size();
+	}
+
+	void PipelineCache::CleanUp(VkDevice device) {
+		if (m_Cache == VK_NULL_HANDLE) {
+			return;
+		}
+		Save(device);
+		vkDestroyPipelineCache(device, m_Cache, nullptr);
+		m_Cache = VK_NULL_HANDLE;
+	}
+
+	void PipelineCache::Save(VkDevice device) {
+		size_t size = 0;
+		VkResult result = vkGetPipelineCacheData(device, m_Cache, &size, nullptr);
+		if (result != VK_SUCCESS || size == 0) {
+			return;
+		}
+		std::vector<char> data(size);
+		result = vkGetPipelineCacheData(device, m_Cache, &size, data.data());
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to get Pipeline Cache data ! Vulkan Error Code : %d", (int)result);
+		}
+
+		const std::string temp_path = std::string{ m_pPath } + ".tmp";
+		{
+			std::ofstream outfile{ temp_path, std::ios::binary | std::ios::trunc };
+			if (!outfile.is_open()) {
+				ERR_MSG("Failed to open '%s' to save the pipeline cache.", temp_path.c_str());
+			}
+			outfile.write(data.data(), size);
+			if (!outfile) {
+				outfile.close();
+				std::remove(temp_path.c_str());
+				ERR_MSG("Failed to write the pipeline cache to '%s'.", temp_path.c_str());
+			}
+		}
+
+		std::remove(m_pPath); // rename() does not replace an existing file everywhere.
+		if (std::rename(temp_path.c_str(), m_pPath) != 0) {
+			ERR_MSG("Failed to move the pipeline cache to '%s'.", m_pPath);
+		}
+		m_Stats.SavedBytes = size;
+	}
+
+}
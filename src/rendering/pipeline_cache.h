@@ -0,0 +1,48 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "vulkan/vulkan.h"
+
+#include <cstddef>
+
+namespace gigno {
+
+	struct PipelineCacheStats_t {
+		bool IsWarm = false;               // Started from the data of a previous run.
+		const char *pColdReason = nullptr; // Why the file was not used, if the start was cold.
+		size_t LoadedBytes = 0;
+		size_t SavedBytes = 0;
+	};
+
+	/*
+	VkPipelineCache saved to disk between runs, so that pipelines are not compiled again on every startup.
+
+	Usage :
+		* Initialisation : Load(), once the VkDevice exists. Owned by the Device.
+		* Clean Up : CleanUp() before the VkDevice is destroyed. Saves the cache back to the file first.
+		* Key Functions :
+		  * VkPipelineCache Get() : To pass to every vkCreate*Pipelines call.
+	Implementation :
+		* The file is only used if its header matches the device (vendor, device, pipelineCacheUUID) : a driver update or another
+		  GPU starts cold instead of handing stale data to the driver.
+		* Saved to a temporary file first, then renamed : a crash while saving never leaves a truncated cache behind.
+	*/
+	class PipelineCache {
+	public:
+		void Load(VkDevice device, VkPhysicalDevice physDevice, const char *path);
+		void CleanUp(VkDevice device);
+
+		VkPipelineCache Get() const { return m_Cache; }
+		const PipelineCacheStats_t &GetStats() const { return m_Stats; }
+
+	private:
+		void Save(VkDevice device);
+
+		const char *m_pPath = nullptr;
+		VkPipelineCache m_Cache = VK_NULL_HANDLE;
+		PipelineCacheStats_t m_Stats{};
+	};
+
+}
+
+#endif
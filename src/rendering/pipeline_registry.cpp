@@ -0,0 +1,135 @@
+#include "pipeline_registry.h"
+#include "pipeline.h"
+#include "device.h"
+#include "../threading/thread_pool.h"
+#include "../error_macros.h"
+
+#include <functional>
+#include <thread>
+
+namespace gigno {
+
+	size_t PipelineDesc_t::Hash() const {
+		size_t hash = std::hash<std::string>()(VertShaderPath);
+		const auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+		combine(std::hash<std::string>()(FragShaderPath));
+		combine(static_cast<size_t>(VertexFormat));
+		combine(static_cast<size_t>(PolygonMode));
+		combine(static_cast<size_t>(CullMode));
+		combine((DepthTest ? 1u : 0u) | (DepthWrite ? 2u : 0u) | (ColorWrite ? 4u : 0u) | (Blend ? 8u : 0u) | (DebugShapeInstances ? 16u : 0u));
+		return hash;
+	}
+
+	void PipelineRegistry::Init(const Device &device, VkRenderPass renderPass, VkPipelineLayout layout, const PipelineDesc_t &fallbackDesc) {
+		m_Device = device.GetDevice();
+		m_PipelineCache = device.GetPipelineCache();
+		m_RenderPass = renderPass;
+		m_PipelineLayout = layout;
+		m_SupportsWireframe = device.SupportsWireframe();
+
+		// Everything falls back to it : compiled right away.
+		m_Entries.push_back(std::make_unique<Entry_t>());
+		m_Entries.back()->Desc = fallbackDesc;
+		m_Ids.emplace(fallbackDesc, FALLBACK_PIPELINE_ID);
+		Compile(*m_Entries.back());
+	}
+
+	void PipelineRegistry::CleanUp(VkDevice device) {
+		// Compilations write to the entries : let them finish.
+		while (m_PendingCount.load(std::memory_order_acquire) > 0) {
+			std::this_thread::yield();
+		}
+
+		for (std::unique_ptr<Entry_t> &entry : m_Entries) {
+			if (entry->Pipeline) {
+				entry->Pipeline->CleanUp(device);
+			}
+		}
+		m_Entries.clear();
+		m_Ids.clear();
+		m_Queued.clear();
+	}
+
+	PipelineId_t PipelineRegistry::Request(const PipelineDesc_t &desc, PipelineId_t fallback) {
+		auto found = m_Ids.find(desc);
+		if (found != m_Ids.end()) {
+			return found->second;
+		}
+
+		ASSERT(fallback == INVALID_PIPELINE_ID || fallback < m_Entries.size());
+		if (desc.PolygonMode != VK_POLYGON_MODE_FILL && !m_SupportsWireframe) {
+			return fallback;
+		}
+		if (m_Entries.size() >= INVALID_PIPELINE_ID) {
+			ERR_MSG_V(fallback, "Too many pipeline variants (%zu) ! Using the fallback pipeline.", m_Entries.size());
+		}
+
+		const PipelineId_t id = static_cast<PipelineId_t>(m_Entries.size());
+		m_Entries.push_back(std::make_unique<Entry_t>());
+		m_Entries.back()->Desc = desc;
+		m_Entries.back()->Fallback = fallback;
+		m_Ids.emplace(desc, id);
+		m_Queued.push_back(id);
+		return id;
+	}
+
+	void PipelineRegistry::SubmitCompilations(ThreadPool *pool) {
+		// Counted once submitted only : queued compilations never started must not be waited for by CleanUp().
+		m_PendingCount.fetch_add(static_cast<uint32_t>(m_Queued.size()), std::memory_order_relaxed);
+		for (PipelineId_t id : m_Queued) {
+			Entry_t *entry = m_Entries[id].get();
+			pool->Submit([this, entry]() {
+				Compile(*entry);
+				m_PendingCount.fetch_sub(1, std::memory_order_release);
+			});
+		}
+		m_Queued.clear();
+	}
+
+	VkPipeline PipelineRegistry::Get(PipelineId_t id) const {
+		// Fallbacks have smaller ids : the walk ends.
+		while (id != INVALID_PIPELINE_ID) {
+			const Entry_t &entry = *m_Entries[id];
+			if (entry.IsReady.load(std::memory_order_acquire)) {
+				return entry.Pipeline->GetVkPipeline();
+			}
+			id = entry.Fallback;
+		}
+		return VK_NULL_HANDLE;
+	}
+
+	void PipelineRegistry::Compile(Entry_t &entry) {
+		const PipelineDesc_t &desc = entry.Desc;
+
+		giPipelineConfigInfo info{};
+		giPipeline::DefaultConfig(info);
+		info.renderPass = m_RenderPass;
+		info.pipelineLayout = m_PipelineLayout;
+		info.pipelineCache = m_PipelineCache; // Internally synchronized : safe to share between compiling threads.
+		info.vertexFormat = desc.VertexFormat;
+		info.debugShapeInstances = desc.DebugShapeInstances;
+
+		info.rasterizationInfo.polygonMode = desc.PolygonMode;
+		info.rasterizationInfo.cullMode = desc.CullMode;
+		info.depthStencilInfo.depthTestEnable = desc.DepthTest ? VK_TRUE : VK_FALSE;
+		info.depthStencilInfo.depthWriteEnable = desc.DepthWrite ? VK_TRUE : VK_FALSE;
+		if (!desc.ColorWrite) {
+			info.colorBlendAttachment.colorWriteMask = 0;
+		}
+		if (desc.Blend) {
+			info.colorBlendAttachment.blendEnable = VK_TRUE;
+			info.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			info.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		}
+
+		std::unique_ptr<giPipeline> pipeline = std::make_unique<giPipeline>(m_Device, desc.VertShaderPath, desc.FragShaderPath, info);
+		if (!pipeline->IsValid()) {
+			pipeline->CleanUp(m_Device);
+			entry.IsFailed.store(true, std::memory_order_release);
+			ERR_MSG("Failed to compile the pipeline of '%s' and '%s' ! Its fallback is drawn with instead.", desc.VertShaderPath.c_str(), desc.FragShaderPath.c_str());
+		}
+		entry.Pipeline = std::move(pipeline);
+		entry.IsReady.store(true, std::memory_order_release);
+	}
+
+}
@@ -0,0 +1,114 @@
+#ifndef PIPELINE_REGISTRY_H
+#define PIPELINE_REGISTRY_H
+
+#include "vulkan/vulkan.h"
+#include "model.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+namespace gigno {
+
+	class giPipeline;
+	class Device;
+	class ThreadPool;
+
+	/*
+	Everything a pipeline variant is made of, on top of giPipeline::DefaultConfig(). Two equal descriptions share the same pipeline.
+	The pipeline layout and render pass are the registry's.
+	*/
+	struct PipelineDesc_t {
+		std::string VertShaderPath;
+		std::string FragShaderPath;
+		VertexFormat_t VertexFormat = VERTEX_FORMAT_FLOAT; // Of the meshes drawn with the pipeline. Must match the vertex shader's inputs.
+		VkPolygonMode PolygonMode = VK_POLYGON_MODE_FILL; // VK_POLYGON_MODE_LINE needs Device::SupportsWireframe().
+		VkCullModeFlags CullMode = VK_CULL_MODE_NONE;
+		bool DepthTest = true;
+		bool DepthWrite = true;
+		bool ColorWrite = true;
+		bool Blend = false; // Alpha blending.
+		bool DebugShapeInstances = false; // Per instance DebugShapeInstance_t, on top of VERTEX_FORMAT_FLOAT vertices.
+
+		bool operator==(const PipelineDesc_t &other) const {
+			return other.VertShaderPath == VertShaderPath && other.FragShaderPath == FragShaderPath && other.VertexFormat == VertexFormat && other.PolygonMode == PolygonMode &&
+				   other.CullMode == CullMode && other.DepthTest == DepthTest && other.DepthWrite == DepthWrite && other.ColorWrite == ColorWrite &&
+				   other.Blend == Blend && other.DebugShapeInstances == DebugShapeInstances;
+		}
+		size_t Hash() const;
+	};
+
+	typedef uint8_t PipelineId_t; // Fits in the render queue's sort key.
+
+	/*
+	Every graphics pipeline of the SwapChain, built from descriptions. Variants are compiled on the thread pool : until one is
+	ready, Get() returns its fallback pipeline, so that requesting a new variant never stalls a frame.
+
+	Usage :
+		* Initialisation : Init(). Compiles the fallback pipeline (id FALLBACK_PIPELINE_ID) before returning. Owned by the SwapChain.
+		* Clean Up : CleanUp(), with the same device. Waits for the compilations in progress.
+		* Key Functions :
+		  * PipelineId_t Request( ... ) : Id of the pipeline matching the description. Queues its compilation the first time.
+		  * void SubmitCompilations( ... ) : Once per frame. Hands the queued compilations to the thread pool.
+		  * VkPipeline Get( ... ) : Pipeline to bind for an id. Thread safe.
+	Implementation :
+		* A fallback must take the same vertices as the variant : pipelines of other vertex formats have no fallback, and cannot
+		  be drawn with until compiled.
+	*/
+	class PipelineRegistry {
+	public:
+		static constexpr PipelineId_t FALLBACK_PIPELINE_ID = 0;
+		// No pipeline : as a fallback, or returned for requests that cannot be honored without one.
+		static constexpr PipelineId_t INVALID_PIPELINE_ID = UINT8_MAX;
+
+		void Init(const Device &device, VkRenderPass renderPass, VkPipelineLayout layout, const PipelineDesc_t &fallbackDesc);
+		void CleanUp(VkDevice device);
+
+		/*
+		@brief Main thread only. Requests that cannot be honored (too many pipelines, missing device feature) return the fallback.
+		@param fallback drawn with while the pipeline compiles. INVALID_PIPELINE_ID for none. Ignored if the pipeline was already requested.
+		*/
+		PipelineId_t Request(const PipelineDesc_t &desc, PipelineId_t fallback = FALLBACK_PIPELINE_ID);
+		// Main thread only. The thread pool does not exist yet when the SwapChain is created : requests wait for this call.
+		void SubmitCompilations(ThreadPool *pool);
+
+		// VK_NULL_HANDLE if neither the pipeline nor its fallbacks are compiled yet. A pipeline which failed to compile keeps returning its fallback.
+		VkPipeline Get(PipelineId_t id) const;
+		bool IsReady(PipelineId_t id) const { return id != INVALID_PIPELINE_ID && m_Entries[id]->IsReady.load(std::memory_order_acquire); }
+		// Whether the compilation failed (missing shader, invalid SPIR-V, ...) : the pipeline never becomes ready.
+		bool IsFailed(PipelineId_t id) const { return id != INVALID_PIPELINE_ID && m_Entries[id]->IsFailed.load(std::memory_order_acquire); }
+		// Compilations requested but not finished yet, queued ones included. Main thread only.
+		uint32_t GetPendingCount() const { return m_PendingCount.load(std::memory_order_relaxed) + static_cast<uint32_t>(m_Queued.size()); }
+
+	private:
+		struct Entry_t {
+			PipelineDesc_t Desc;
+			PipelineId_t Fallback = INVALID_PIPELINE_ID; // Always requested before this entry.
+			std::unique_ptr<giPipeline> Pipeline;
+			std::atomic<bool> IsReady{ false }; // Pipeline may be read once set.
+			std::atomic<bool> IsFailed{ false }; // Set instead of IsReady. Pipeline stays null.
+		};
+		struct DescHasher_t {
+			size_t operator()(const PipelineDesc_t &desc) const { return desc.Hash(); }
+		};
+
+		void Compile(Entry_t &entry);
+
+		VkDevice m_Device = VK_NULL_HANDLE;
+		VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+		VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		bool m_SupportsWireframe = false;
+
+		std::vector<std::unique_ptr<Entry_t>> m_Entries; // Indexed by id. Entries never move : compilations write to them.
+		std::unordered_map<PipelineDesc_t, PipelineId_t, DescHasher_t> m_Ids;
+		std::vector<PipelineId_t> m_Queued;
+		std::atomic<uint32_t> m_PendingCount{ 0 }; // Compilations submitted to the thread pool and not finished yet.
+	};
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "render_queue.h"
+#include "model.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace gigno {
+
+	uint64_t RenderQueue::MakeSortKey(uint8_t pipelineId, uint32_t meshId, float viewDepth) {
+		// The bits of a positive float sort like the float itself.
+		viewDepth = std::max(viewDepth, 0.0f);
+		uint32_t depth_bits;
+		memcpy(&depth_bits, &viewDepth, sizeof(depth_bits));
+
+		// Band 0 : depth < 1. Band n : depth in [2^(n-1), 2^n). The last band takes everything further.
+		const int exponent = static_cast<int>(depth_bits >> 23) - 127;
+		const uint64_t band = static_cast<uint64_t>(std::min(std::max(exponent + 1, 0), 15));
+
+		return (static_cast<uint64_t>(pipelineId) << 56) | (band << 52) | (static_cast<uint64_t>(meshId & 0xFFFFF) << 32) | depth_bits;
+	}
+
+	void RenderQueue::Clear() {
+		m_Entries.clear();
+		m_SortItems.clear();
+		m_Draws.clear();
+	}
+
+	void RenderQueue::Add(uint8_t pipelineId, giModel *model, uint32_t lod, uint32_t objectIndex, float viewDepth) {
+		static_assert(MAX_LOD_COUNT <= 4, "The level of detail must fit in the 2 low bits of the sort key's mesh.");
+		m_SortItems.push_back({ MakeSortKey(pipelineId, (model->GetId() << 2) | lod, viewDepth), static_cast<uint32_t>(m_Entries.size()) });
+		m_Entries.push_back({ model, objectIndex, pipelineId, static_cast<uint8_t>(lod) });
+	}
+
+	void RenderQueue::Build(uint32_t *instanceObjectIndices, uint32_t firstInstance) {
+		RadixSort(m_SortItems, m_SortScratch);
+
+		m_Draws.clear();
+		uint32_t instance = firstInstance;
+		for (const SortItem_t &item : m_SortItems) {
+			const Entry_t &entry = m_Entries[item.Value];
+			instanceObjectIndices[instance] = entry.ObjectIndex;
+
+			// Mesh ids may wrap around : compare the models themselves.
+			if (!m_Draws.empty() && m_Draws.back().pModel == entry.pModel && m_Draws.back().PipelineId == entry.PipelineId && m_Draws.back().Lod == entry.Lod) {
+				m_Draws.back().InstanceCount++;
+			} else {
+				m_Draws.push_back({ entry.PipelineId, entry.pModel, entry.Lod, instance, 1 });
+			}
+			instance++;
+		}
+	}
+
+}
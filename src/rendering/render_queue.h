@@ -0,0 +1,70 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../algorithm/radix_sort.h"
+
+namespace gigno {
+
+	class giModel;
+
+	// One instanced draw : consecutive queue entries with the same pipeline, model and level of detail.
+	struct RenderDraw_t {
+		uint8_t PipelineId;
+		giModel *pModel;
+		uint32_t Lod;
+		uint32_t FirstInstance;
+		uint32_t InstanceCount;
+	};
+
+	/*
+	Orders the frame's draws to minimize state changes, then merges them into instanced draws.
+
+	Usage :
+		* Key Functions :
+		  * void Add( ... ) : Queues an entity for the frame.
+		  * void Build( ... ) : Sorts the queue and fills the instance indices and the draws.
+		* Sort key, most significant bits first :
+		  * Pipeline (8 bits) : pipeline changes are the most expensive.
+		  * Coarse depth (4 bits) : log2 bands of view depth, so that opaque draws go roughly front-to-back (early-z)
+		    while each mesh is only split in as many draws as the bands it spans.
+		  * Mesh (20 bits) : consecutive draws of a band share their vertex and index buffers. The level of detail is in the
+		    low bits : the levels of a mesh share its buffers too.
+		  * Fine depth (32 bits) : front-to-back inside a draw.
+	*/
+	class RenderQueue {
+	public:
+		static uint64_t MakeSortKey(uint8_t pipelineId, uint32_t meshId, float viewDepth);
+
+		void Clear();
+		void Add(uint8_t pipelineId, giModel *model, uint32_t lod, uint32_t objectIndex, float viewDepth);
+
+		uint32_t GetSize() const { return static_cast<uint32_t>(m_Entries.size()); }
+
+		/*
+		@brief Sorts the queue and merges consecutive entries sharing pipeline, model and level of detail into draws.
+		@param instanceObjectIndices receives the ObjectIndex of each entry in sorted order, from 'firstInstance' on.
+		*/
+		void Build(uint32_t *instanceObjectIndices, uint32_t firstInstance);
+
+		const std::vector<RenderDraw_t> &GetDraws() const { return m_Draws; }
+
+	private:
+		struct Entry_t {
+			giModel *pModel;
+			uint32_t ObjectIndex;
+			uint8_t PipelineId;
+			uint8_t Lod;
+		};
+
+		std::vector<Entry_t> m_Entries;
+		std::vector<SortItem_t> m_SortItems;
+		std::vector<SortItem_t> m_SortScratch;
+		std::vector<RenderDraw_t> m_Draws;
+	};
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+#include "render_stats.h"
+#include "device.h"
+#include "../error_macros.h"
+
+#include "application.h"
+
+#include "../features_usage.h"
+#if USE_IMGUI
+	#include "imgui.h"
+#endif
+#include "../debug/console/command.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace gigno {
+
+	CONSOLE_COMMAND_HELP(stats, "Usage : stats [csv [path]]\nLogs the render stats of the last frame, and their average and maximum over the last frames kept. With 'csv', writes every frame kept to 'path' (render_stats.csv by default), one row per frame.") {
+		const RenderStatsHistory &history = Application::Singleton()->GetRenderer()->GetRenderStats();
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		if (args.GetArgC() == 0) {
+			history.LogToConsole();
+			return;
+		}
+		if (strcmp(args.GetArg(0), "csv") != 0) {
+			console->LogInfo("Unknown argument '%s'. Usage : stats [csv [path]]", args.GetArg(0));
+			return;
+		}
+		const char *path = args.GetArgC() > 1 ? args.GetArg(1) : "render_stats.csv";
+		if (history.WriteCsv(path)) {
+			console->LogInfo("Wrote the render stats of %u frames to '%s'.", history.GetFrameCount(), path);
+		}
+	}
+
+	const char *GetRenderStatName(RenderStat_t stat) {
+		switch (stat) {
+		case RENDER_STAT_DRAWS: return "Draws";
+		case RENDER_STAT_INSTANCES: return "Instances";
+		case RENDER_STAT_TRIANGLES: return "Triangles";
+		case RENDER_STAT_PIPELINE_BINDS: return "Pipeline Binds";
+		case RENDER_STAT_BUFFER_BINDS: return "Buffer Binds";
+		case RENDER_STAT_DESCRIPTOR_BINDS: return "Descriptor Set Binds";
+		case RENDER_STAT_PUSH_CONSTANTS: return "Push Constants";
+		case RENDER_STAT_UPLOADED_BYTES: return "Uploaded Bytes";
+		case RENDER_STAT_MAPPED_BYTES: return "Mapped Bytes Written";
+		case RENDER_STAT_ALLOCATIONS: return "Allocations";
+		case RENDER_STAT_DEVICE_ALLOCATIONS: return "Device Memory Allocations";
+		case RENDER_STAT_GPU_INPUT_VERTICES: return "GPU Input Vertices";
+		case RENDER_STAT_GPU_INPUT_PRIMITIVES: return "GPU Input Primitives";
+		case RENDER_STAT_GPU_VERTEX_INVOCATIONS: return "GPU Vertex Invocations";
+		case RENDER_STAT_GPU_CLIPPING_INVOCATIONS: return "GPU Clipping Invocations";
+		case RENDER_STAT_GPU_CLIPPING_PRIMITIVES: return "GPU Clipping Primitives";
+		case RENDER_STAT_GPU_FRAGMENT_INVOCATIONS: return "GPU Fragment Invocations";
+		case RENDER_STAT_GPU_COMPUTE_INVOCATIONS: return "GPU Compute Invocations";
+		default: return "Unknown";
+		}
+	}
+
+	void RenderStats_t::Add(const RenderStats_t &other) {
+		for (uint32_t i = 0; i < RENDER_STAT_FIRST_GPU; i++) {
+			Values[i] += other.Values[i];
+		}
+	}
+
+	void PipelineStatistics::Init(const Device &device, uint32_t frameCount) {
+		if (!device.SupportsPipelineStatistics()) {
+			return;
+		}
+		m_Device = device.GetDevice();
+
+		VkQueryPoolCreateInfo poolinfo{};
+		poolinfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolinfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolinfo.queryCount = 1;
+		poolinfo.pipelineStatistics = STATISTICS;
+
+		m_Frames.resize(frameCount);
+		for (FrameQuery_t &frame : m_Frames) {
+			VkResult result = vkCreateQueryPool(m_Device, &poolinfo, nullptr, &frame.Pool);
+			if (result != VK_SUCCESS) {
+				CleanUp(m_Device);
+				ERR_MSG("Failed to create Pipeline Statistics Query Pool ! Vulkan Error Code : %d", (int)result);
+			}
+		}
+	}
+
+	void PipelineStatistics::CleanUp(VkDevice device) {
+		for (FrameQuery_t &frame : m_Frames) {
+			vkDestroyQueryPool(device, frame.Pool, nullptr);
+		}
+		m_Frames.clear();
+	}
+
+	void PipelineStatistics::Begin(VkCommandBuffer buffer, uint32_t currentFrame, RenderStats_t &stats) {
+		if (!IsUsable()) {
+			return;
+		}
+		ASSERT(currentFrame < m_Frames.size());
+		m_CurrentFrame = currentFrame;
+		FrameQuery_t &frame = m_Frames[currentFrame];
+
+		if (frame.IsPending) {
+			// No wait flag : the frame's fence was waited, the results are available.
+			uint64_t results[STATISTIC_COUNT]{};
+			const VkResult result = vkGetQueryPoolResults(m_Device, frame.Pool, 0, 1, sizeof(results), results, sizeof(results), VK_QUERY_RESULT_64_BIT);
+			if (result == VK_SUCCESS) {
+				std::copy(results, results + STATISTIC_COUNT, stats.Values + RENDER_STAT_FIRST_GPU);
+				stats.HasGpuStats = true;
+			}
+			frame.IsPending = false;
+		}
+
+		vkCmdResetQueryPool(buffer, frame.Pool, 0, 1);
+		vkCmdBeginQuery(buffer, frame.Pool, 0, 0);
+	}
+
+	void PipelineStatistics::End(VkCommandBuffer buffer) {
+		if (!IsUsable()) {
+			return;
+		}
+		FrameQuery_t &frame = m_Frames[m_CurrentFrame];
+		vkCmdEndQuery(buffer, frame.Pool, 0);
+		frame.IsPending = true;
+	}
+
+	void RenderStatsHistory::Submit(const RenderStats_t &stats) {
+		if (m_Frames.size() < RENDER_STATS_HISTORY_SIZE) {
+			m_Frames.push_back(stats);
+		} else {
+			m_Frames[m_Next] = stats;
+			m_Next = (m_Next + 1) % RENDER_STATS_HISTORY_SIZE;
+		}
+		m_SubmittedCount++;
+	}
+
+	const RenderStats_t &RenderStatsHistory::GetFrame(uint32_t age) const {
+		ASSERT_V(age < m_Frames.size(), m_Frames.back());
+		// Until the ring is full, m_Next stays 0 and the frames are in order.
+		const uint32_t count = static_cast<uint32_t>(m_Frames.size());
+		return m_Frames[(m_Next + count - 1 - age) % count];
+	}
+
+	void RenderStatsHistory::GetSummary(RenderStats_t &average, RenderStats_t &max) const {
+		average = RenderStats_t{};
+		max = RenderStats_t{};
+
+		uint64_t gpu_frame_count = 0;
+		for (const RenderStats_t &frame : m_Frames) {
+			const uint32_t end = frame.HasGpuStats ? RENDER_STAT_MAX_ENUM : RENDER_STAT_FIRST_GPU;
+			for (uint32_t i = 0; i < end; i++) {
+				average.Values[i] += frame.Values[i];
+				max.Values[i] = std::max(max.Values[i], frame.Values[i]);
+			}
+			gpu_frame_count += frame.HasGpuStats ? 1 : 0;
+		}
+
+		for (uint32_t i = 0; i < RENDER_STAT_MAX_ENUM; i++) {
+			const uint64_t count = i < RENDER_STAT_FIRST_GPU ? m_Frames.size() : gpu_frame_count;
+			average.Values[i] = count > 0 ? average.Values[i] / count : 0;
+		}
+		average.HasGpuStats = max.HasGpuStats = gpu_frame_count > 0;
+	}
+
+	void RenderStatsHistory::DrawStatsTab() {
+	#if USE_IMGUI
+		if (m_Frames.empty()) {
+			ImGui::Text("No frame rendered yet.");
+			return;
+		}
+
+		RenderStats_t average{}, max{};
+		GetSummary(average, max);
+		const RenderStats_t &last = GetFrame(0);
+
+		ImGui::Text("Last frame, then average and maximum over the last %u frames.", GetFrameCount());
+		if (ImGui::Button("Write CSV")) {
+			if (WriteCsv("render_stats.csv")) {
+				Application::Singleton()->Debug()->GetConsole()->LogInfo("Wrote the render stats of %u frames to 'render_stats.csv'.", GetFrameCount());
+			}
+		}
+
+		if (ImGui::BeginTable("##render_stats", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+			ImGui::TableSetupColumn("Stat");
+			ImGui::TableSetupColumn("Last");
+			ImGui::TableSetupColumn("Average");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+
+			for (uint32_t i = 0; i < RENDER_STAT_MAX_ENUM; i++) {
+				const bool is_gpu = i >= RENDER_STAT_FIRST_GPU;
+				if (is_gpu && !max.HasGpuStats) {
+					break;
+				}
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(GetRenderStatName(static_cast<RenderStat_t>(i)));
+				ImGui::TableNextColumn();
+				if (is_gpu && !last.HasGpuStats) {
+					ImGui::TextUnformatted("-");
+				} else {
+					ImGui::Text("%llu", (unsigned long long)last.Values[i]);
+				}
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)average.Values[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)max.Values[i]);
+			}
+			ImGui::EndTable();
+		}
+
+		if (!max.HasGpuStats) {
+			ImGui::Text("Note : No pipeline statistics : unsupported by this device, or not read back yet.");
+		}
+	#endif
+	}
+
+	void RenderStatsHistory::LogToConsole() const {
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		if (m_Frames.empty()) {
+			console->LogInfo("Render stats : no frame rendered yet.");
+			return;
+		}
+
+		RenderStats_t average{}, max{};
+		GetSummary(average, max);
+		const RenderStats_t &last = GetFrame(0);
+
+		console->LogInfo("Render stats : last frame / average / maximum over the last %u frames.", GetFrameCount());
+		for (uint32_t i = 0; i < RENDER_STAT_MAX_ENUM; i++) {
+			if (i >= RENDER_STAT_FIRST_GPU && !max.HasGpuStats) {
+				console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  No pipeline statistics : unsupported by this device, or not read back yet.");
+				break;
+			}
+			console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  %s : %llu / %llu / %llu", GetRenderStatName(static_cast<RenderStat_t>(i)),
+							 (unsigned long long)last.Values[i], (unsigned long long)average.Values[i], (unsigned long long)max.Values[i]);
+		}
+	}
+
+	bool RenderStatsHistory::WriteCsv(const char *path) const {
+		FILE *file = fopen(path, "w");
+		if (!file) {
+			ERR_MSG_V(false, "Failed to open '%s' to write the render stats.", path);
+		}
+
+		fprintf(file, "Frame");
+		for (uint32_t i = 0; i < RENDER_STAT_MAX_ENUM; i++) {
+			fprintf(file, ",%s", GetRenderStatName(static_cast<RenderStat_t>(i)));
+		}
+		fprintf(file, "\n");
+
+		// GPU values are left empty for the frames that have none.
+		const uint32_t count = GetFrameCount();
+		for (uint32_t age = count; age-- > 0;) {
+			const RenderStats_t &frame = GetFrame(age);
+			fprintf(file, "%llu", (unsigned long long)(m_SubmittedCount - age));
+			for (uint32_t i = 0; i < RENDER_STAT_MAX_ENUM; i++) {
+				if (i >= RENDER_STAT_FIRST_GPU && !frame.HasGpuStats) {
+					fprintf(file, ",");
+				} else {
+					fprintf(file, ",%llu", (unsigned long long)frame.Values[i]);
+				}
+			}
+			fprintf(file, "\n");
+		}
+
+		fclose(file);
+		return true;
+	}
+
+}
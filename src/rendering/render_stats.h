@@ -0,0 +1,144 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace gigno {
+
+	class Device;
+
+	enum RenderStat_t {
+		// Counted on the CPU, as the frame is recorded. Indirect draws (r_gpu_culling) count as draws only : the GPU decides their
+		// instances, see the pipeline statistics for what they drew.
+		RENDER_STAT_DRAWS,
+		RENDER_STAT_INSTANCES,
+		RENDER_STAT_TRIANGLES,
+		RENDER_STAT_PIPELINE_BINDS,
+		RENDER_STAT_BUFFER_BINDS,      // vkCmdBindVertexBuffers and vkCmdBindIndexBuffer calls.
+		RENDER_STAT_DESCRIPTOR_BINDS,
+		RENDER_STAT_PUSH_CONSTANTS,
+		RENDER_STAT_UPLOADED_BYTES,    // Copied through the staging ring (see UploadManager).
+		RENDER_STAT_MAPPED_BYTES,      // Written straight to the frame's mapped buffers : objects, instances, lights, uniforms.
+		RENDER_STAT_ALLOCATIONS,       // Resources given memory by the MemoryAllocator.
+		RENDER_STAT_DEVICE_ALLOCATIONS, // vkAllocateMemory calls (new blocks and dedicated allocations).
+
+		// Pipeline statistics queries over the whole frame, in VkQueryPipelineStatisticFlagBits order. Read back once the GPU is done
+		// with the frame : they lag the CPU stats by the number of frames in flight.
+		RENDER_STAT_GPU_INPUT_VERTICES,
+		RENDER_STAT_GPU_INPUT_PRIMITIVES,
+		RENDER_STAT_GPU_VERTEX_INVOCATIONS,
+		RENDER_STAT_GPU_CLIPPING_INVOCATIONS,
+		RENDER_STAT_GPU_CLIPPING_PRIMITIVES,
+		RENDER_STAT_GPU_FRAGMENT_INVOCATIONS,
+		RENDER_STAT_GPU_COMPUTE_INVOCATIONS,
+
+		RENDER_STAT_MAX_ENUM
+	};
+	const uint32_t RENDER_STAT_FIRST_GPU = RENDER_STAT_GPU_INPUT_VERTICES;
+
+	const char *GetRenderStatName(RenderStat_t stat);
+
+	struct RenderStats_t {
+		uint64_t Values[RENDER_STAT_MAX_ENUM]{};
+		bool HasGpuStats = false; // Whether the RENDER_STAT_GPU_* values were read back for this frame.
+
+		uint64_t &operator[](RenderStat_t stat) { return Values[stat]; }
+		uint64_t operator[](RenderStat_t stat) const { return Values[stat]; }
+
+		void CountDraw(uint64_t instanceCount, uint64_t trianglesPerInstance) {
+			Values[RENDER_STAT_DRAWS]++;
+			Values[RENDER_STAT_INSTANCES] += instanceCount;
+			Values[RENDER_STAT_TRIANGLES] += instanceCount * trianglesPerInstance;
+		}
+		// Adds the CPU stats of 'other'.
+		void Add(const RenderStats_t &other);
+	};
+
+	/*
+	Pipeline statistics of whole frames, one query per frame in flight.
+
+	Usage :
+		* Initialisation : Init(). Owned by the SwapChain. Stays unusable (IsUsable() false) if the device cannot inherit pipeline
+		  statistics queries in secondary command buffers : every other function then does nothing.
+		* Clean Up : CleanUp(), with the same device.
+		* Key Functions :
+		  * void Begin( ... ) : First thing recorded in the frame's command buffer, once the frame's fence was waited.
+		  * void End( ... ) : Last thing recorded, outside of any render pass.
+		  * VkQueryPipelineStatisticFlags GetInheritedFlags() : What secondary command buffers executed by the frame must inherit.
+	*/
+	class PipelineStatistics {
+	public:
+		// @param frameCount number of frames in flight : each one has its own query pool.
+		void Init(const Device &device, uint32_t frameCount);
+		void CleanUp(VkDevice device);
+
+		bool IsUsable() const { return !m_Frames.empty(); }
+		// 0 if unusable.
+		VkQueryPipelineStatisticFlags GetInheritedFlags() const { return IsUsable() ? STATISTICS : 0; }
+
+		/*
+		@brief Reads back the statistics the frame's query measured the last time the frame was recorded, without waiting, then resets
+		and begins the query.
+		@param stats receives the RENDER_STAT_GPU_* values, if there were any.
+		*/
+		void Begin(VkCommandBuffer buffer, uint32_t currentFrame, RenderStats_t &stats);
+		void End(VkCommandBuffer buffer);
+
+	private:
+		static constexpr VkQueryPipelineStatisticFlags STATISTICS =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+		static constexpr uint32_t STATISTIC_COUNT = RENDER_STAT_MAX_ENUM - RENDER_STAT_FIRST_GPU;
+
+		struct FrameQuery_t {
+			VkQueryPool Pool = VK_NULL_HANDLE;
+			bool IsPending = false; // Recorded, not read back yet.
+		};
+		std::vector<FrameQuery_t> m_Frames;
+		uint32_t m_CurrentFrame = 0;
+		VkDevice m_Device = VK_NULL_HANDLE;
+	};
+
+	// Frames kept for the averages, maximums and CSV dumps.
+	const uint32_t RENDER_STATS_HISTORY_SIZE = 600;
+
+	/*
+	Render stats of the last frames. Shown in the debug window's "Render Stats" tab, logged by the 'stats' console command, and dumped
+	to CSV to compare runs.
+
+	Usage :
+		* Initialisation : Default constructor. Owned by the RenderingServer.
+		* Key Functions :
+		  * void Submit( ... ) : Once per frame.
+		  * void DrawStatsTab() : Must already be in an ImGui scope.
+		  * bool WriteCsv( ... ) : One row per frame kept, oldest first.
+	*/
+	class RenderStatsHistory {
+	public:
+		void Submit(const RenderStats_t &stats);
+
+		uint32_t GetFrameCount() const { return static_cast<uint32_t>(m_Frames.size()); }
+		// @param age 0 for the last frame submitted. Smaller than GetFrameCount().
+		const RenderStats_t &GetFrame(uint32_t age) const;
+		// Over the frames kept. GPU values only over the frames which have them.
+		void GetSummary(RenderStats_t &average, RenderStats_t &max) const;
+
+		void DrawStatsTab();
+		void LogToConsole() const;
+		// @returns whether the file was written.
+		bool WriteCsv(const char *path) const;
+
+	private:
+		std::vector<RenderStats_t> m_Frames; // Ring, up to RENDER_STATS_HISTORY_SIZE frames.
+		uint32_t m_Next = 0;                 // Where the next frame goes, once the ring is full.
+		uint64_t m_SubmittedCount = 0;
+	};
+
+}
+
+#endif
@@ -4,27 +4,50 @@
 
 #include "application.h"
 
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+
 #include "../features_usage.h"
 #if USE_IMGUI
 	#include "gui.h"
 #endif
+#include "../debug/console/command.h"
+#include "../debug/console/convar.h"
 
 namespace gigno {
 
-	RenderingServer::RenderingServer(int winw, int winh, const char *winTitle, InputServer *inputServer, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath) :
-		m_VertShaderFilePath{vertShaderFilePath},
-		m_FragShaderFilePath{fragShaderFilePath},
-		m_Window{ winw, winh, winTitle, inputServer },
+	Convar<uint32_t> convar_r_frames_in_flight = Convar<uint32_t>("r_frames_in_flight", "Frames the CPU may record ahead of the GPU, from 1 (lowest latency) to 3 (highest throughput). Waits for the GPU to be idle when changed.", 2);
+	Convar<uint32_t> convar_r_fps_max = Convar<uint32_t>("r_fps_max", "Frames per second the main loop is limited to, by sleeping then spinning. 0 = unlimited.", 0);
+	Convar<uint32_t> convar_r_late_latch = Convar<uint32_t>("r_late_latch", "1 = wait for the GPU to be done with a frame's resources before sampling its input rather than before recording it : lower input latency, less CPU/GPU overlap.", 0);
+
+	// Sleeps of the frame limiter. Shorter sleeps are less accurate relative to their length.
+	static const std::chrono::milliseconds FRAME_LIMITER_SLEEP{ 1 };
+
+	static uint32_t GetFramesInFlightSetting() {
+		return std::clamp<uint32_t>(convar_r_frames_in_flight, 1, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+	}
+
+	CONSOLE_COMMAND_HELP(gpu_memory, "Usage : gpu_memory\nLogs the GPU memory used by resources and reserved from the driver.") {
+		const GpuMemoryStats_t stats = Application::Singleton()->GetRenderer()->GetGpuMemoryStats();
+		Console *console = Application::Singleton()->Debug()->GetConsole();
+		console->LogInfo("GPU memory : %.2f MiB used / %.2f MiB reserved.", stats.UsedBytes / (1024.0 * 1024.0), stats.ReservedBytes / (1024.0 * 1024.0));
+		console->LogInfo(MESSAGE_NO_TIME_CODE_BIT, "  %u allocations, %u blocks, %u dedicated allocations.", stats.AllocationCount, stats.BlockCount, stats.DedicatedCount);
+	}
+
+	RenderingServer::RenderingServer(int winw, int winh, const char *winTitle, InputServer *inputServer, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath,
+									 RenderingMode_t renderingMode) :
+		m_Window{ winw, winh, winTitle, inputServer, renderingMode == RENDERING_MODE_HEADLESS },
 		m_Device{&m_Window},
-		m_SwapChain{ m_Device, &m_Window, vertShaderFilePath, fragShaderFilePath }
+		m_SwapChain{ m_Device, &m_Window, vertShaderFilePath, fragShaderFilePath },
+		m_UploadManager{ m_Device },
+		m_MeshCache{ m_Device, m_UploadManager }
 	{
+		m_FramesInFlight = GetFramesInFlightSetting();
 		CreateSyncObjects();
 
 #if USE_IMGUI
-		GLFWwindow *glfwWindow = m_Window.GetGLFWwindow();
-		if(glfwWindow){
-			InitImGui(glfwWindow, m_Device, m_SwapChain);
-		}
+		InitImGui(m_Window.GetGLFWwindow(), m_Device, m_SwapChain); // nullptr when headless.
 #endif
 	}
 
@@ -34,6 +57,8 @@ namespace gigno {
 		ShutdownImGui();
 #endif
 
+		m_MeshCache.CleanUp();
+		m_UploadManager.CleanUp();
 		m_SwapChain.CleanUp(m_Device.GetDevice());
 
 		for(rsize_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -47,6 +72,33 @@ namespace gigno {
 		vkDeviceWaitIdle(m_Device.GetDevice());
 	}
 
+	bool RenderingServer::CaptureFrame(const char *path) {
+		ASSERT_MSG_V(IsHeadless(), false, "Frame capture is only avaliable in headless mode.");
+		if (m_SubmittedFrameCount == 0) {
+			ERR_MSG_V(false, "Cannot capture frame : no frame was rendered yet.");
+		}
+
+		vkDeviceWaitIdle(m_Device.GetDevice());
+
+		const uint32_t last_frame = (m_CurrentFrame + m_FramesInFlight - 1) % m_FramesInFlight;
+		std::vector<uint8_t> pixels;
+		if (!m_SwapChain.ReadbackImage(m_Device, last_frame, pixels)) {
+			return false;
+		}
+
+		FILE *file = fopen(path, "wb");
+		if (!file) {
+			ERR_MSG_V(false, "Failed to open '%s' for frame capture.", path);
+		}
+		fprintf(file, "P6\n%u %u\n255\n", m_SwapChain.GetWidth(), m_SwapChain.GetHeight());
+		for (size_t i = 0; i < pixels.size(); i += 4) {
+			fwrite(&pixels[i], 1, 3, file); // Drop alpha.
+		}
+		fclose(file);
+
+		return true;
+	}
+
 	void RenderingServer::PollEvents() {
 		m_Window.PollEvents();
 	}
@@ -54,17 +106,26 @@ namespace gigno {
 	void RenderingServer::SubscribeRenderedEntity(RenderedEntity *entity) {
 		entity->pNextRenderedEntity = m_pFirstRenderedEntity;
 		m_pFirstRenderedEntity = entity;
+
+		if (!m_FreeObjectIndices.empty()) {
+			entity->ObjectIndex = m_FreeObjectIndices.back();
+			m_FreeObjectIndices.pop_back();
+		} else {
+			entity->ObjectIndex = m_ObjectIndexCount++;
+		}
 	}
 
 	void RenderingServer::UnsubscribeRenderedEntity(RenderedEntity *entity) {
 		RenderedEntity *curr = m_pFirstRenderedEntity;
 		if(curr == entity) {
 			m_pFirstRenderedEntity = curr->pNextRenderedEntity;
+			m_FreeObjectIndices.push_back(entity->ObjectIndex);
 			return;
 		}
 		while(curr) {
 			if(curr->pNextRenderedEntity == entity) {
 				curr->pNextRenderedEntity = entity->pNextRenderedEntity;
+				m_FreeObjectIndices.push_back(entity->ObjectIndex);
 				return;
 			}
 			curr = curr->pNextRenderedEntity;
@@ -82,27 +143,63 @@ namespace gigno {
 		m_LightEntities.erase(std::remove(m_LightEntities.begin(), m_LightEntities.end(), light), m_LightEntities.end());
 	}
 
-	void RenderingServer::CreateModel(std::shared_ptr<giModel> &model, const ModelData_t &modelData) {
-		model = std::make_shared<giModel>(giModel{ m_Device, modelData, m_SwapChain.GetCommandPool() });
+	void RenderingServer::CreateModel(MeshHandle &model, const ModelData_t &modelData) {
+		model = MeshHandle{ m_MeshCache.Create(modelData) };
+	}
+
+	MeshHandle RenderingServer::RequestModel(const std::string &path, const ModelImportOptions_t &options) {
+		return m_MeshCache.Request(path, options, Application::Singleton()->GetThreadPool());
 	}
 
 	//Debug Drawing
-	void RenderingServer::DrawPoint(glm::vec3 pos, glm::vec3 color, const std::string &uniqueName) {
+	void RenderingServer::DrawPoint(glm::vec3 pos, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const Vertex point{ pos, color };
+		DrawPoints(&point, 1, id, duration);
+	}
+	void RenderingServer::DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		DrawLineGradient(startPos, endPos, color, color, id, duration);
+	}
+	void RenderingServer::DrawLineGradient(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const Vertex vertices[] = { Vertex{ startPos, startColor }, Vertex{ endPos, endColor } };
+		DrawLines(vertices, 1, id, duration);
+	}
+	void RenderingServer::DrawBox(glm::vec3 center, glm::vec3 halfExtents, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const DebugShapeInstance_t instance = DebugBox(center, halfExtents, color);
+		DrawShapes(DEBUG_SHAPE_BOX, &instance, 1, id, duration);
+	}
+	void RenderingServer::DrawSphere(glm::vec3 center, float radius, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const DebugShapeInstance_t instance = DebugSphere(center, radius, color);
+		DrawShapes(DEBUG_SHAPE_SPHERE, &instance, 1, id, duration);
+	}
+	void RenderingServer::DrawFrustum(const glm::mat4 &viewProjection, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const DebugShapeInstance_t instance = DebugFrustum(viewProjection, color);
+		DrawShapes(DEBUG_SHAPE_BOX, &instance, 1, id, duration);
+	}
+	void RenderingServer::DrawAxes(const glm::mat4 &transform, float size, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const DebugShapeInstance_t instance = DebugAxes(transform, size);
+		DrawShapes(DEBUG_SHAPE_AXES, &instance, 1, id, duration);
+	}
+	void RenderingServer::DrawArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
+		const DebugShapeInstance_t instance = DebugArrow(start, end, color);
+		DrawShapes(DEBUG_SHAPE_ARROW, &instance, 1, id, duration);
+	}
+
+	void RenderingServer::DrawPoints(const Vertex *points, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
 #if USE_DEBUG_DRAWING
-		if(!ShowDD || !ShowDDPoints) { return; }
-		m_SwapChain.DrawPoint(pos, color, std::hash<std::string>{}(uniqueName));
+		if (!ShowDD) { return; }
+		m_SwapChain.GetDebugDrawer().AddPoints(points, count, id, duration);
 #endif
 	}
-	void RenderingServer::DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 color, const std::string &uniqueName) {
+	void RenderingServer::DrawLines(const Vertex *vertices, uint32_t lineCount, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
 #if USE_DEBUG_DRAWING
-		if (!ShowDD || !ShowDDLines) { return; }
-		m_SwapChain.DrawLine(startPos, endPos, color, color, std::hash<std::string>{}(uniqueName));
+		if (!ShowDD) { return; }
+		m_SwapChain.GetDebugDrawer().AddLines(vertices, lineCount, id, duration);
 #endif
 	}
-	void RenderingServer::DrawLineGradient(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, const std::string &uniqueName) {
+	void RenderingServer::DrawShapes(DebugShape_t shape, const DebugShapeInstance_t *instances, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration) {
 #if USE_DEBUG_DRAWING
-		if (!ShowDD || !ShowDDLines) { return; }
-		m_SwapChain.DrawLine(startPos, endPos, startColor, endColor, std::hash<std::string>{}(uniqueName));
+		if (!ShowDD) { return; }
+		m_SwapChain.GetDebugDrawer().AddShapes(shape, instances, count, id, duration);
 #endif
 	}
 
@@ -128,46 +225,126 @@ namespace gigno {
 	}
 
 
+	void RenderingServer::WaitForNextFrame() {
+		ProfilingServer *profiler = Application::Singleton()->Debug()->Profiler();
+
+		const uint32_t fps_max = convar_r_fps_max;
+		if (fps_max > 0) {
+			profiler->Begin("Frame Limiter");
+			using clock = std::chrono::steady_clock;
+			const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps_max));
+			clock::time_point now = clock::now();
+			// More than a frame late (hitch, loading, breakpoint) : start over rather than rushing frames out to catch up.
+			if (now > m_NextFrameTime + period) {
+				m_NextFrameTime = now;
+			}
+
+			// Sleeps overshoot by up to the OS timer's resolution : sleep while far enough from the target, spin the rest.
+			while (m_NextFrameTime - now > FRAME_LIMITER_SLEEP + m_SleepOvershoot) {
+				std::this_thread::sleep_for(FRAME_LIMITER_SLEEP);
+				const clock::time_point woken = clock::now();
+				m_SleepOvershoot = std::max<clock::duration>(woken - now - FRAME_LIMITER_SLEEP, m_SleepOvershoot - m_SleepOvershoot / 16);
+				now = woken;
+			}
+			while (clock::now() < m_NextFrameTime) {
+				std::this_thread::yield();
+			}
+			m_NextFrameTime += period;
+			profiler->End();
+		}
+
+		if (convar_r_late_latch != 0) {
+			UpdateFramesInFlight();
+			WaitForFrameFence();
+		}
+
+		m_InputSampleTime = std::chrono::steady_clock::now();
+	}
+
 	void RenderingServer::Render() {
 		DrawFrame();
 	}
 
-	void RenderingServer::DrawFrame() {
-		vkWaitForFences(m_Device.GetDevice(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+	void RenderingServer::UpdateFramesInFlight() {
+		const uint32_t frames_in_flight = GetFramesInFlightSetting();
+		if (frames_in_flight == m_FramesInFlight) {
+			return;
+		}
+		// The frames are renumbered : none may still be in flight. Idle, every fence is signaled.
+		vkDeviceWaitIdle(m_Device.GetDevice());
+		m_FramesInFlight = frames_in_flight;
+		m_CurrentFrame = 0;
+		m_HasWaitedFrameFence = false;
+	}
 
-		uint32_t image_index = 0;
-		VkResult result = vkAcquireNextImageKHR(m_Device.GetDevice(), m_SwapChain.GetSwapChain(), UINT64_MAX, m_ImageAvaliableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &image_index);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_Window.HasResized()) {
-			m_SwapChain.Recreate(m_Device, &m_Window, m_VertShaderFilePath, m_FragShaderFilePath);
+	void RenderingServer::WaitForFrameFence() {
+		if (m_HasWaitedFrameFence) {
 			return;
 		}
-		else if (result != VK_SUCCESS) {
-			ERR_MSG("Failed to Acquire Swap Chain Image ! Vulkan Error Code : %d", (int) result);
+		Application::Singleton()->Debug()->Profiler()->Begin("Wait For Frame");
+		vkWaitForFences(m_Device.GetDevice(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+		Application::Singleton()->Debug()->Profiler()->End();
+		m_HasWaitedFrameFence = true;
+	}
+
+	void RenderingServer::DrawFrame() {
+		UpdateFramesInFlight();
+		WaitForFrameFence(); // Already waited by WaitForNextFrame() with r_late_latch.
+
+		m_MeshCache.Update(m_SubmittedFrameCount);
+		m_SwapChain.ReleaseModels(m_MeshCache.GetDestroyedModelIds());
+
+		const bool headless = m_SwapChain.IsHeadless();
+
+		uint32_t image_index = 0;
+		VkResult result = VK_SUCCESS;
+		if (headless) {
+			image_index = m_CurrentFrame; // One offscreen target per frame in flight.
+		} else {
+			if (m_SwapChain.IsPresentModeOutdated()) {
+				m_SwapChain.Recreate(m_Device, &m_Window);
+			}
+			result = vkAcquireNextImageKHR(m_Device.GetDevice(), m_SwapChain.GetSwapChain(), UINT64_MAX, m_ImageAvaliableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &image_index);
+			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_Window.HasResized()) {
+				m_SwapChain.Recreate(m_Device, &m_Window);
+				return;
+			}
+			else if (result != VK_SUCCESS) {
+				ERR_MSG("Failed to Acquire Swap Chain Image ! Vulkan Error Code : %d", (int) result);
+			}
 		}
 
 		vkResetFences(m_Device.GetDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
 
 		vkResetCommandBuffer(m_SwapChain.GetCommandBuffer(m_CurrentFrame), 0);
 
+		// Submit the uploads requested since last frame, and find out which are done. Models still uploading are skipped.
+		m_UploadManager.Flush();
+		m_UploadManager.Update();
+
 		#if USE_DEBUG_DRAWING
-		m_SwapChain.UpdateDebugDrawings(m_Device.GetDevice(), m_Device.GetPhysicalDevice(), m_Device.GetGraphicsQueue());
+		// Drawings lasting more than a frame still age while their category is hidden.
+		const uint32_t debug_draw_mask = !ShowDD ? 0 : (ShowDDPoints ? DEBUG_DRAW_POINTS_BIT : 0) | (ShowDDLines ? DEBUG_DRAW_LINES_BIT : 0) | (ShowDDShapes ? DEBUG_DRAW_SHAPES_BIT : 0);
+		m_SwapChain.UpdateDebugDrawings(m_CurrentFrame, debug_draw_mask);
 		#endif
 
-		SceneRenderingData_t scene_data{m_pFirstRenderedEntity, m_LightEntities, m_pCamera};
+		SceneRenderingData_t scene_data{m_pFirstRenderedEntity, m_LightEntities, m_pCamera, m_ObjectIndexCount};
 		m_SwapChain.RecordCommandBuffer(m_CurrentFrame, image_index, scene_data);
+		SubmitRenderStats();
 
 		VkSemaphore wait_semaphores[] = { m_ImageAvaliableSemaphores[m_CurrentFrame]};
 		VkSemaphore signal_semaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame]};
 		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
+		// Headless : nothing to wait for (no acquire) nor to signal (no present). The fence alone paces the frames.
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pWaitSemaphores = wait_semaphores;
 		submitInfo.pWaitDstStageMask = wait_stages;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = m_SwapChain.GetCommandBufferPtr(m_CurrentFrame);
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signal_semaphores;
 
 		vkResetFences(m_Device.GetDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
@@ -176,30 +353,53 @@ namespace gigno {
 		if (result != VK_SUCCESS) {
 			ERR_MSG("Failed to Submit to Graphics Queue ! Vulkan Error Code : %d", (int)result);
 		}
-
-		VkSwapchainKHR swapchains[] = { m_SwapChain.GetSwapChain() };
-
-		VkPresentInfoKHR present_info{};
-		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		present_info.waitSemaphoreCount = 1;
-		present_info.pWaitSemaphores = signal_semaphores;
-		present_info.swapchainCount = 1;
-		present_info.pSwapchains = swapchains;
-		present_info.pImageIndices = &image_index;
-		present_info.pResults = nullptr;
-
-		result = vkQueuePresentKHR(m_Device.GetPresentQueue(), &present_info);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-			m_SwapChain.Recreate(m_Device, &m_Window, m_VertShaderFilePath, m_FragShaderFilePath);
+		m_SubmittedFrameCount++;
+
+		if (!headless) {
+			VkSwapchainKHR swapchains[] = { m_SwapChain.GetSwapChain() };
+
+			VkPresentInfoKHR present_info{};
+			present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+			present_info.waitSemaphoreCount = 1;
+			present_info.pWaitSemaphores = signal_semaphores;
+			present_info.swapchainCount = 1;
+			present_info.pSwapchains = swapchains;
+			present_info.pImageIndices = &image_index;
+			present_info.pResults = nullptr;
+
+			result = vkQueuePresentKHR(m_Device.GetPresentQueue(), &present_info);
+			if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+				m_SwapChain.Recreate(m_Device, &m_Window);
+			}
+			else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+				ERR_MSG("Failed to Present Swap Chain Image ! Vulkan Error Code : %d", (int)result);
+			} 
 		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-			ERR_MSG("Failed to Present Swap Chain Image ! Vulkan Error Code : %d", (int)result);
-		} 
 
-		m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		// From the input sampling to the present request (the submission when headless). The GPU and the presentation engine add to it.
+		const auto input_to_present = std::chrono::steady_clock::now() - m_InputSampleTime;
+		Application::Singleton()->Debug()->Profiler()->SetCounter("CPU To Present (us)", std::chrono::duration_cast<std::chrono::microseconds>(input_to_present).count());
+
+		m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
+		m_HasWaitedFrameFence = false;
 
 	#if USE_IMGUI
 		NewFrameImGui();
 	#endif
 	}
-}
\ No newline at end of file
+
+	void RenderingServer::SubmitRenderStats() {
+		RenderStats_t stats = m_SwapChain.GetFrameStats();
+
+		const uint64_t uploaded_bytes = m_UploadManager.GetUploadedBytes();
+		const GpuMemoryStats_t memory = m_Device.GetAllocator()->GetStats();
+		stats[RENDER_STAT_UPLOADED_BYTES] = uploaded_bytes - m_LastUploadedBytes;
+		stats[RENDER_STAT_ALLOCATIONS] = memory.TotalAllocations - m_LastTotalAllocations;
+		stats[RENDER_STAT_DEVICE_ALLOCATIONS] = memory.TotalDeviceAllocations - m_LastTotalDeviceAllocations;
+		m_LastUploadedBytes = uploaded_bytes;
+		m_LastTotalAllocations = memory.TotalAllocations;
+		m_LastTotalDeviceAllocations = memory.TotalDeviceAllocations;
+
+		m_RenderStats.Submit(stats);
+	}
+}
@@ -3,6 +3,10 @@
 
 #include "window.h"
 #include "device.h"
+#include "upload_manager.h"
+#include "mesh_cache.h"
+#include "debug_drawer.h"
+#include "render_stats.h"
 
 #include "../entities/camera.h"
 
@@ -10,6 +14,7 @@
 #include "glm/glm.hpp"
 
 #include <memory>
+#include <chrono>
 
 #include "../entities/rendered_entity.h"
 
@@ -17,16 +22,23 @@ namespace gigno {
 	class Light;
 	class InputServer;
 
+	enum RenderingMode_t {
+		RENDERING_MODE_WINDOWED,
+		RENDERING_MODE_HEADLESS // No window, surface nor presentation. Frames are rendered to offscreen images (benchmarks, image captures).
+	};
+
 	struct SceneRenderingData_t {
 		const RenderedEntity * RenderedEntities; // First entity in the chain.
 		const std::vector<const Light *> &LightEntities;
 		const Camera *pCamera;
+		uint32_t ObjectCount; // Greater than every rendered entity's ObjectIndex.
 	};
 
 	class RenderingServer {
 
 	public:
-		RenderingServer(int winw, int winh, const char *winTitle, InputServer *inputServer, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath);
+		RenderingServer(int winw, int winh, const char *winTitle, InputServer *inputServer, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath,
+						RenderingMode_t renderingMode = RENDERING_MODE_WINDOWED);
 		~RenderingServer();
 
 		void Finalize();
@@ -34,8 +46,22 @@ namespace gigno {
 		bool WindowShouldClose() { return m_Window.ShouldClose(); }
 		void PollEvents();
 
+		/*
+		@brief Frame pacing, to call right before the frame's input is sampled. With r_fps_max, sleeps then spins until the frame's
+		start time. With r_late_latch, also waits for the GPU to be done with the frame's resources (Render() waits for them otherwise),
+		so that the input is sampled as late as possible before the frame is recorded.
+		*/
+		void WaitForNextFrame();
 		void Render();
 
+		bool IsHeadless() const { return m_SwapChain.IsHeadless(); }
+
+		/*
+		@brief Headless only. Writes the last rendered frame to a binary PPM (P6) file. Waits for the device to be idle.
+		@returns whether the file was written.
+		*/
+		bool CaptureFrame(const char *path);
+
 		void SubscribeRenderedEntity(RenderedEntity *entity);
 		void UnsubscribeRenderedEntity(RenderedEntity *entity);
 
@@ -47,12 +73,33 @@ namespace gigno {
 
 		float GetAspectRatio() { return static_cast<float>(m_SwapChain.GetWidth()) / static_cast<float>(m_SwapChain.GetHeight()); }
 
-		void CreateModel(std::shared_ptr<giModel> &model, const ModelData_t &modelData);
-
-		//Debug Drawing ( need to active USE_DEBUG_DRAWING in features_usage.h )
-		void DrawPoint(glm::vec3 pos, glm::vec3 color, const std::string &uniqueName );
-		void DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 color, const std::string &uniqueName);
-		void DrawLineGradient(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, const std::string &uniqueName);
+		void CreateModel(MeshHandle &model, const ModelData_t &modelData);
+		// Imports the model file on the first request only. Every later request with the same options shares the same giModel.
+		std::shared_ptr<giModel> LoadModel(const std::string &path, const ModelImportOptions_t &options = {}) { return m_MeshCache.Load(path, options); }
+		// As LoadModel(), on the thread pool : the handle is empty until the model is loaded (see MeshCache::Request()).
+		MeshHandle RequestModel(const std::string &path, const ModelImportOptions_t &options = {});
+		MeshCacheStats_t GetMeshCacheStats() const { return m_MeshCache.GetStats(); }
+
+		GpuMemoryStats_t GetGpuMemoryStats() const { return m_Device.GetAllocator()->GetStats(); }
+		const PipelineCacheStats_t &GetPipelineCacheStats() const { return m_Device.GetPipelineCacheStats(); }
+		const SwapChainTimings_t &GetSwapChainTimings() const { return m_SwapChain.GetTimings(); }
+		// Of the last frames drawn (see the 'stats' console command and the debug window's "Render Stats" tab).
+		RenderStatsHistory &GetRenderStats() { return m_RenderStats; }
+
+		//Debug Drawing ( need to active USE_DEBUG_DRAWING in features_usage.h ). 'id' is DEBUG_DRAW_ID, see DebugDrawer.
+		void DrawPoint(glm::vec3 pos, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawLineGradient(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawBox(glm::vec3 center, glm::vec3 halfExtents, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawSphere(glm::vec3 center, float radius, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawFrustum(const glm::mat4 &viewProjection, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawAxes(const glm::mat4 &transform, float size, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawArrow(glm::vec3 start, glm::vec3 end, glm::vec3 color, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		// Batches : a single copy, whatever the count. Build shape instances with DebugBox(), DebugSphere(), DebugFrustum(), DebugAxes() or DebugArrow().
+		void DrawPoints(const Vertex *points, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		// @param vertices two per line.
+		void DrawLines(const Vertex *vertices, uint32_t lineCount, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
+		void DrawShapes(DebugShape_t shape, const DebugShapeInstance_t *instances, uint32_t count, DebugDrawId_t id, const DebugDrawDuration_t &duration = {});
 
 		bool *Fullbright() { return &m_SwapChain.Fullbright; }
 
@@ -60,23 +107,50 @@ namespace gigno {
 		bool ShowDD = true;
 		bool ShowDDPoints = true;
 		bool ShowDDLines = true;
+		bool ShowDDShapes = true;
 		#endif
 
 	private:
 		void CreateSyncObjects();
 
 		void DrawFrame();
+		// Applies r_frames_in_flight. Waits for the device to be idle if it changed.
+		void UpdateFramesInFlight();
+		// Waits for the fence of the current frame, once per frame.
+		void WaitForFrameFence();
+		// Adds what the uploads and the allocator did since the last frame to the stats the frame recorded, and keeps them.
+		void SubmitRenderStats();
 
 		uint32_t m_CurrentFrame = 0;
+		uint32_t m_FramesInFlight = 2; // Never more than MAX_FRAMES_IN_FLIGHT.
+		bool m_HasWaitedFrameFence = false;
+
+		std::chrono::steady_clock::time_point m_NextFrameTime{}; // Of r_fps_max.
+		std::chrono::steady_clock::duration m_SleepOvershoot{};  // Largest recent overshoot of a short sleep : the frame limiter spins that close to its target.
+		std::chrono::steady_clock::time_point m_InputSampleTime{}; // Of the frame being drawn, when WaitForNextFrame() returned.
+		uint64_t m_SubmittedFrameCount = 0;
+
+		RenderStatsHistory m_RenderStats;
+		// Totals when the last frame's stats were submitted.
+		uint64_t m_LastUploadedBytes = 0;
+		uint64_t m_LastTotalAllocations = 0;
+		uint64_t m_LastTotalDeviceAllocations = 0;
 
 		Window m_Window;
 		Device m_Device;
 		SwapChain m_SwapChain;
+		UploadManager m_UploadManager;
+		MeshCache m_MeshCache;
 
 		// First rendered entity in the chain of all rendered entity (linked list). Use entity->pNextRenderedEntity for next element in the list.
 		// If this is null, there are no rendered entity. If next is null, it is the last rendered entity.
 		RenderedEntity *m_pFirstRenderedEntity{};
 
+		// Object indices are stable for an entity's lifetime, so that the object buffers only rewrite the entities that moved.
+		// Index 0 is reserved for the identity object.
+		uint32_t m_ObjectIndexCount = 1;
+		std::vector<uint32_t> m_FreeObjectIndices;
+
 		std::vector<const Light *> m_LightEntities;
 
 		const Camera *m_pCamera = nullptr;
@@ -85,15 +159,8 @@ namespace gigno {
 		std::vector<VkSemaphore> m_RenderFinishedSemaphores;
 		std::vector<VkFence> m_InFlightFences;
 
-		std::string m_VertShaderFilePath;
-		std::string m_FragShaderFilePath;
-
 		float m_RenderTime = 0.0f;
 	};
 
-	#define STRINGIFY1(a) STRINGIFY2(a)
-	#define STRINGIFY2(a) #a
-	#define UNIQUE_NAME STRINGIFY1( __LINE__ ) __FILE__
-
 }
 #endif
\ No newline at end of file
@@ -4,26 +4,22 @@
 
 namespace gigno
 {
-    uint32_t FindMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties mem_prop{};
-        vkGetPhysicalDeviceMemoryProperties(device, &mem_prop);
-
-        for (uint32_t i = 0; i < mem_prop.memoryTypeCount; i++) {
-            if ((typeFilter & (i << i)) && (mem_prop.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
-
-        ERR_MSG_V(UINT32_MAX, "Failed to find suitable memory type !");
-    }
+    void CreateBuffer(MemoryAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer &buffer, GpuAllocation_t &allocation,
+                      AllocationStrategy_t strategy, const std::vector<uint32_t> &queueFamilies) {
+        VkDevice device = allocator->GetDevice();
 
-    void CreateBuffer(VkDevice device, VkPhysicalDevice physDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
         VkBufferCreateInfo createinfo{};
         createinfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         createinfo.pNext = nullptr;
         createinfo.size = size;
         createinfo.usage = usage;
-        createinfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (queueFamilies.size() > 1) {
+            createinfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createinfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            createinfo.pQueueFamilyIndices = queueFamilies.data();
+        } else {
+            createinfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
 
         VkResult result = vkCreateBuffer(device, &createinfo, nullptr, &buffer);
         if (result != VK_SUCCESS) {
@@ -33,18 +29,21 @@ namespace gigno
         VkMemoryRequirements mem_requirement{};
         vkGetBufferMemoryRequirements(device, buffer, &mem_requirement);
 
-        VkMemoryAllocateInfo allocinfo{};
-        allocinfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocinfo.pNext = nullptr;
-        allocinfo.allocationSize = mem_requirement.size;
-        allocinfo.memoryTypeIndex = FindMemoryTypeIndex(physDevice, mem_requirement.memoryTypeBits, props);
-
-        result = vkAllocateMemory(device, &allocinfo, nullptr, &bufferMemory);
-        if (result != VK_SUCCESS) {
-            ERR_MSG("Failed to allocate memory for Buffer ! Vulkan Error Code : %d", (int)result);
+        if (!allocator->Allocate(mem_requirement, props, strategy, allocation)) {
+            vkDestroyBuffer(device, buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+            ERR_MSG("Failed to allocate memory for Buffer !");
         }
 
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        vkBindBufferMemory(device, buffer, allocation.Memory, allocation.Offset);
+    }
+
+    void DestroyBuffer(MemoryAllocator *allocator, VkBuffer &buffer, GpuAllocation_t &allocation) {
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(allocator->GetDevice(), buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+        }
+        allocator->Free(allocation);
     }
 
     void CopyBuffer(VkDevice device, VkBuffer src, VkBuffer dst, VkDeviceSize size, VkCommandPool commandPool, VkQueue queue) {
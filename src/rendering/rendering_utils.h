@@ -2,11 +2,20 @@
 #ifndef RENDERING_UTILS_H
 #define RENDERING_UTILS_H
 #include "vulkan/vulkan.h"
+#include "memory_allocator.h"
+
+#include <vector>
 
 namespace gigno {
-    uint32_t FindMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    
-    void CreateBuffer(VkDevice device, VkPhysicalDevice physDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
+    /*
+    @brief Creates a buffer and binds it to memory sub-allocated from 'allocator'.
+    @param allocation host visible buffers can be written through allocation.pMapped (persistently mapped).
+    @param queueFamilies if it holds more than one family, the buffer is shared concurrently between them (no ownership transfer needed).
+    */
+    void CreateBuffer(MemoryAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkBuffer &buffer, GpuAllocation_t &allocation,
+                      AllocationStrategy_t strategy = ALLOCATION_STRATEGY_TLSF, const std::vector<uint32_t> &queueFamilies = {});
+    // Destroys a buffer created by CreateBuffer() and gives its memory back. Resets both handles.
+    void DestroyBuffer(MemoryAllocator *allocator, VkBuffer &buffer, GpuAllocation_t &allocation);
 
     void CopyBuffer(VkDevice device, VkBuffer src, VkBuffer dst, VkDeviceSize size, VkCommandPool commandPool, VkQueue queue);
 }
@@ -6,6 +6,7 @@
 #include "model.h"
 #include <array>
 #include <cstring>
+#include <chrono>
 
 #include "../application.h"
 
@@ -21,24 +22,52 @@
 #include "../entities/camera.h"
 #include "../entities/lights/light.h"
 #include "rendering_server.h"
+#include "../debug/console/convar.h"
 
 namespace gigno {
 
-	SwapChain::SwapChain(const Device &device, const Window *window, const std::string &vertShaderPath, const std::string &fragShaderPath)
+	Convar<uint32_t> convar_r_gpu_culling = Convar<uint32_t>("r_gpu_culling", "1 = cull and generate the draws with a compute shader, if the device supports it. 0 = always cull and sort on the CPU.", 1);
+	// simple_shader.vert compiled with OCTAHEDRAL_NORMALS defined (see compile_shaders.bat).
+	static const char *COMPACT_VERT_SHADER_PATH = "shaders/simple_shader_compact.vert.spv";
+	// Instanced debug shapes, lit by simple_shader.frag (see DebugDrawer).
+	static const char *DEBUG_SHAPE_VERT_SHADER_PATH = "shaders/debug_shape.vert.spv";
+
+	Convar<uint32_t> convar_r_wireframe = Convar<uint32_t>("r_wireframe", "1 = draw the entities in wireframe, if the device supports it. Shaded normally while the wireframe pipeline compiles.", 0);
+	Convar<uint32_t> convar_r_present_mode = Convar<uint32_t>("r_present_mode", "0 = FIFO (vsync). 1 = MAILBOX (vsync, newest image shown, no queueing). 2 = IMMEDIATE (no vsync, tears : for benchmarks). 3 = FIFO relaxed. Falls back to FIFO if the surface lacks the mode.", 1);
+	Convar<uint32_t> convar_r_lod_error = Convar<uint32_t>("r_lod_error", "Largest simplification error, in pixels, of the level of detail an entity is drawn with. 0 = always draw the full meshes.", 1);
+
+	SwapChain::SwapChain(const Device &device, const Window *window, const std::string &vertShaderPath, const std::string &fragShaderPath) :
+		m_IsHeadless{ device.IsHeadless() },
+		m_pAllocator{ device.GetAllocator() }
 	{
-		CreateVkSwapChain(device.GetDevice(), device.GetPhysicalSwapChainSupport(), device.GetPhysicalDeviceQueueFamilyIndices(), device.GetSurface(), window, true);
+		if (m_IsHeadless) {
+			CreateOffscreenTargets(device.GetDevice(), device.GetPhysicalDevice(), window);
+		} else {
+			CreateVkSwapChain(device.GetDevice(), device.GetPhysicalSwapChainSupport(), device.GetPhysicalDeviceQueueFamilyIndices(), device.GetSurface(), window, true);
+		}
 		CreateImageViews(device.GetDevice());
 		CreateRenderPass(device.GetDevice(), device.GetPhysicalDevice());
 		CreateCommandPool(device.GetDevice(), device.GetPhysicalDeviceQueueFamilyIndices());
 		CreateDepthResources(device.GetDevice(), device.GetPhysicalDevice());
 		CreateDescriptorSetLayout(device.GetDevice());
-		CreateUniformBuffers(device.GetDevice(), device.GetPhysicalDevice());
+		CreateUniformBuffers();
 		CreateDescriptorPool(device.GetDevice());
 		CreateDescriptorSets(device.GetDevice());
+		CreateObjectBuffers();
+		CreateLightBuffers();
 		CreateFrameBuffers(device.GetDevice());
 		CreateCommandBuffers(device.GetDevice());
+
+		const auto pipelines_start = std::chrono::high_resolution_clock::now();
 		CreatePipelineLayout(device.GetDevice());
-		CreatePipeline(device.GetDevice(), vertShaderPath, fragShaderPath);
+		CreatePipelines(device, vertShaderPath, fragShaderPath);
+		m_GpuCuller.Init(device, "shaders/frustum_cull.comp.spv", MAX_FRAMES_IN_FLIGHT);
+		m_GpuProfiler.Init(device, MAX_FRAMES_IN_FLIGHT);
+		m_PipelineStatistics.Init(device, MAX_FRAMES_IN_FLIGHT);
+		m_Timings.PipelineCreationMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - pipelines_start).count();
+		#if USE_DEBUG_DRAWING
+		m_DebugDrawer.Init(m_pAllocator, MAX_FRAMES_IN_FLIGHT);
+		#endif
 	}
 
 	void SwapChain::CleanUp(VkDevice device) {
@@ -50,22 +79,50 @@ namespace gigno {
 		}
 		vkDestroyImageView(device, m_DepthImageView, nullptr);
 		vkDestroyImage(device, m_DepthImage, nullptr);
-		vkFreeMemory(device, m_DepthImageMemory, nullptr);
+		m_pAllocator->Free(m_DepthImageAllocation);
 
+		m_Pipelines.CleanUp(device);
 		vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
 		vkDestroyCommandPool(device, m_CommandPool, nullptr);
-		vkDestroySwapchainKHR(device, m_VkSwapChain, nullptr);
+		for (std::vector<RecordingChunk_t> &chunks : m_RecordingChunks) {
+			for (RecordingChunk_t &chunk : chunks) {
+				vkDestroyCommandPool(device, chunk.Pool, nullptr); // Frees the chunk's buffer.
+			}
+			chunks.clear();
+		}
+		if (m_IsHeadless) {
+			for (size_t i = 0; i < m_Images.size(); i++) {
+				vkDestroyImage(device, m_Images[i], nullptr);
+				m_pAllocator->Free(m_OffscreenImagesAllocations[i]);
+			}
+		} else {
+			vkDestroySwapchainKHR(device, m_VkSwapChain, nullptr);
+		}
 		vkDestroyRenderPass(device, m_RenderPass, nullptr);
 
 		for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			vkDestroyBuffer(device, m_UniformBuffers[i], nullptr);
-			vkFreeMemory(device, m_UniformBuffersMemories[i], nullptr);
+			DestroyBuffer(m_pAllocator, m_UniformBuffers[i], m_UniformBuffersAllocations[i]);
+			DestroyBuffer(m_pAllocator, m_FrameObjects[i].Objects.Buffer, m_FrameObjects[i].Objects.Allocation);
+			DestroyBuffer(m_pAllocator, m_FrameObjects[i].InstanceIndices.Buffer, m_FrameObjects[i].InstanceIndices.Allocation);
+			DestroyBuffer(m_pAllocator, m_FrameLights[i].Lights.Buffer, m_FrameLights[i].Lights.Allocation);
+			DestroyBuffer(m_pAllocator, m_FrameLights[i].Clusters.Buffer, m_FrameLights[i].Clusters.Allocation);
+			DestroyBuffer(m_pAllocator, m_FrameLights[i].LightIndices.Buffer, m_FrameLights[i].LightIndices.Allocation);
 		}
+		#if USE_DEBUG_DRAWING
+		m_DebugDrawer.CleanUp();
+		#endif
+		m_GpuCuller.CleanUp(device);
+		m_GpuProfiler.CleanUp(device);
+		m_PipelineStatistics.CleanUp(device);
 		vkDestroyDescriptorPool(device, m_DescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, nullptr);
 	}
 
-	void SwapChain::Recreate(const Device &device, const Window *window, const std::string &vertShaderPath, const std::string &fragShaderPath) {
+	void SwapChain::Recreate(const Device &device, const Window *window) {
+		if (m_IsHeadless) {
+			return; // Offscreen targets never go out of date.
+		}
+
 		int width = 0, height = 0;
 		window->GetFrameBufferSize(&width, &height);
 		while (width == 0 || height == 0) {
@@ -73,6 +130,7 @@ namespace gigno {
 			glfwWaitEvents();
 		}
 
+		const auto recreate_start = std::chrono::high_resolution_clock::now();
 		vkDeviceWaitIdle(device.GetDevice());
 
 		for (auto imageView : m_ImageViews) {
@@ -84,16 +142,17 @@ namespace gigno {
 
 		vkDestroyImageView(device.GetDevice(), m_DepthImageView, nullptr);
 		vkDestroyImage(device.GetDevice(), m_DepthImage, nullptr);
-		vkFreeMemory(device.GetDevice(), m_DepthImageMemory, nullptr);
-		vkDestroyPipelineLayout(device.GetDevice(), m_PipelineLayout, nullptr);
-		
+		m_pAllocator->Free(m_DepthImageAllocation);
+
+		// Viewport and scissor are dynamic, and the render pass does not change : the pipelines stay valid.
 		CreateVkSwapChain(device.GetDevice(), device.GetPhysicalSwapChainSupport(), device.GetPhysicalDeviceQueueFamilyIndices(), device.GetSurface(), window, false);
 		CreateImageViews(device.GetDevice());
 		CreateDepthResources(device.GetDevice(), device.GetPhysicalDevice());
 		CreateFrameBuffers(device.GetDevice());
-		CreatePipelineLayout(device.GetDevice());
-		m_Pipeline.reset();
-		CreatePipeline(device.GetDevice(), vertShaderPath, fragShaderPath);
+
+		m_Timings.LastRecreateMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recreate_start).count();
+		m_Timings.MaxRecreateMs = std::max(m_Timings.MaxRecreateMs, m_Timings.LastRecreateMs);
+		m_Timings.RecreateCount++;
 	}
 
 	void SwapChain::RecordCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, const SceneRenderingData_t &sceneData) {
@@ -102,6 +161,9 @@ namespace gigno {
 	}
 
 	void SwapChain::RecordCommandBuffer(VkCommandBuffer buffer, uint32_t currentFrame, uint32_t imageIndex, const SceneRenderingData_t &sceneData) {
+		m_Pipelines.SubmitCompilations(Application::Singleton()->GetThreadPool());
+		Application::Singleton()->Debug()->Profiler()->SetCounter("Pipelines Compiling", m_Pipelines.GetPendingCount());
+
 		VkCommandBufferBeginInfo buffer_begin_info{};
 		buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		buffer_begin_info.flags = 0;
@@ -112,6 +174,11 @@ namespace gigno {
 			ERR_MSG("Failed to Begin Command Buffer ! Vulkan Error Code : %d", (int)result);
 		}
 
+		m_GpuProfiler.BeginFrame(buffer, currentFrame);
+		m_GpuProfiler.Begin(buffer, "GPU Frame");
+		m_FrameStats = RenderStats_t{};
+		m_PipelineStatistics.Begin(buffer, currentFrame, m_FrameStats);
+
 		std::array<VkClearValue, 2> clear_vals = {};
 		clear_vals[0].color = {{0.15f, 0.15f, 0.15f, 1.0f}};
 		clear_vals[1].depthStencil = {1.0f, 0};
@@ -125,36 +192,45 @@ namespace gigno {
 		pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_vals.size());
 		pass_begin_info.pClearValues = clear_vals.data();
 
-		vkCmdBeginRenderPass(buffer, &pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(m_Extent.width);
-		viewport.height = static_cast<float>(m_Extent.height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(buffer, 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.extent = m_Extent;
-		scissor.offset = { 0, 0 };
-		vkCmdSetScissor(buffer, 0, 1, &scissor);
+		// Every command of the render pass is in secondary command buffers : entity chunks recorded in parallel, then the overlay.
+		std::vector<VkCommandBuffer> secondary_buffers;
 
 		if (sceneData.pCamera) {
-			UpdateUniformBuffer(buffer, sceneData.pCamera, sceneData.LightEntities, currentFrame);
-			RenderEntities(buffer, sceneData.RenderedEntities, currentFrame);
-			#if USE_DEBUG_DRAWING
-			RenderDebugDrawings(buffer, sceneData.pCamera, currentFrame);
-			#endif
+			UpdateUniformBuffer(sceneData.pCamera, sceneData.LightEntities, currentFrame);
+			UpdateObjectBuffers(buffer, sceneData.RenderedEntities, sceneData.pCamera, sceneData.ObjectCount, currentFrame);
+
+			RecordEntities(currentFrame, imageIndex, secondary_buffers);
 		}
 
+		// Begun here, before the overlay is recorded, so that the overlay's scopes are its children.
+		m_GpuProfiler.Begin(buffer, "Render Pass");
 
+		VkCommandBuffer overlay = m_OverlayCommandBuffers[currentFrame];
+		BeginSecondaryCommandBuffer(overlay, imageIndex);
+		#if USE_DEBUG_DRAWING
+		if (sceneData.pCamera) {
+			m_GpuProfiler.Begin(overlay, "Debug Drawings");
+			vkCmdBindDescriptorSets(overlay, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 0, nullptr);
+			m_FrameStats[RENDER_STAT_DESCRIPTOR_BINDS]++;
+			RenderDebugDrawings(overlay, sceneData.pCamera, currentFrame);
+			m_GpuProfiler.End(overlay);
+		}
+		#endif
 		#if USE_IMGUI
-		RenderImGui(buffer);
+		m_GpuProfiler.Begin(overlay, "ImGui");
+		RenderImGui(overlay, m_FrameStats);
+		m_GpuProfiler.End(overlay);
 		#endif
+		vkEndCommandBuffer(overlay);
+		secondary_buffers.push_back(overlay);
 
+		vkCmdBeginRenderPass(buffer, &pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(buffer, static_cast<uint32_t>(secondary_buffers.size()), secondary_buffers.data());
 		vkCmdEndRenderPass(buffer);
+		m_GpuProfiler.End(buffer); // Render Pass.
+
+		m_PipelineStatistics.End(buffer);
+		m_GpuProfiler.End(buffer); // GPU Frame.
 
 		result = vkEndCommandBuffer(buffer);
 		if (result != VK_SUCCESS) {
@@ -162,174 +238,418 @@ namespace gigno {
 		}
 	}
 
-	void SwapChain::RenderEntities(VkCommandBuffer buffer, const RenderedEntity * entities, uint32_t currentFrame) {
-		vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+	void SwapChain::UpdateObjectBuffers(VkCommandBuffer buffer, const RenderedEntity *entities, const Camera *camera, uint32_t objectCount, uint32_t currentFrame) {
+		FrameObjects_t &frame = m_FrameObjects[currentFrame];
+		m_UseGpuCulling = m_GpuCuller.IsUsable() && convar_r_gpu_culling != 0;
+		const uint32_t variant = convar_r_wireframe != 0 ? 1 : 0;
+		for (uint32_t format = 0; format < VERTEX_FORMAT_MAX_ENUM; format++) {
+			m_FramePipelineIds[format] = m_EntityPipelineIds[format][variant];
+			m_FramePipelines[format] = m_Pipelines.Get(m_FramePipelineIds[format]);
+		}
 
-		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline.get()->GetVkPipeline());
+		m_ResidentEntities.clear();
+		for (const RenderedEntity *curr = entities; curr; curr = curr->pNextRenderedEntity) {
+			if (curr->pModel.IsResident()) {
+				ASSERT(curr->ObjectIndex != 0 && curr->ObjectIndex < objectCount);
+				m_ResidentEntities.push_back(curr);
+			}
+		}
 
-		const RenderedEntity *curr = entities;
-		while(curr) {
-			PushConstantData_t push{};
-			push.modelMatrix = curr->Transform.TransformationMatrix();
-			push.normalsMatrix = glm::mat4{curr->Transform.NormalMatrix()};
-			push.fullbright = Fullbright;
-			vkCmdPushConstants(buffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData_t), &push);
+		ThreadPool *pool = Application::Singleton()->GetThreadPool();
+		ProfilingServer *profiler = Application::Singleton()->Debug()->Profiler();
+		const glm::mat4 view = camera->GetViewMatrix();
+		const glm::mat4 projection = camera->GetProjection();
+
+		profiler->Begin("LOD Selection");
+		m_Culler.UpdateBounds(m_ResidentEntities, objectCount, pool);
+		m_LodSelector.Select(view, projection, m_Extent.height, static_cast<float>(convar_r_lod_error), m_ResidentEntities, objectCount, m_Culler, pool);
+		profiler->End();
+		profiler->SetCounter("Reduced LOD Entities", m_LodSelector.GetReducedCount());
+
+		const Frustum_t frustum = Frustum_t::FromViewProjection(projection * view);
+		if (!m_UseGpuCulling) {
+			profiler->Begin("Frustum Culling");
+			m_Culler.Cull(frustum, pool);
+			profiler->End();
+		}
 
-			curr->pModel->Bind(buffer);
-			curr->pModel->Draw(buffer);
+		ReserveStorageBuffer(currentFrame, 1, frame.Objects, sizeof(ObjectData_t) * objectCount);
+		if (frame.Written.size() < objectCount) {
+			frame.Written.resize(objectCount);
+		}
+		if (frame.Fullbright != Fullbright) {
+			for (WrittenObject_t &written : frame.Written) {
+				written.IsValid = false;
+			}
+			frame.Fullbright = Fullbright;
+		}
+
+		m_RenderQueue.Clear();
+
+		if (m_UseGpuCulling) {
+			// The GPU decides what is visible : every resident object must be up to date.
+			for (const RenderedEntity *curr : m_ResidentEntities) {
+				WriteObject(frame, curr);
+			}
 
-			curr = curr->pNextRenderedEntity;
+			const uint32_t instance_count = m_GpuCuller.Prepare(currentFrame, m_ResidentEntities, m_LodSelector, objectCount, 1);
+			ReserveStorageBuffer(currentFrame, 2, frame.InstanceIndices, sizeof(uint32_t) * instance_count);
+			m_GpuProfiler.Begin(buffer, "GPU Culling");
+			m_GpuCuller.Dispatch(buffer, currentFrame, frustum, frame.Objects.Buffer, frame.InstanceIndices.Buffer, m_FrameStats);
+			m_GpuProfiler.End(buffer);
+
+			// Counted by the GPU a few frames ago : entities may have been removed since.
+			const int64_t visible_count = std::min<int64_t>(m_GpuCuller.GetLastVisibleCount(), m_ResidentEntities.size());
+			profiler->SetCounter("Visible Entities", visible_count);
+			profiler->SetCounter("Culled Entities", static_cast<int64_t>(m_ResidentEntities.size()) - visible_count);
+			return;
 		}
-	}
 
-	
-	#if USE_DEBUG_DRAWING
-	void SwapChain::UpdateDebugDrawings(VkDevice device, VkPhysicalDevice physDevice, VkQueue graphicsQueue) {
-		// Recreate Buffers.
-		//Points
-		if(m_DDPoints.size() > 0 && m_DDCurrentFramePointsDrawCallHash != m_DDLastFramePointsDrawCallHash) {
+		// View space depth is along +z (see Camera::GetViewMatrix()).
+		const glm::vec4 view_depth_row{ view[0][2], view[1][2], view[2][2], view[3][2] };
 
-			VkDeviceSize buffer_size = sizeof(m_DDPoints[0]) * m_DDPoints.size();
+		// Single pass over the visible entities : rewrite the objects that moved since this frame's buffer was last used, and queue their draw.
+		for (const RenderedEntity *curr : m_ResidentEntities) {
+			if (!m_Culler.IsVisible(curr->ObjectIndex)) {
+				continue;
+			}
+			const VertexFormat_t format = curr->pModel->GetVertexFormat();
+			if (m_FramePipelines[format] == VK_NULL_HANDLE) {
+				continue; // Its pipeline is still compiling.
+			}
 
-			VkBuffer staging_buffer;
-			VkDeviceMemory staging_buffer_memory;
+			WriteObject(frame, curr);
 
-			CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-						 staging_buffer, staging_buffer_memory);
+			const float view_depth = glm::dot(view_depth_row, glm::vec4{ m_Culler.GetWorldCenter(curr->ObjectIndex), 1.0f });
+			m_RenderQueue.Add(m_FramePipelineIds[format], curr->pModel.Get(), m_LodSelector.GetLod(curr->ObjectIndex), curr->ObjectIndex, view_depth);
+		}
+
+		profiler->SetCounter("Visible Entities", m_RenderQueue.GetSize());
+		profiler->SetCounter("Culled Entities", static_cast<int64_t>(m_ResidentEntities.size() - m_RenderQueue.GetSize()));
 
-			void *data;
-			vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-			memcpy(data, m_DDPoints.data(), (size_t)buffer_size);
-			vkUnmapMemory(device, staging_buffer_memory);
+		// Instance 0 is the identity object : the queue's instances start at 1.
+		ReserveStorageBuffer(currentFrame, 2, frame.InstanceIndices, sizeof(uint32_t) * (m_RenderQueue.GetSize() + 1));
+		m_RenderQueue.Build(static_cast<uint32_t *>(frame.InstanceIndices.Allocation.pMapped), 1);
+		m_FrameStats[RENDER_STAT_MAPPED_BYTES] += sizeof(uint32_t) * m_RenderQueue.GetSize();
+	}
+
+	void SwapChain::WriteObject(FrameObjects_t &frame, const RenderedEntity *entity) {
+		WrittenObject_t &written = frame.Written[entity->ObjectIndex];
+		if (written.IsValid && written.Transform == entity->Transform && written.ModelId == entity->pModel->GetId()) {
+			return;
+		}
 
-			CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-						 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DDPointsBuffer, m_DDPointsMemory);
+		ObjectData_t &object = static_cast<ObjectData_t *>(frame.Objects.Allocation.pMapped)[entity->ObjectIndex];
+		object.ModelMatrix = entity->Transform.TransformationMatrix();
+		object.NormalMatrix = glm::mat4{ entity->Transform.NormalMatrix() };
+		object.PositionOffset = entity->pModel->GetPositionOffset();
+		object.PositionScale = entity->pModel->GetPositionScale();
+		object.Flags = Fullbright ? OBJECT_FLAG_FULLBRIGHT_BIT : 0;
+
+		written.Transform = entity->Transform;
+		written.ModelId = entity->pModel->GetId();
+		written.IsValid = true;
+		m_FrameStats[RENDER_STAT_MAPPED_BYTES] += sizeof(ObjectData_t);
+	}
 
-			CopyBuffer(device, staging_buffer, m_DDPointsBuffer, buffer_size, m_CommandPool, graphicsQueue);
+	void SwapChain::RecordEntities(uint32_t currentFrame, uint32_t imageIndex, std::vector<VkCommandBuffer> &secondaryBuffers) {
+		ProfilingServer *profiler = Application::Singleton()->Debug()->Profiler();
 
-			vkDestroyBuffer(device, staging_buffer, nullptr);
-			vkFreeMemory(device, staging_buffer_memory, nullptr);
+		if (m_UseGpuCulling) {
+			// One draw per mesh : not worth more than one chunk.
+			if (!ReserveRecordingChunks(currentFrame, 1)) {
+				return;
+			}
+			RecordingChunk_t &chunk = m_RecordingChunks[currentFrame][0];
+			BeginEntityChunk(chunk, currentFrame, imageIndex);
+			m_GpuCuller.RecordDraws(chunk.Buffer, currentFrame, m_FramePipelines, chunk.Stats);
+			EndEntityChunk(chunk);
+			secondaryBuffers.push_back(chunk.Buffer);
+			m_FrameStats.Add(chunk.Stats);
+
+			profiler->SetCounter("Recording Chunks", 1);
+			return;
 		}
-		m_DDPointsCount = m_DDPoints.size();
-		m_DDPoints.clear();
-		m_DDPoints.reserve(m_DDPointsCount);
-		m_DDLastFramePointsDrawCallHash = m_DDCurrentFramePointsDrawCallHash;
-		m_DDCurrentFramePointsDrawCallHash = 0;
-		// Lines
-		if(m_DDLines.size() > 0 && m_DDCurrentFrameLinesDrawCallHash != m_DDLastFrameLinesDrawCallHash) {
 
-			VkDeviceSize buffer_size = sizeof(m_DDLines[0]) * m_DDLines.size();
+		const uint32_t draw_count = static_cast<uint32_t>(m_RenderQueue.GetDraws().size());
+		if (draw_count == 0) {
+			profiler->SetCounter("Recording Chunks", 0);
+			return;
+		}
 
-			VkBuffer staging_buffer;
-			VkDeviceMemory staging_buffer_memory;
+		// One chunk per thread, unless there are too few draws for the extra secondary buffers to pay off.
+		ThreadPool *pool = Application::Singleton()->GetThreadPool();
+		const uint32_t chunk_count = std::min(pool->GetConcurrency(), (draw_count + MIN_DRAWS_PER_RECORDING_CHUNK - 1) / MIN_DRAWS_PER_RECORDING_CHUNK);
+		const uint32_t draws_per_chunk = (draw_count + chunk_count - 1) / chunk_count;
 
-			CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-						 staging_buffer, staging_buffer_memory);
+		if (!ReserveRecordingChunks(currentFrame, chunk_count)) {
+			return;
+		}
+		std::vector<RecordingChunk_t> &chunks = m_RecordingChunks[currentFrame];
 
-			void *data;
-			vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-			memcpy(data, m_DDLines.data(), (size_t)buffer_size);
-			vkUnmapMemory(device, staging_buffer_memory);
+		profiler->Begin("Command Recording");
+		pool->ParallelFor(chunk_count, 1, [this, &chunks, currentFrame, imageIndex, draws_per_chunk, draw_count](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				RecordEntityChunk(chunks[i], currentFrame, imageIndex, i * draws_per_chunk, std::min((i + 1) * draws_per_chunk, draw_count));
+			}
+		});
+		profiler->End();
 
-			CreateBuffer(device, physDevice, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-						 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DDLinesBuffer, m_DDLinesMemory);
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			m_FrameStats.Add(chunks[i].Stats);
+			secondaryBuffers.push_back(chunks[i].Buffer);
+		}
+		profiler->SetCounter("Recording Chunks", chunk_count);
+	}
+
+	bool SwapChain::ReserveRecordingChunks(uint32_t currentFrame, uint32_t count) {
+		std::vector<RecordingChunk_t> &chunks = m_RecordingChunks[currentFrame];
+		while (chunks.size() < count) {
+			RecordingChunk_t chunk{};
+
+			VkCommandPoolCreateInfo poolinfo{};
+			poolinfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolinfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolinfo.queueFamilyIndex = m_GraphicsQueueFamily;
+			VkResult result = vkCreateCommandPool(m_pAllocator->GetDevice(), &poolinfo, nullptr, &chunk.Pool);
+			if (result != VK_SUCCESS) {
+				ERR_MSG_V(false, "Failed to create Recording Command Pool ! Vulkan Error Code : %d", (int)result);
+			}
 
-			CopyBuffer(device, staging_buffer, m_DDLinesBuffer, buffer_size, m_CommandPool, graphicsQueue);
+			VkCommandBufferAllocateInfo allocinfo{};
+			allocinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocinfo.commandPool = chunk.Pool;
+			allocinfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocinfo.commandBufferCount = 1;
+			result = vkAllocateCommandBuffers(m_pAllocator->GetDevice(), &allocinfo, &chunk.Buffer);
+			if (result != VK_SUCCESS) {
+				vkDestroyCommandPool(m_pAllocator->GetDevice(), chunk.Pool, nullptr);
+				ERR_MSG_V(false, "Failed to allocate Recording Command Buffer ! Vulkan Error Code : %d", (int)result);
+			}
 
-			vkDestroyBuffer(device, staging_buffer, nullptr);
-			vkFreeMemory(device, staging_buffer_memory, nullptr);
+			chunks.push_back(chunk);
 		}
-		m_DDLinesCount = m_DDLines.size();
-		m_DDLines.clear();
-		m_DDLines.reserve(m_DDLinesCount);
-		m_DDLastFrameLinesDrawCallHash = m_DDCurrentFrameLinesDrawCallHash;
-		m_DDCurrentFrameLinesDrawCallHash = 0;
+		return true;
 	}
 
-	void SwapChain::DrawPoint(glm::vec3 position, glm::vec3 color, uint32_t drawCallHash) {
-		m_DDCurrentFramePointsDrawCallHash += drawCallHash;
-		m_DDPoints.emplace_back(position, color);
+	void SwapChain::BeginEntityChunk(RecordingChunk_t &chunk, uint32_t currentFrame, uint32_t imageIndex) {
+		// The frame's fence was waited : nothing from the pool is in use.
+		vkResetCommandPool(m_pAllocator->GetDevice(), chunk.Pool, 0);
+
+		BeginSecondaryCommandBuffer(chunk.Buffer, imageIndex);
+
+		// Secondary command buffers inherit no state from the primary.
+		vkCmdSetPrimitiveTopology(chunk.Buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+		vkCmdBindDescriptorSets(chunk.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 0, nullptr);
+		chunk.Stats = RenderStats_t{};
+		chunk.Stats[RENDER_STAT_DESCRIPTOR_BINDS]++;
 	}
 
-	void SwapChain::DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, uint32_t drawCallHash) {
-		m_DDCurrentFrameLinesDrawCallHash += drawCallHash;
-		m_DDLines.emplace_back(startPos, startColor);
-		m_DDLines.emplace_back(endPos, endColor);
+	void SwapChain::EndEntityChunk(RecordingChunk_t &chunk) {
+		VkResult result = vkEndCommandBuffer(chunk.Buffer);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to end Recording Command Buffer ! Vulkan Error Code : %d", (int)result);
+		}
 	}
-	
-	void SwapChain::RenderDebugDrawings(VkCommandBuffer buffer, const Camera *camera, uint32_t currentFrame) {
-		PushConstantData_t push{};
-		push.modelMatrix = {1.0f};
-		push.normalsMatrix = {1.0f};
-		push.fullbright = true;
-		vkCmdPushConstants(buffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData_t), &push);
 
-		VkDeviceSize offset = 0;
-		
-		if(m_DDPointsCount > 0) {
-			vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_POINT_LIST);
-			vkCmdBindVertexBuffers(buffer, 0, 1, &m_DDPointsBuffer, &offset);
-			vkCmdDraw(buffer, m_DDPointsCount, 1, 0, 0);
+	void SwapChain::RecordEntityChunk(RecordingChunk_t &chunk, uint32_t currentFrame, uint32_t imageIndex, uint32_t firstDraw, uint32_t endDraw) {
+		BeginEntityChunk(chunk, currentFrame, imageIndex);
+		VkCommandBuffer buffer = chunk.Buffer;
+
+		// The queue is sorted by pipeline then mesh : only bind what changed from the previous draw. Levels of detail share their mesh's buffers.
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		const giModel *bound_model = nullptr;
+		const std::vector<RenderDraw_t> &draws = m_RenderQueue.GetDraws();
+		for (uint32_t i = firstDraw; i < endDraw; i++) {
+			const RenderDraw_t &draw = draws[i];
+			// Compared by handle : a variant still compiling binds the same pipeline as the fallback.
+			VkPipeline pipeline = m_Pipelines.Get(draw.PipelineId);
+			if (pipeline != bound_pipeline) {
+				vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				bound_pipeline = pipeline;
+				chunk.Stats[RENDER_STAT_PIPELINE_BINDS]++;
+			}
+			if (draw.pModel != bound_model) {
+				draw.pModel->Bind(buffer);
+				bound_model = draw.pModel;
+				chunk.Stats[RENDER_STAT_BUFFER_BINDS] += 2; // Vertex and index buffers.
+			}
+			draw.pModel->Draw(buffer, draw.InstanceCount, draw.FirstInstance, draw.Lod);
+			chunk.Stats.CountDraw(draw.InstanceCount, draw.pModel->GetLod(draw.Lod).IndexCount / 3);
 		}
 
-		if(m_DDLinesCount > 0) {
-		vkCmdSetPrimitiveTopology(buffer, VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
-		vkCmdBindVertexBuffers(buffer, 0, 1, &m_DDLinesBuffer, &offset);
-		vkCmdDraw(buffer, m_DDLinesCount, 1, 0, 0);
+		EndEntityChunk(chunk);
+	}
+
+	void SwapChain::BeginSecondaryCommandBuffer(VkCommandBuffer buffer, uint32_t imageIndex) {
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = m_RenderPass;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = m_FrameBuffers[imageIndex];
+		// The frame's pipeline statistics query stays active while the secondary buffers execute.
+		inheritance.pipelineStatistics = m_PipelineStatistics.GetInheritedFlags();
+
+		VkCommandBufferBeginInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		info.pInheritanceInfo = &inheritance;
+
+		VkResult result = vkBeginCommandBuffer(buffer, &info);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to Begin Secondary Command Buffer ! Vulkan Error Code : %d", (int)result);
 		}
+
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(m_Extent.width);
+		viewport.height = static_cast<float>(m_Extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(buffer, 0, 1, &viewport);
+
+		VkRect2D scissor{};
+		scissor.extent = m_Extent;
+		scissor.offset = { 0, 0 };
+		vkCmdSetScissor(buffer, 0, 1, &scissor);
+	}
+
+	
+	#if USE_DEBUG_DRAWING
+	void SwapChain::RenderDebugDrawings(VkCommandBuffer buffer, const Camera *camera, uint32_t currentFrame) {
+		m_DebugDrawer.Record(buffer, currentFrame, m_Pipelines.Get(m_OverlayPipelineId), m_Pipelines.Get(m_DebugShapePipelineId), m_FrameStats);
 	}
 	#endif
 
-	void SwapChain::UpdateUniformBuffer(VkCommandBuffer commandBuffer, const Camera *camera, const std::vector<const Light *> &lights, uint32_t currentFrame)
+	void SwapChain::UpdateUniformBuffer(const Camera *camera, const std::vector<const Light *> &lights, uint32_t currentFrame)
 	{
 		ASSERT(currentFrame < MAX_FRAMES_IN_FLIGHT);
 
 		const glm::mat4 proj = camera->GetProjection();
 		const glm::mat4 view = camera->GetViewMatrix();
 
+		Application::Singleton()->Debug()->Profiler()->Begin("Light Clustering");
+		m_LightClusterer.Build(view, proj, camera->GetNear(), camera->GetFar(), m_Extent.width, m_Extent.height, lights, Application::Singleton()->GetThreadPool());
+		Application::Singleton()->Debug()->Profiler()->End();
+
+		const std::vector<LightData_t> &light_datas = m_LightClusterer.GetLights();
+		const std::vector<ClusterRange_t> &clusters = m_LightClusterer.GetClusters();
+		const std::vector<uint32_t> &light_indices = m_LightClusterer.GetLightIndices();
+		FrameLights_t &frame = m_FrameLights[currentFrame];
+		ReserveStorageBuffer(currentFrame, 3, frame.Lights, sizeof(LightData_t) * light_datas.size());
+		ReserveStorageBuffer(currentFrame, 4, frame.Clusters, sizeof(ClusterRange_t) * clusters.size());
+		ReserveStorageBuffer(currentFrame, 5, frame.LightIndices, sizeof(uint32_t) * light_indices.size());
+		if (!light_datas.empty()) {
+			std::memcpy(frame.Lights.Allocation.pMapped, light_datas.data(), sizeof(LightData_t) * light_datas.size());
+		}
+		std::memcpy(frame.Clusters.Allocation.pMapped, clusters.data(), sizeof(ClusterRange_t) * clusters.size());
+		if (!light_indices.empty()) {
+			std::memcpy(frame.LightIndices.Allocation.pMapped, light_indices.data(), sizeof(uint32_t) * light_indices.size());
+		}
+
+		Application::Singleton()->Debug()->Profiler()->SetCounter("Lights", static_cast<int64_t>(light_datas.size()));
+		Application::Singleton()->Debug()->Profiler()->SetCounter("Cluster Light Entries", static_cast<int64_t>(light_indices.size()));
+
 		UniformBufferData_t ub{};
 		ub.projection = proj;
 		ub.view = view;
+		ub.clusterDepthParams = m_LightClusterer.GetDepthParams();
+		ub.clusterScreenParams = m_LightClusterer.GetScreenParams();
+		ub.lightCounts = glm::uvec4{ m_LightClusterer.GetGlobalLightCount(), static_cast<uint32_t>(light_datas.size()), 0, 0 };
 
-		uint32_t i = 0;
-		for(const Light *light : lights) {
-			const uint32_t advance = light->DataSlotsCount();
-			if(i + advance > MAX_LIGHT_DATA_COUNT) {
-				break;
-			}
-			light->FillDataSlots(&ub.lightDatas[i]);
-			i += advance;
-		}
-
-		std::memcpy(m_UniformBuffersMapped[currentFrame], &ub, sizeof(ub));
-
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 0, nullptr);
+		std::memcpy(m_UniformBuffersAllocations[currentFrame].pMapped, &ub, sizeof(ub));
+		m_FrameStats[RENDER_STAT_MAPPED_BYTES] += sizeof(LightData_t) * light_datas.size() + sizeof(ClusterRange_t) * clusters.size() +
+												  sizeof(uint32_t) * light_indices.size() + sizeof(ub);
 	}
 
-	void SwapChain::CreateUniformBuffers(VkDevice device, VkPhysicalDevice physDevice) {
+	void SwapChain::CreateUniformBuffers() {
 		VkDeviceSize size = sizeof(UniformBufferData_t);
 
 		m_UniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-		m_UniformBuffersMemories.resize(MAX_FRAMES_IN_FLIGHT);
-		m_UniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+		m_UniformBuffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
 
 		for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			CreateBuffer(device, physDevice, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-									m_UniformBuffers[i], m_UniformBuffersMemories[i]);
-			vkMapMemory(device, m_UniformBuffersMemories[i], 0, size, 0, &m_UniformBuffersMapped[i]);
+			CreateBuffer(m_pAllocator, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
+									m_UniformBuffers[i], m_UniformBuffersAllocations[i]);
 		}
 	}
 
+	void SwapChain::CreateObjectBuffers() {
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			FrameObjects_t &frame = m_FrameObjects[i];
+			ReserveStorageBuffer(i, 1, frame.Objects, sizeof(ObjectData_t));
+			ReserveStorageBuffer(i, 2, frame.InstanceIndices, sizeof(uint32_t));
+
+			ObjectData_t identity{};
+			identity.Flags = OBJECT_FLAG_FULLBRIGHT_BIT;
+			std::memcpy(frame.Objects.Allocation.pMapped, &identity, sizeof(identity));
+			static_cast<uint32_t *>(frame.InstanceIndices.Allocation.pMapped)[0] = 0;
+		}
+	}
+
+	void SwapChain::CreateLightBuffers() {
+		// Bound even without any light : every cluster starts empty.
+		const std::vector<ClusterRange_t> empty_clusters(CLUSTER_COUNT);
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			FrameLights_t &frame = m_FrameLights[i];
+			ReserveStorageBuffer(i, 3, frame.Lights, sizeof(LightData_t));
+			ReserveStorageBuffer(i, 4, frame.Clusters, sizeof(ClusterRange_t) * CLUSTER_COUNT);
+			ReserveStorageBuffer(i, 5, frame.LightIndices, sizeof(uint32_t));
+			std::memcpy(frame.Clusters.Allocation.pMapped, empty_clusters.data(), sizeof(ClusterRange_t) * CLUSTER_COUNT);
+		}
+	}
+
+	void SwapChain::ReserveStorageBuffer(uint32_t currentFrame, uint32_t binding, FrameStorageBuffer_t &storage, VkDeviceSize size) {
+		if (size <= storage.Capacity) {
+			return;
+		}
+
+		// Grow geometrically so that a slowly growing scene does not reallocate every frame.
+		VkDeviceSize capacity = std::max<VkDeviceSize>(storage.Capacity * 2, 4096);
+		while (capacity < size) {
+			capacity *= 2;
+		}
+
+		FrameStorageBuffer_t grown{};
+		grown.Capacity = capacity;
+		CreateBuffer(m_pAllocator, capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					 grown.Buffer, grown.Allocation);
+		if (storage.Buffer != VK_NULL_HANDLE) {
+			std::memcpy(grown.Allocation.pMapped, storage.Allocation.pMapped, (size_t)storage.Capacity);
+			DestroyBuffer(m_pAllocator, storage.Buffer, storage.Allocation);
+		}
+		storage = grown;
+
+		VkDescriptorBufferInfo info{};
+		info.buffer = storage.Buffer;
+		info.offset = 0;
+		info.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet descWrite{};
+		descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descWrite.dstSet = m_DescriptorSets[currentFrame];
+		descWrite.dstBinding = binding;
+		descWrite.dstArrayElement = 0;
+		descWrite.descriptorCount = 1;
+		descWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descWrite.pBufferInfo = &info;
+
+		vkUpdateDescriptorSets(m_pAllocator->GetDevice(), 1, &descWrite, 0, nullptr);
+	}
+
 	void SwapChain::CreateDescriptorPool(VkDevice device) {
-		VkDescriptorPoolSize size{};
-		size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		size.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+		std::array<VkDescriptorPoolSize, 2> sizes{};
+		sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		sizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+		sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		sizes[1].descriptorCount = 5 * MAX_FRAMES_IN_FLIGHT; // Objects, instance indices, lights, clusters and cluster light indices.
 
 		VkDescriptorPoolCreateInfo createinfo{};
 		createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		createinfo.maxSets = MAX_FRAMES_IN_FLIGHT;
-		createinfo.poolSizeCount = 1;
-		createinfo.pPoolSizes = &size;
+		createinfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+		createinfo.pPoolSizes = sizes.data();
 
 		VkResult result = vkCreateDescriptorPool(device, &createinfo, nullptr, &m_DescriptorPool);
 		if(result != VK_SUCCESS) {
@@ -371,18 +691,35 @@ namespace gigno {
 	}
 
 	void SwapChain::CreateDescriptorSetLayout(VkDevice device) {
-		VkDescriptorSetLayoutBinding ubo_layout_binding{};
-		ubo_layout_binding.binding = 0;
-		ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		ubo_layout_binding.descriptorCount = 1;
-		ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		// Objects.
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		// Instance indices.
+		bindings[2].binding = 2;
+		bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[2].descriptorCount = 1;
+		bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		// Lights, clusters and cluster light indices : shading is per fragment.
+		for (uint32_t i = 3; i < 6; i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
 
 		VkDescriptorSetLayoutCreateInfo createinfo{};
 		createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		createinfo.pNext = nullptr;
 		createinfo.flags = 0;
-		createinfo.bindingCount = 1;
-		createinfo.pBindings = &ubo_layout_binding;
+		createinfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		createinfo.pBindings = bindings.data();
 
 		VkResult result = vkCreateDescriptorSetLayout(device, &createinfo, nullptr, &m_DescriptorSetLayout);
 		if(result != VK_SUCCESS) {
@@ -391,18 +728,13 @@ namespace gigno {
 	}
 
 	void SwapChain::CreatePipelineLayout(VkDevice device) {
-		VkPushConstantRange push_constant_range{};
-		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		push_constant_range.offset = 0;
-		push_constant_range.size = sizeof(PushConstantData_t);
-
 		VkPipelineLayoutCreateInfo createinfo;
 		createinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		createinfo.pNext = nullptr;
 		createinfo.setLayoutCount = 1;
 		createinfo.pSetLayouts = &m_DescriptorSetLayout;
-		createinfo.pushConstantRangeCount = 1;
-		createinfo.pPushConstantRanges = &push_constant_range;
+		createinfo.pushConstantRangeCount = 0; // Per-Entity data is in the object buffer.
+		createinfo.pPushConstantRanges = nullptr;
 
 		VkResult result = vkCreatePipelineLayout(device, &createinfo, nullptr, &m_PipelineLayout);
 		if (result != VK_SUCCESS) {
@@ -410,17 +742,44 @@ namespace gigno {
 		}
 	}
 
-	void SwapChain::CreatePipeline(VkDevice device, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath) {
-		giPipelineConfigInfo info{};
-		giPipeline::DefaultConfig(info);
-		info.renderPass = m_RenderPass;
-		info.pipelineLayout = m_PipelineLayout;
-		m_Pipeline = std::make_unique<giPipeline>(device, vertShaderFilePath, fragShaderFilePath, info);
+	void SwapChain::CreatePipelines(const Device &device, const std::string &vertShaderFilePath, const std::string &fragShaderFilePath) {
+		PipelineDesc_t opaque{};
+		opaque.VertShaderPath = vertShaderFilePath;
+		opaque.FragShaderPath = fragShaderFilePath;
+		m_Pipelines.Init(device, m_RenderPass, m_PipelineLayout, opaque);
+		ASSERT(PipelineRegistry::FALLBACK_PIPELINE_ID == OPAQUE_PIPELINE_ID);
+
+		// Variants : compiled in the background once the thread pool runs. Meshes of the compact formats wait for theirs.
+		const std::string vert_shader_paths[VERTEX_FORMAT_MAX_ENUM] = { vertShaderFilePath, COMPACT_VERT_SHADER_PATH, COMPACT_VERT_SHADER_PATH };
+		for (uint32_t format = 0; format < VERTEX_FORMAT_MAX_ENUM; format++) {
+			PipelineDesc_t desc = opaque;
+			desc.VertexFormat = static_cast<VertexFormat_t>(format);
+			desc.VertShaderPath = vert_shader_paths[format];
+			const PipelineId_t opaque_id = m_Pipelines.Request(desc, PipelineRegistry::INVALID_PIPELINE_ID); // OPAQUE_PIPELINE_ID for VERTEX_FORMAT_FLOAT.
+
+			desc.PolygonMode = VK_POLYGON_MODE_LINE;
+			m_EntityPipelineIds[format][0] = opaque_id;
+			m_EntityPipelineIds[format][1] = m_Pipelines.Request(desc, opaque_id);
+		}
+
+		// Debug drawings are tested against the scene, but must not hide each other.
+		PipelineDesc_t overlay = opaque;
+		overlay.DepthWrite = false;
+		m_OverlayPipelineId = m_Pipelines.Request(overlay);
+
+		#if USE_DEBUG_DRAWING
+		// Takes the shape instances on top of the vertices : no fallback, shapes wait for it.
+		PipelineDesc_t shapes = overlay;
+		shapes.VertShaderPath = DEBUG_SHAPE_VERT_SHADER_PATH;
+		shapes.DebugShapeInstances = true;
+		m_DebugShapePipelineId = m_Pipelines.Request(shapes, PipelineRegistry::INVALID_PIPELINE_ID);
+		#endif
 	}
 
 	void SwapChain::CreateVkSwapChain(VkDevice device, const SwapChainSupportDetails &supportDetails, const QueueFamilyIndices &physicalDeviceQueueFamilyIndices, VkSurfaceKHR surface, const Window *window, bool isFirstCreation) {
 		VkSurfaceFormatKHR surface_fmt = ChooseSwapSurfaceFormat(supportDetails.formats);
 		VkPresentModeKHR present_mode = ChooseSwapPresentMode(supportDetails.presentModes);
+		m_PresentMode = present_mode;
 		VkExtent2D extent = ChooseSwapExtent(window, supportDetails.surfaceCapabilities);
 
 		m_Extent = extent;
@@ -477,6 +836,109 @@ namespace gigno {
 		vkGetSwapchainImagesKHR(device, m_VkSwapChain, &images_count, m_Images.data());
 	}
 
+	void SwapChain::CreateOffscreenTargets(VkDevice device, VkPhysicalDevice physDevice, const Window *window) {
+		int width = 0, height = 0;
+		window->GetFrameBufferSize(&width, &height);
+		m_Extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+		m_Format = FindSupportedFormat(physDevice, { VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM }, VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+
+		// One target per frame in flight : a frame never renders into an image still used by the previous one.
+		m_Images.resize(MAX_FRAMES_IN_FLIGHT);
+		m_OffscreenImagesAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			CreateImage(device, m_Extent.width, m_Extent.height, m_Format, VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				m_Images[i], m_OffscreenImagesAllocations[i]);
+		}
+	}
+
+	bool SwapChain::ReadbackImage(const Device &device, uint32_t imageIndex, std::vector<uint8_t> &pixels) {
+		ASSERT_MSG_V(m_IsHeadless, false, "Image readback is only supported by headless swapchains.");
+		ASSERT_V(imageIndex < m_Images.size(), false);
+
+		VkDevice vk_device = device.GetDevice();
+		VkDeviceSize size = static_cast<VkDeviceSize>(m_Extent.width) * m_Extent.height * 4;
+
+		VkBuffer readback_buffer;
+		GpuAllocation_t readback_allocation{};
+		CreateBuffer(m_pAllocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					 readback_buffer, readback_allocation, ALLOCATION_STRATEGY_LINEAR);
+
+		VkCommandBufferAllocateInfo allocinfo{};
+		allocinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocinfo.commandPool = m_CommandPool;
+		allocinfo.commandBufferCount = 1;
+
+		VkCommandBuffer command_buffer;
+		vkAllocateCommandBuffers(vk_device, &allocinfo, &command_buffer);
+
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+
+		// The render pass already left the image in TRANSFER_SRC_OPTIMAL. Only make its writes visible to the copy.
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_Images[imageIndex];
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+		vkCmdCopyImageToBuffer(command_buffer, m_Images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer, 1, &region);
+
+		VkMemoryBarrier host_barrier{};
+		host_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+							 1, &host_barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(command_buffer);
+
+		VkSubmitInfo submit{};
+		submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit.commandBufferCount = 1;
+		submit.pCommandBuffers = &command_buffer;
+
+		VkResult result = vkQueueSubmit(device.GetGraphicsQueue(), 1, &submit, VK_NULL_HANDLE);
+		vkQueueWaitIdle(device.GetGraphicsQueue());
+		vkFreeCommandBuffers(vk_device, m_CommandPool, 1, &command_buffer);
+
+		if (result == VK_SUCCESS) {
+			pixels.resize(static_cast<size_t>(size));
+			memcpy(pixels.data(), readback_allocation.pMapped, static_cast<size_t>(size));
+
+			if (m_Format == VK_FORMAT_B8G8R8A8_UNORM) {
+				for (size_t i = 0; i < pixels.size(); i += 4) {
+					std::swap(pixels[i], pixels[i + 2]);
+				}
+			}
+		}
+
+		DestroyBuffer(m_pAllocator, readback_buffer, readback_allocation);
+
+		if (result != VK_SUCCESS) {
+			ERR_MSG_V(false, "Failed to submit image readback ! Vulkan Error Code : %d", (int)result);
+		}
+		return true;
+	}
+
 	void SwapChain::CreateImageViews(VkDevice device) {
 		m_ImageViews.resize(m_Images.size());
 		for (size_t i = 0; i < m_Images.size(); i++) {
@@ -493,7 +955,7 @@ namespace gigno {
 		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		color_attachment.finalLayout = m_IsHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference color_attachment_ref{};
 		color_attachment_ref.attachment = 0;
@@ -570,6 +1032,7 @@ namespace gigno {
 		createinfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		createinfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		createinfo.queueFamilyIndex = indices.graphicFamily.value();
+		m_GraphicsQueueFamily = indices.graphicFamily.value();
 
 		VkResult result = vkCreateCommandPool(device, &createinfo, nullptr, &m_CommandPool);
 		if (result != VK_SUCCESS) {
@@ -579,8 +1042,8 @@ namespace gigno {
 
 	void SwapChain::CreateDepthResources(VkDevice device, VkPhysicalDevice physDevice) {
 		VkFormat format = FindDepthFormat(physDevice);
-		CreateImage(device, physDevice, m_Extent.width, m_Extent.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DepthImage, m_DepthImageMemory);
+		CreateImage(device, m_Extent.width, m_Extent.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DepthImage, m_DepthImageAllocation);
 		m_DepthImageView = CreateImageView(device, m_DepthImage, format, VK_IMAGE_ASPECT_DEPTH_BIT);
 	}
 
@@ -597,6 +1060,15 @@ namespace gigno {
 		if (result != VK_SUCCESS) {
 			ERR_MSG("Failed to allocate Vulkan Command Buffers. Vulkan Errror Code : %d", (int)result);
 		}
+
+		m_OverlayCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		allocinfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocinfo.commandBufferCount = (uint32_t)m_OverlayCommandBuffers.size();
+
+		result = vkAllocateCommandBuffers(device, &allocinfo, m_OverlayCommandBuffers.data());
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to allocate Vulkan Overlay Command Buffers. Vulkan Errror Code : %d", (int)result);
+		}
 	}
 
 	VkSurfaceFormatKHR SwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &avaliableFormats) {
@@ -609,15 +1081,36 @@ namespace gigno {
 	}
 
 	VkPresentModeKHR SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &avaliableModes) {
-		for (const VkPresentModeKHR &mode : avaliableModes) {
-			if (mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-				return mode;
-			}
+		m_RequestedPresentMode = convar_r_present_mode;
+
+		// Most wanted first. FIFO is the only mode every surface supports.
+		std::vector<VkPresentModeKHR> preferred_modes;
+		switch (m_RequestedPresentMode) {
+		case 0:
+			break;
+		case 2:
+			preferred_modes = { VK_PRESENT_MODE_IMMEDIATE_KHR };
+			break;
+		case 3:
+			preferred_modes = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+			break;
+		default:
+			preferred_modes = { VK_PRESENT_MODE_MAILBOX_KHR };
+			break;
 		}
 
+		for (VkPresentModeKHR preferred : preferred_modes) {
+			if (std::find(avaliableModes.begin(), avaliableModes.end(), preferred) != avaliableModes.end()) {
+				return preferred;
+			}
+		}
 		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
+	bool SwapChain::IsPresentModeOutdated() const {
+		return !m_IsHeadless && m_RequestedPresentMode != convar_r_present_mode;
+	}
+
 	VkExtent2D SwapChain::ChooseSwapExtent(const Window * window, const VkSurfaceCapabilitiesKHR &capabilities) {
 		if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
 			return capabilities.currentExtent;
@@ -659,21 +1152,8 @@ namespace gigno {
 			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 	}
 
-	uint32_t SwapChain::FindMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
-		VkPhysicalDeviceMemoryProperties mem_prop{};
-		vkGetPhysicalDeviceMemoryProperties(device, &mem_prop);
-
-		for (uint32_t i = 0; i < mem_prop.memoryTypeCount; i++) {
-			if ((typeFilter & (i << i)) && (mem_prop.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
-		}
-
-		ERR_MSG_V(UINT32_MAX, "Failed to find suitable memory type !");
-	}
-
-	void SwapChain::CreateImage(VkDevice device, VkPhysicalDevice physDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-					VkMemoryPropertyFlags props, VkImage &image, VkDeviceMemory &imageMemory) {
+	void SwapChain::CreateImage(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+					VkMemoryPropertyFlags props, VkImage &image, GpuAllocation_t &imageAllocation) {
 		VkImageCreateInfo createinfo{};
 		createinfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		createinfo.imageType = VK_IMAGE_TYPE_2D;
@@ -697,17 +1177,12 @@ namespace gigno {
 		VkMemoryRequirements mem_requirements;
 		vkGetImageMemoryRequirements(device, image, &mem_requirements);
 
-		VkMemoryAllocateInfo allocinfo{};
-		allocinfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocinfo.allocationSize = mem_requirements.size;
-		allocinfo.memoryTypeIndex = FindMemoryTypeIndex(physDevice, mem_requirements.memoryTypeBits, props);
-
-		result = vkAllocateMemory(device, &allocinfo, nullptr, &imageMemory);
-		if (result != VK_SUCCESS) {
-			ERR_MSG("Failed to allocate Image Memory ! Vulkan Errror Code : %d", (int)result);
+		// Render targets : dedicated allocations (pooled blocks only hold buffers).
+		if (!m_pAllocator->Allocate(mem_requirements, props, ALLOCATION_STRATEGY_DEDICATED, imageAllocation)) {
+			ERR_MSG("Failed to allocate Image Memory !");
 		}
 
-		vkBindImageMemory(device, image, imageMemory, 0);
+		vkBindImageMemory(device, image, imageAllocation.Memory, imageAllocation.Offset);
 	}
 
 	VkImageView SwapChain::CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
@@ -8,6 +8,17 @@
 #include <string>
 
 #include "model.h"
+#include "memory_allocator.h"
+#include "frustum_culling.h"
+#include "gpu_culling.h"
+#include "gpu_profiler.h"
+#include "render_stats.h"
+#include "render_queue.h"
+#include "pipeline_registry.h"
+#include "light_clustering.h"
+#include "lod_selection.h"
+#include "debug_drawer.h"
+#include "../entities/entity.h"
 
 #include "../features_usage.h"
 
@@ -15,24 +26,34 @@
 
 namespace gigno {
 
-	const size_t MAX_FRAMES_IN_FLIGHT = 2;
+	// Upper bound of r_frames_in_flight : the per-frame resources are created for this many frames, the renderer cycles through the first r_frames_in_flight.
+	const size_t MAX_FRAMES_IN_FLIGHT = 3;
+
+	enum ObjectFlagBits_t {
+		OBJECT_FLAG_FULLBRIGHT_BIT = 1 << 0,
+	};
 
 	/*
-	Per-Entity data pushed to the shader.
-	
+	Per-Entity data, in the frame's object storage buffer at the entity's ObjectIndex.
+	The vertex shader finds it through the frame's instance buffer : objects[instanceObjectIndices[gl_InstanceIndex]].
+
 	Implementation :
-		* Must follow the Vulkan alignment rules : (From vulkan-tutorial) https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets#page_Alignment-requirements
+		* Must follow the std430 layout rules : an array of structs has a stride multiple of 16 bytes.
 	*/
-	struct PushConstantData_t {
-		glm::mat4 modelMatrix;
-		glm::mat4 normalsMatrix;
-		alignas(4) bool fullbright = false;
+	struct ObjectData_t {
+		glm::mat4 ModelMatrix{ 1.0f };
+		glm::mat4 NormalMatrix{ 1.0f };
+		// Decode of the model's quantized positions : offset + stored position * scale (see giModel::GetPositionOffset()).
+		glm::vec4 PositionOffset{ 0.0f };
+		glm::vec4 PositionScale{ 1.0f };
+		uint32_t Flags = 0; // ObjectFlagBits_t
+		uint32_t Padding[3]{};
 	};
-
-	const int MAX_LIGHT_DATA_COUNT = 10;
+	static_assert(sizeof(ObjectData_t) % 16 == 0, "ObjectData_t must follow the std430 array stride.");
 
 	/*
 	Constant-during-the-frame data pushed to the shader.
+	The lights themselves are in the frame's light storage buffer, binned into clusters by the LightClusterer.
 
 	Implementation :
 		* Must follow the Vulkan alignment rules : (From vulkan-tutorial) https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets#page_Alignment-requirements
@@ -40,7 +61,16 @@ namespace gigno {
 	struct UniformBufferData_t {
 		glm::mat4 view{ 1.f };
 		glm::mat4 projection{ 1.f };
-		glm::vec4 lightDatas[MAX_LIGHT_DATA_COUNT];
+		glm::vec4 clusterDepthParams{};  // See LightClusterer::GetDepthParams().
+		glm::vec4 clusterScreenParams{}; // See LightClusterer::GetScreenParams().
+		glm::uvec4 lightCounts{};        // x : global lights, first in the light buffer.
+	};
+
+	struct SwapChainTimings_t {
+		float PipelineCreationMs = 0.0f; // Every pipeline, on construction.
+		float LastRecreateMs = 0.0f;
+		float MaxRecreateMs = 0.0f;
+		uint32_t RecreateCount = 0;
 	};
 
 	class Device;
@@ -65,6 +95,8 @@ namespace gigno {
 		  * void RecordCommandBuffer( ... )
 		  * void Recreate( ... )
 		* Lifetime : Must outlive the device used for initialization/clean up.
+		* Headless : If the device is headless, no VkSwapchainKHR is created. Instead, one offscreen color image per frame in flight
+		             is rendered to (imageIndex == currentFrame), left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL so it can be read back.
 	*/
 	class SwapChain
 	{
@@ -80,12 +112,23 @@ namespace gigno {
 		VkCommandBuffer GetCommandBuffer(uint32_t index) const { return m_CommandBuffers[index]; }
 		VkCommandBuffer const *GetCommandBufferPtr(uint32_t index) const { return &m_CommandBuffers[index]; }
 		VkCommandPool GetCommandPool() const { return m_CommandPool; }
+		bool IsHeadless() const { return m_IsHeadless; }
+		const SwapChainTimings_t &GetTimings() const { return m_Timings; }
+
+		// Whether r_present_mode changed since the swap chain was created : it must be recreated to apply it. Always false when headless.
+		bool IsPresentModeOutdated() const;
+		// Mode chosen from r_present_mode, among those the surface supports.
+		VkPresentModeKHR GetPresentMode() const { return m_PresentMode; }
+		// What the last RecordCommandBuffer() recorded, with the pipeline statistics read back for it (see PipelineStatistics).
+		const RenderStats_t &GetFrameStats() const { return m_FrameStats; }
+		// Forgets what was kept per model for the destroyed models (see MeshCache::GetDestroyedModelIds()). Before RecordCommandBuffer().
+		void ReleaseModels(const std::vector<uint32_t> &modelIds) { m_GpuCuller.ReleaseModels(modelIds); }
 
 		/* 
-		@brief Recreates the Vulkan structs needed. To be called if the window size changed.
+		@brief Recreates the Vulkan structs that depend on the window size. To be called if the window size changed. Pipelines are kept.
 		@param device same device as the one used on initialization/clean up 
 		*/
-		void Recreate(const Device &device, const Window *window, const std::string &vertShaderPath, const std::string &fragShaderPath);
+		void Recreate(const Device &device, const Window *window);
 
 		/* 
 		@brief Fills the command buffer so that it is ready to be Submitted to vulkan. Updates the data pushed to the shader (Push Constants, Uniform Buffer)
@@ -93,11 +136,21 @@ namespace gigno {
 		*/
 		void RecordCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, const SceneRenderingData_t &sceneData);
 
+		/*
+		@brief Headless only. Copies the given offscreen image to the host. Waits for the graphics queue to be idle.
+		@param pixels resized to width * height * 4, filled with tightly packed RGBA8 pixels, top row first.
+		@returns whether the readback succeeded.
+		*/
+		bool ReadbackImage(const Device &device, uint32_t imageIndex, std::vector<uint8_t> &pixels);
+
 		#if USE_DEBUG_DRAWING
-		void UpdateDebugDrawings(VkDevice device, VkPhysicalDevice physDevice, VkQueue graphicsQueue);
+		/*
+		@brief Writes the drawings of the frame to its debug buffer. The fence of the frame must have been waited.
+		@param categoryMask DebugDrawCategoryBits_t to draw.
+		*/
+		void UpdateDebugDrawings(uint32_t currentFrame, uint32_t categoryMask) { m_DebugDrawer.Update(currentFrame, categoryMask); }
 
-		void DrawPoint(glm::vec3 position, glm::vec3 color, uint32_t drawCallHash);
-		void DrawLine(glm::vec3 startPos, glm::vec3 endPos, glm::vec3 startColor, glm::vec3 endColor, uint32_t drawCallHash);
+		DebugDrawer &GetDebugDrawer() { return m_DebugDrawer; }
 		#endif
 
 		bool Fullbright = false;
@@ -106,11 +159,14 @@ namespace gigno {
 		void CreateDescriptorSetLayout(VkDevice device); 
 		void CreateDescriptorPool(VkDevice device);
 		void CreateDescriptorSets(VkDevice device);
-		void CreateUniformBuffers(VkDevice device, VkPhysicalDevice physDevice);
+		void CreateUniformBuffers();
+		void CreateObjectBuffers();
 		void CreatePipelineLayout(VkDevice device);
-		void CreatePipeline(VkDevice device, const std::string &vertShaderPath, const std::string &fragShaderPath);
+		// Compiles the opaque pipeline and requests its variants.
+		void CreatePipelines(const Device &device, const std::string &vertShaderPath, const std::string &fragShaderPath);
 		void CreateVkSwapChain(VkDevice device, const SwapChainSupportDetails &supportDetails, const QueueFamilyIndices &physicalDeviceQueueFamilyIndices, 
 								VkSurfaceKHR surface, const Window *window, bool isFirstCreation);
+		void CreateOffscreenTargets(VkDevice device, VkPhysicalDevice physDevice, const Window *window);
 		void CreateImageViews(VkDevice device);
 		void CreateRenderPass(const VkDevice &device, const VkPhysicalDevice &physDevice);
 		void CreateFrameBuffers(VkDevice device);
@@ -123,67 +179,143 @@ namespace gigno {
 		VkExtent2D ChooseSwapExtent(const Window *window, const VkSurfaceCapabilitiesKHR &capabilities);
 		VkFormat FindSupportedFormat(VkPhysicalDevice physDevice, const std::vector<VkFormat> &candidates, VkImageTiling targetTiling, VkFormatFeatureFlags targetFeatures);
 		VkFormat FindDepthFormat(VkPhysicalDevice physDevice);
-		uint32_t FindMemoryTypeIndex(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
-		void CreateImage(VkDevice device, VkPhysicalDevice physDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, 
-							VkMemoryPropertyFlags props, VkImage &image, VkDeviceMemory &imageMemory);
+		void CreateImage(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, 
+							VkMemoryPropertyFlags props, VkImage &image, GpuAllocation_t &imageAllocation);
 		VkImageView CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 
 		void RecordCommandBuffer(VkCommandBuffer buffer, uint32_t currentFrame, uint32_t imageIndex, const SceneRenderingData_t &sceneData);
 
-		void RenderEntities(VkCommandBuffer buffer, const RenderedEntity * entities, uint32_t currentFrame);
+		/*
+		@brief Culls the entities against the camera's frustum and selects their level of detail. Writes the data of the visible entities
+		that changed since the frame's buffers were last used, and groups them by model.
+		With GPU culling, writes every resident entity instead and records the culling dispatch into 'buffer' (outside of the render pass).
+		Must be called before the frame's descriptor set is bound : growing a buffer updates the descriptor set.
+		*/
+		void UpdateObjectBuffers(VkCommandBuffer buffer, const RenderedEntity *entities, const Camera *camera, uint32_t objectCount, uint32_t currentFrame);
+		/*
+		@brief Splits the render queue's draws in chunks, one per thread at most, each recorded into its own secondary command buffer
+		by the thread pool. Appends the recorded buffers to 'secondaryBuffers'.
+		*/
+		void RecordEntities(uint32_t currentFrame, uint32_t imageIndex, std::vector<VkCommandBuffer> &secondaryBuffers);
+		// Begins a secondary command buffer continuing the render pass, with the dynamic viewport and scissor set.
+		void BeginSecondaryCommandBuffer(VkCommandBuffer buffer, uint32_t imageIndex);
 
 		#if USE_DEBUG_DRAWING
 		void RenderDebugDrawings(VkCommandBuffer buffer, const Camera *camera, uint32_t currentFrame);
 		#endif
 
-		void UpdateUniformBuffer(VkCommandBuffer commandBuffer, const Camera *camera, const std::vector<const Light *> &lights, uint32_t currentFrame);
+		void UpdateUniformBuffer(const Camera *camera, const std::vector<const Light *> &lights, uint32_t currentFrame);
+
+		bool m_IsHeadless = false;
+		SwapChainTimings_t m_Timings{};
+
+		MemoryAllocator *m_pAllocator;
 
 		VkFormat m_Format;
 		VkExtent2D m_Extent;
+		uint32_t m_RequestedPresentMode = 0; // r_present_mode when the swap chain was created.
+		VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
 		VkRenderPass m_RenderPass;
 
 		std::vector<VkImage> m_Images;
+		std::vector<GpuAllocation_t> m_OffscreenImagesAllocations; // Headless only. The swapchain owns its images otherwise.
 		std::vector<VkImageView> m_ImageViews;
 		std::vector<VkFramebuffer> m_FrameBuffers;
 
 		VkImage m_DepthImage;
-		VkDeviceMemory m_DepthImageMemory;
+		GpuAllocation_t m_DepthImageAllocation{};
 		VkImageView m_DepthImageView;
 
 		VkCommandPool m_CommandPool;
+		uint32_t m_GraphicsQueueFamily = 0;
 		std::vector<VkCommandBuffer> m_CommandBuffers;
+		// Per-Frame secondary buffers recorded on the main thread : debug drawings and ImGui.
+		std::vector<VkCommandBuffer> m_OverlayCommandBuffers;
+
+		// Draws of a chunk are recorded by a single thread at a time, so each chunk has its own pool. Reset every frame.
+		struct RecordingChunk_t {
+			VkCommandPool Pool = VK_NULL_HANDLE;
+			VkCommandBuffer Buffer = VK_NULL_HANDLE;
+			RenderStats_t Stats; // Of the chunk alone, added to the frame's once recorded.
+		};
+		std::vector<RecordingChunk_t> m_RecordingChunks[MAX_FRAMES_IN_FLIGHT];
+		// Creates the frame's missing chunks, up to 'count'. @returns false if one could not be created.
+		bool ReserveRecordingChunks(uint32_t currentFrame, uint32_t count);
+		// Resets the chunk's pool, begins its buffer and binds the state shared by every entity draw.
+		void BeginEntityChunk(RecordingChunk_t &chunk, uint32_t currentFrame, uint32_t imageIndex);
+		void EndEntityChunk(RecordingChunk_t &chunk);
+		void RecordEntityChunk(RecordingChunk_t &chunk, uint32_t currentFrame, uint32_t imageIndex, uint32_t firstDraw, uint32_t endDraw);
 
 		VkDescriptorSetLayout m_DescriptorSetLayout;
 		VkDescriptorPool m_DescriptorPool;
 		std::vector<VkDescriptorSet> m_DescriptorSets;
 
 		std::vector<VkBuffer> m_UniformBuffers;
-		std::vector<VkDeviceMemory> m_UniformBuffersMemories;
-		std::vector<void *> m_UniformBuffersMapped;
-
-		std::unique_ptr<giPipeline> m_Pipeline;
+		std::vector<GpuAllocation_t> m_UniformBuffersAllocations; // Persistently mapped.
+
+		// Persistently mapped storage buffer, bound to the frame's descriptor set. Grows, never shrinks.
+		struct FrameStorageBuffer_t {
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			GpuAllocation_t Allocation{};
+			VkDeviceSize Capacity = 0;
+		};
+		// Grows the buffer if it cannot hold 'size' bytes, keeping its content. The frame must not be in flight.
+		void ReserveStorageBuffer(uint32_t currentFrame, uint32_t binding, FrameStorageBuffer_t &storage, VkDeviceSize size);
+
+		struct WrittenObject_t {
+			Transform_t Transform{};
+			uint32_t ModelId = 0; // giModel::GetId() : unlike the model's address, never reused.
+			bool IsValid = false;
+		};
+		struct FrameObjects_t {
+			FrameStorageBuffer_t Objects;         // ObjectData_t per ObjectIndex. Object 0 is the identity (used by debug drawings).
+			FrameStorageBuffer_t InstanceIndices; // ObjectIndex per instance. Instance 0 is object 0.
+			std::vector<WrittenObject_t> Written; // What 'Objects' holds, so that only what changed is rewritten.
+			bool Fullbright = false;
+		};
+		FrameObjects_t m_FrameObjects[MAX_FRAMES_IN_FLIGHT];
+		// Writes the entity's object data if it changed since the frame's buffer was last written.
+		void WriteObject(FrameObjects_t &frame, const RenderedEntity *entity);
+
+		struct FrameLights_t {
+			FrameStorageBuffer_t Lights;        // LightData_t, global lights first.
+			FrameStorageBuffer_t Clusters;      // ClusterRange_t per cluster.
+			FrameStorageBuffer_t LightIndices;  // Indices in Lights, referenced by the clusters.
+		};
+		FrameLights_t m_FrameLights[MAX_FRAMES_IN_FLIGHT];
+		void CreateLightBuffers();
+		LightClusterer m_LightClusterer;
+
+		FrustumCuller m_Culler; // Also holds the world bounds the levels of detail are selected from.
+		LodSelector m_LodSelector;
+		// Replaces the culler and the render queue when usable and enabled (r_gpu_culling). Decided once per frame.
+		GpuCuller m_GpuCuller;
+		bool m_UseGpuCulling = false;
+		// Scopes of RecordCommandBuffer(). Entity chunks are recorded on worker threads and time nothing themselves : "Render Pass" covers them.
+		GpuProfiler m_GpuProfiler;
+		PipelineStatistics m_PipelineStatistics;
+		RenderStats_t m_FrameStats; // Reset by RecordCommandBuffer(). Main thread only : worker threads count in their chunk.
+		std::vector<const RenderedEntity *> m_ResidentEntities; // Reused from frame to frame.
+
+		static constexpr PipelineId_t OPAQUE_PIPELINE_ID = PipelineRegistry::FALLBACK_PIPELINE_ID;
+		// Below this, a draw chunk is not worth its own secondary command buffer and thread.
+		static constexpr uint32_t MIN_DRAWS_PER_RECORDING_CHUNK = 128;
+		RenderQueue m_RenderQueue; // Reused from frame to frame.
+
+		PipelineRegistry m_Pipelines;
+		// Per vertex format : opaque, then wireframe.
+		PipelineId_t m_EntityPipelineIds[VERTEX_FORMAT_MAX_ENUM][2]{};
+		PipelineId_t m_OverlayPipelineId = OPAQUE_PIPELINE_ID;
+		// Per vertex format, decided once per frame : opaque or wireframe (r_wireframe). Meshes whose pipeline is VK_NULL_HANDLE are not drawn.
+		PipelineId_t m_FramePipelineIds[VERTEX_FORMAT_MAX_ENUM]{};
+		VkPipeline m_FramePipelines[VERTEX_FORMAT_MAX_ENUM]{};
 		VkPipelineLayout m_PipelineLayout;
 
-		VkSwapchainKHR m_VkSwapChain;
+		VkSwapchainKHR m_VkSwapChain = VK_NULL_HANDLE;
 
 		#if USE_DEBUG_DRAWING
-		uint32_t m_DDLastFramePointsDrawCallHash;
-		uint32_t m_DDCurrentFramePointsDrawCallHash;
-
-		uint32_t m_DDLastFrameLinesDrawCallHash;
-		uint32_t m_DDCurrentFrameLinesDrawCallHash;
-
-		uint32_t m_DDPointsCount = 0;
-		std::vector<Vertex> m_DDPoints { };
-
-		uint32_t m_DDLinesCount = 0;
-		std::vector<Vertex> m_DDLines{ };
-
-		VkBuffer m_DDPointsBuffer;
-		VkDeviceMemory m_DDPointsMemory;
-
-		VkBuffer m_DDLinesBuffer;
-		VkDeviceMemory m_DDLinesMemory;
+		DebugDrawer m_DebugDrawer;
+		PipelineId_t m_DebugShapePipelineId = PipelineRegistry::INVALID_PIPELINE_ID;
 		#endif
 	};
 
@@ -0,0 +1,254 @@
+#include "upload_manager.h"
+#include "device.h"
+#include "rendering_utils.h"
+#include "../error_macros.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gigno {
+
+	UploadManager::UploadManager(const Device &device) :
+		m_Device{ device.GetDevice() },
+		m_TransferQueue{ device.GetTransferQueue() },
+		m_pAllocator{ device.GetAllocator() },
+		m_SubmitThread{ std::this_thread::get_id() }
+	{
+		QueueFamilyIndices indices = device.GetPhysicalDeviceQueueFamilyIndices();
+		m_QueueFamilies.push_back(indices.graphicFamily.value());
+		if (indices.transferFamily.value() != indices.graphicFamily.value()) {
+			m_QueueFamilies.push_back(indices.transferFamily.value());
+		}
+
+		VkCommandPoolCreateInfo createinfo{};
+		createinfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		createinfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		createinfo.queueFamilyIndex = indices.transferFamily.value();
+
+		VkResult result = vkCreateCommandPool(m_Device, &createinfo, nullptr, &m_CommandPool);
+		if (result != VK_SUCCESS) {
+			ERR_MSG("Failed to create Upload Command Pool ! Vulkan Error Code : %d", (int)result);
+		}
+
+		CreateBuffer(m_pAllocator, STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					 m_RingBuffer, m_RingAllocation, ALLOCATION_STRATEGY_DEDICATED);
+	}
+
+	void UploadManager::CleanUp() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+
+		while (!m_InFlightBatches.empty()) {
+			RetireCompleted(true);
+		}
+
+		for (const Batch_t &batch : m_FreeBatches) {
+			vkDestroyFence(m_Device, batch.Fence, nullptr);
+		}
+		m_FreeBatches.clear();
+		if (m_HasPendingBatch) {
+			vkDestroyFence(m_Device, m_PendingBatch.Fence, nullptr);
+			m_HasPendingBatch = false;
+		}
+
+		vkDestroyCommandPool(m_Device, m_CommandPool, nullptr); // Frees the command buffers.
+		DestroyBuffer(m_pAllocator, m_RingBuffer, m_RingAllocation);
+	}
+
+	UploadTicket_t UploadManager::UploadToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size) {
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+
+		VkDeviceSize done = 0;
+		while (done < size) {
+			const VkDeviceSize chunk_size = std::min(size - done, MAX_CHUNK_SIZE);
+
+			VkDeviceSize ring_offset = 0;
+			while (!TryAllocateRing(chunk_size, ring_offset)) {
+				// The ring is full : free the oldest batch. If only the pending batch holds the ring, submit it first.
+				if (m_InFlightBatches.empty()) {
+					if (!CanSubmit()) {
+						m_BatchSubmitted.wait(lock);
+						continue;
+					}
+					FlushLocked();
+				}
+				if (m_InFlightBatches.empty()) {
+					ERR_MSG_V(m_NextTicket - 1, "Staging ring cannot fit an upload chunk of %llu bytes.", (unsigned long long)chunk_size);
+				}
+				RetireCompleted(true);
+			}
+
+			if (!m_HasPendingBatch) {
+				BeginPendingBatch();
+			}
+
+			memcpy(static_cast<char *>(m_RingAllocation.pMapped) + ring_offset, static_cast<const char *>(data) + done, (size_t)chunk_size);
+
+			VkBufferCopy region{};
+			region.srcOffset = ring_offset;
+			region.dstOffset = dstOffset + done;
+			region.size = chunk_size;
+			vkCmdCopyBuffer(m_PendingBatch.CommandBuffer, m_RingBuffer, dst, 1, &region);
+
+			done += chunk_size;
+		}
+		m_UploadedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		return m_HasPendingBatch ? m_PendingBatch.Ticket : m_NextTicket - 1;
+	}
+
+	UploadTicket_t UploadManager::Flush() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return FlushLocked();
+	}
+
+	void UploadManager::Update() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		RetireCompleted(false);
+	}
+
+	bool UploadManager::IsComplete(UploadTicket_t ticket) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (ticket <= m_CompletedTicket) {
+			return true;
+		}
+		RetireCompleted(false);
+		return ticket <= m_CompletedTicket;
+	}
+
+	void UploadManager::Wait(UploadTicket_t ticket) {
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		while (m_HasPendingBatch && ticket >= m_PendingBatch.Ticket) {
+			if (!CanSubmit()) {
+				m_BatchSubmitted.wait(lock);
+				continue;
+			}
+			FlushLocked();
+		}
+		while (m_CompletedTicket < ticket && !m_InFlightBatches.empty()) {
+			RetireCompleted(true);
+		}
+	}
+
+	bool UploadManager::TryAllocateRing(VkDeviceSize size, VkDeviceSize &offset) {
+		size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+
+		if (m_RingUsed == 0) {
+			m_RingHead = 0;
+			m_RingTail = 0;
+		} else if (m_RingUsed == STAGING_RING_SIZE) {
+			return false;
+		}
+
+		VkDeviceSize consumed = 0;
+		if (m_RingHead >= m_RingTail) {
+			// Free space : [head, end) and [0, tail).
+			if (m_RingHead + size <= STAGING_RING_SIZE) {
+				offset = m_RingHead;
+				consumed = size;
+			} else if (size <= m_RingTail) {
+				offset = 0;
+				consumed = (STAGING_RING_SIZE - m_RingHead) + size; // The end of the ring is skipped until the tail wraps too.
+			} else {
+				return false;
+			}
+		} else {
+			// Free space : [head, tail).
+			if (m_RingHead + size <= m_RingTail) {
+				offset = m_RingHead;
+				consumed = size;
+			} else {
+				return false;
+			}
+		}
+
+		m_RingHead = offset + size;
+		m_RingUsed += consumed;
+		m_PendingBatch.RingBytes += consumed;
+		return true;
+	}
+
+	void UploadManager::BeginPendingBatch() {
+		Batch_t batch{};
+		if (!m_FreeBatches.empty()) {
+			batch = m_FreeBatches.back();
+			m_FreeBatches.pop_back();
+		} else {
+			VkCommandBufferAllocateInfo allocinfo{};
+			allocinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocinfo.commandPool = m_CommandPool;
+			allocinfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(m_Device, &allocinfo, &batch.CommandBuffer);
+
+			VkFenceCreateInfo fence_info{};
+			fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			vkCreateFence(m_Device, &fence_info, nullptr, &batch.Fence);
+		}
+
+		m_PendingBatch.CommandBuffer = batch.CommandBuffer;
+		m_PendingBatch.Fence = batch.Fence;
+		m_PendingBatch.Ticket = m_NextTicket++;
+		m_HasPendingBatch = true;
+
+		VkCommandBufferBeginInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(m_PendingBatch.CommandBuffer, &info);
+	}
+
+	UploadTicket_t UploadManager::FlushLocked() {
+		if (!m_HasPendingBatch) {
+			return m_NextTicket - 1;
+		}
+
+		Batch_t batch = m_PendingBatch;
+		batch.RingHead = m_RingHead;
+		m_PendingBatch = Batch_t{};
+		m_HasPendingBatch = false;
+
+		// Make the copies available. The graphics queue only reads them once the fence was seen signaled (see IsComplete()).
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(batch.CommandBuffer);
+
+		VkSubmitInfo submit{};
+		submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit.commandBufferCount = 1;
+		submit.pCommandBuffers = &batch.CommandBuffer;
+
+		VkResult result = vkQueueSubmit(m_TransferQueue, 1, &submit, batch.Fence);
+		if (result != VK_SUCCESS) {
+			m_FreeBatches.push_back(batch);
+			ERR_MSG_V(batch.Ticket, "Failed to submit uploads ! Vulkan Error Code : %d", (int)result);
+		}
+
+		m_InFlightBatches.push_back(batch);
+		m_BatchSubmitted.notify_all();
+		return batch.Ticket;
+	}
+
+	void UploadManager::RetireCompleted(bool waitForOldest) {
+		while (!m_InFlightBatches.empty()) {
+			Batch_t &batch = m_InFlightBatches.front();
+			if (waitForOldest) {
+				vkWaitForFences(m_Device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+				waitForOldest = false;
+			} else if (vkGetFenceStatus(m_Device, batch.Fence) != VK_SUCCESS) {
+				break;
+			}
+
+			vkResetFences(m_Device, 1, &batch.Fence);
+			m_RingTail = batch.RingHead;
+			m_RingUsed -= batch.RingBytes;
+			m_CompletedTicket = batch.Ticket;
+
+			m_FreeBatches.push_back(batch);
+			m_InFlightBatches.pop_front();
+		}
+	}
+
+}
@@ -0,0 +1,119 @@
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+#include "memory_allocator.h"
+
+namespace gigno {
+
+	class Device;
+
+	// Identifies the batch an upload was recorded into. Batches complete in order : ticket N complete means every ticket <= N is.
+	typedef uint64_t UploadTicket_t;
+
+	/*
+	Streams data to device local buffers through a persistently mapped staging ring.
+
+	Usage :
+		* Initialisation : Initialized by constructor, owned by the RenderingServer.
+		* Clean Up : Must call CleanUp() before the device is destroyed. Waits for in flight uploads.
+		* Key Functions :
+		  * UploadTicket_t UploadToBuffer( ... ) : Copies data to the ring and records the GPU copy. Nothing is submitted yet.
+		  * UploadTicket_t Flush() : Submits every recorded copy in a single batch, signaling a fence.
+		  * bool IsComplete( ... ) : Non blocking. Whether a batch's copies are done.
+		* Copies run on the device's transfer queue. Destination buffers must be created with GetQueueFamilies() (see CreateBuffer()),
+		  so that they can be used by the graphics queue without ownership transfer.
+		* Nothing waits on the whole queue : only when the ring is full does a call wait, for the oldest batch alone.
+		* Thread safe. Only the thread which created the manager submits : the transfer queue may be the graphics queue, which the
+		  main thread submits and presents to without locking. A worker which needs the pending batch submitted (the ring is full,
+		  or it waits for its ticket) waits for that thread's next Flush().
+	*/
+	class UploadManager {
+	public:
+		UploadManager(const Device &device);
+		UploadManager(const UploadManager &) = delete;
+		UploadManager &operator=(const UploadManager &) = delete;
+
+		void CleanUp();
+
+		/*
+		@brief Copies 'data' to the staging ring and records its copy to 'dst'. Uploads larger than the ring are split.
+		@returns the ticket of the batch the copy belongs to. Submitted on the next Flush().
+		*/
+		UploadTicket_t UploadToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+
+		// Submits the recorded copies. Returns the ticket of the submitted batch (or the last submitted ticket if there was nothing to submit).
+		UploadTicket_t Flush();
+
+		// Retires the batches the GPU is done with, freeing their part of the ring. Called once per frame.
+		void Update();
+
+		bool IsComplete(UploadTicket_t ticket);
+		// Flushes if needed (or waits for the next Flush() on a worker) and blocks until the ticket's batch completes.
+		void Wait(UploadTicket_t ticket);
+
+		const std::vector<uint32_t> &GetQueueFamilies() const { return m_QueueFamilies; }
+		// Bytes copied to the ring since creation.
+		uint64_t GetUploadedBytes() const { return m_UploadedBytes.load(std::memory_order_relaxed); }
+
+	private:
+		static constexpr VkDeviceSize STAGING_RING_SIZE = 32ull * 1024 * 1024;
+		// Uploads are split into chunks of at most this size, so that one large upload does not need the whole ring free.
+		static constexpr VkDeviceSize MAX_CHUNK_SIZE = STAGING_RING_SIZE / 4;
+		// Satisfies optimalBufferCopyOffsetAlignment on every known device.
+		static constexpr VkDeviceSize RING_ALIGNMENT = 256;
+
+		struct Batch_t {
+			VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+			VkFence Fence = VK_NULL_HANDLE;
+			UploadTicket_t Ticket = 0;
+			VkDeviceSize RingHead = 0;  // Ring head when the batch was submitted : the ring tail once it retires.
+			VkDeviceSize RingBytes = 0; // Ring bytes used by the batch, wrap-around padding included.
+		};
+
+		// Returns false if the ring cannot fit 'size' right now.
+		bool TryAllocateRing(VkDeviceSize size, VkDeviceSize &offset);
+		void BeginPendingBatch();
+		UploadTicket_t FlushLocked();
+		void RetireCompleted(bool waitForOldest);
+		bool CanSubmit() const { return std::this_thread::get_id() == m_SubmitThread; }
+
+		VkDevice m_Device;
+		VkQueue m_TransferQueue;
+		MemoryAllocator *m_pAllocator;
+		std::vector<uint32_t> m_QueueFamilies;
+
+		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+		VkBuffer m_RingBuffer = VK_NULL_HANDLE;
+		GpuAllocation_t m_RingAllocation{};
+		VkDeviceSize m_RingHead = 0;
+		VkDeviceSize m_RingTail = 0;
+		VkDeviceSize m_RingUsed = 0;
+
+		bool m_HasPendingBatch = false;
+		Batch_t m_PendingBatch{};
+		std::deque<Batch_t> m_InFlightBatches;
+		std::vector<Batch_t> m_FreeBatches;
+
+		UploadTicket_t m_NextTicket = 1;
+		UploadTicket_t m_CompletedTicket = 0;
+		std::atomic<uint64_t> m_UploadedBytes{ 0 };
+
+		std::thread::id m_SubmitThread;
+		std::condition_variable m_BatchSubmitted; // Notified by FlushLocked(), for the workers waiting for a submit.
+
+		std::mutex m_Mutex;
+	};
+
+}
+
+#endif
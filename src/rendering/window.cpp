@@ -5,7 +5,14 @@
 
 namespace gigno {
 
-	Window::Window(int w, int h, const char *pTitle, InputServer *inputServer) : m_Width(w), m_Height(h) {
+	Window::Window(int w, int h, const char *pTitle, InputServer *inputServer, bool headless) : m_Width(w), m_Height(h), m_IsHeadless(headless) {
+		m_UserPointerData.Window = this;
+
+		if (m_IsHeadless) {
+			// No display : nothing to create. Input server stays unbound.
+			return;
+		}
+
 		glfwInit();
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -13,8 +20,6 @@ namespace gigno {
 
 		m_pWindow = glfwCreateWindow(m_Width, m_Height, pTitle, nullptr, nullptr);
 
-		m_UserPointerData.Window = this;
-
 		glfwSetWindowUserPointer(m_pWindow, &m_UserPointerData);
 
 		glfwSetFramebufferSizeCallback(m_pWindow, ResizeCallback);
@@ -27,19 +32,32 @@ namespace gigno {
 		if (m_InputServerBoundTo) {
 			m_InputServerBoundTo->UnbindWindow();
 		}
+		if (m_IsHeadless) {
+			return;
+		}
 		glfwDestroyWindow(m_pWindow);
 		glfwTerminate();
 	}
 
 	bool Window::ShouldClose() {
+		if (m_IsHeadless) {
+			return false;
+		}
 		return glfwWindowShouldClose(m_pWindow);
 	}
 
 	void Window::PollEvents() {
+		if (m_IsHeadless) {
+			return;
+		}
 		glfwPollEvents();
 	}
 
 	void Window::CreateWindowSurface(VkInstance instance, VkSurfaceKHR *surface) const {
+		if (m_IsHeadless) {
+			*surface = VK_NULL_HANDLE;
+			return;
+		}
 		VkResult result = glfwCreateWindowSurface(instance, m_pWindow, nullptr, surface);
 		if (result != VK_SUCCESS) {
 			ERR_MSG("Failed to create Window Surface ! Vullkan error code : %d", (int)result);
@@ -47,6 +65,11 @@ namespace gigno {
 	}
 
 	void Window::GetFrameBufferSize(int *width, int *height) const {
+		if (m_IsHeadless) {
+			*width = m_Width;
+			*height = m_Height;
+			return;
+		}
 		glfwGetFramebufferSize(m_pWindow, width, height);
 	}
 
@@ -18,7 +18,11 @@ namespace gigno {
 	class Window {
 
 	public:
-		Window(int w, int h, const char *pTitle, InputServer *inputServer);
+		/*
+		@param headless if true, no GLFW window is created. The Window only keeps track of the requested size,
+		                which is used as the size of the offscreen render targets.
+		*/
+		Window(int w, int h, const char *pTitle, InputServer *inputServer, bool headless = false);
 		~Window();
 
 		Window(const Window &) = delete;
@@ -33,6 +37,8 @@ namespace gigno {
 
 		GLFWwindow *GetGLFWwindow() const  { return m_pWindow; };
 
+		bool IsHeadless() const { return m_IsHeadless; }
+
 		bool HasResized();
 
 	private:
@@ -43,11 +49,13 @@ namespace gigno {
 
 		bool resized = false;
 
-		GLFWwindow *m_pWindow;
+		bool m_IsHeadless = false;
+
+		GLFWwindow *m_pWindow = nullptr;
 
 		WindowUserPointerData_t m_UserPointerData;
 
-		InputServer *m_InputServerBoundTo;
+		InputServer *m_InputServerBoundTo = nullptr;
 	};
 
 }
@@ -0,0 +1,127 @@
+#include "thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace gigno {
+
+    namespace {
+        // Shared between the caller of ParallelFor and the helper jobs : a helper may start after the caller returned.
+        struct ParallelForState_t {
+            const std::function<void(uint32_t, uint32_t)> *pJob;
+            uint32_t Count;
+            uint32_t BatchSize;
+            uint32_t BatchCount;
+
+            std::atomic<uint32_t> NextBatch{ 0 };
+            std::atomic<uint32_t> DoneBatches{ 0 };
+            std::mutex Mutex;
+            std::condition_variable AllDone;
+
+            // Runs batches until none is left to claim.
+            void Work() {
+                uint32_t batch;
+                while ((batch = NextBatch.fetch_add(1)) < BatchCount) {
+                    const uint32_t begin = batch * BatchSize;
+                    (*pJob)(begin, std::min(begin + BatchSize, Count));
+
+                    if (DoneBatches.fetch_add(1) + 1 == BatchCount) {
+                        std::lock_guard<std::mutex> lock{ Mutex };
+                        AllDone.notify_all();
+                    }
+                }
+            }
+        };
+    }
+
+    ThreadPool::ThreadPool(uint32_t workerCount) {
+        if (workerCount == 0) {
+            const uint32_t hardware_threads = std::thread::hardware_concurrency();
+            workerCount = hardware_threads > 1 ? hardware_threads - 1 : 1;
+        }
+
+        m_Workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{ m_Mutex };
+            m_IsStopping = true;
+        }
+        m_JobAvailable.notify_all();
+
+        for (std::thread &worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::ParallelFor(uint32_t count, uint32_t minBatchSize, const std::function<void(uint32_t begin, uint32_t end)> &job) {
+        if (count == 0) {
+            return;
+        }
+
+        // A few batches per thread, so that a thread slowed down by the OS does not hold everyone back.
+        const uint32_t max_batch_count = GetConcurrency() * 4;
+        uint32_t batch_size = std::max<uint32_t>(minBatchSize, 1);
+        batch_size = std::max(batch_size, (count + max_batch_count - 1) / max_batch_count);
+        const uint32_t batch_count = (count + batch_size - 1) / batch_size;
+
+        if (batch_count == 1) {
+            job(0, count);
+            return;
+        }
+
+        std::shared_ptr<ParallelForState_t> state = std::make_shared<ParallelForState_t>();
+        state->pJob = &job;
+        state->Count = count;
+        state->BatchSize = batch_size;
+        state->BatchCount = batch_count;
+
+        const uint32_t helper_count = std::min(batch_count - 1, GetWorkerCount());
+        {
+            std::lock_guard<std::mutex> lock{ m_Mutex };
+            for (uint32_t i = 0; i < helper_count; i++) {
+                m_Jobs.emplace_back([state]() { state->Work(); });
+            }
+        }
+        if (helper_count == 1) {
+            m_JobAvailable.notify_one();
+        } else {
+            m_JobAvailable.notify_all();
+        }
+
+        state->Work();
+
+        std::unique_lock<std::mutex> lock{ state->Mutex };
+        state->AllDone.wait(lock, [&state]() { return state->DoneBatches.load() == state->BatchCount; });
+    }
+
+    void ThreadPool::Submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock{ m_Mutex };
+            m_Jobs.push_back(std::move(job));
+        }
+        m_JobAvailable.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock{ m_Mutex };
+                m_JobAvailable.wait(lock, [this]() { return m_IsStopping || !m_Jobs.empty(); });
+                if (m_Jobs.empty()) {
+                    return; // Stopping, and every queued job ran.
+                }
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace gigno {
+
+    /*
+    Fixed set of worker threads running jobs for the rest of the engine.
+
+    Usage :
+        * Initialisation : Initialized by constructor, owned by the Application.
+        * Clean Up : Joins the workers on destruction. Jobs still queued are run first.
+        * Key Functions :
+          * void ParallelFor( ... ) : Splits a range in batches run by the workers and the calling thread. Returns once every batch ran.
+          * void Submit( ... ) : Queues a job and returns immediately.
+        * ParallelFor can be called from a job : the calling thread always takes part, so it never waits on a busy pool alone.
+    */
+    class ThreadPool {
+    public:
+        // @param workerCount 0 to use one worker per hardware thread, minus the calling thread.
+        ThreadPool(uint32_t workerCount = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+        // Workers plus the calling thread.
+        uint32_t GetConcurrency() const { return GetWorkerCount() + 1; }
+
+        /*
+        @brief Runs 'job(begin, end)' over sub-ranges covering [0, count). Blocks until every sub-range ran.
+        @param minBatchSize sub-ranges are at least this long (except the last one) : jobs too small are not worth a thread.
+        */
+        void ParallelFor(uint32_t count, uint32_t minBatchSize, const std::function<void(uint32_t begin, uint32_t end)> &job);
+
+        void Submit(std::function<void()> job);
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> m_Workers;
+
+        std::deque<std::function<void()>> m_Jobs;
+        std::mutex m_Mutex;
+        std::condition_variable m_JobAvailable;
+        bool m_IsStopping = false;
+    };
+
+}
+
+#endif